@@ -95,6 +95,12 @@
     #define ESP_NN                                  1
 #endif
 
+// Keep the TFLite Micro interpreter and tensor arena alive between run_classifier() calls
+// on a handle, from run_classifier_init() until run_classifier_deinit()
+#ifndef EI_CLASSIFIER_TFLITE_RESIDENT_INTERPRETER
+#define EI_CLASSIFIER_TFLITE_RESIDENT_INTERPRETER   0
+#endif // EI_CLASSIFIER_TFLITE_RESIDENT_INTERPRETER
+
 // no include checks in the compiler? then just include metadata and then ops_define (optional if on EON model)
 #ifndef __has_include
     #include "model-parameters/model_metadata.h"
@@ -227,6 +227,13 @@ typedef struct {
      * the impulse contains an anomaly detection block, otherwise 0.
      */
     int64_t anomaly_us;
+
+    /**
+     * Amount of time (in microseconds) it took to allocate the tensor arena and build
+     * the interpreter for this call. 0 if a resident interpreter was reused (see
+     * `EI_CLASSIFIER_TFLITE_RESIDENT_INTERPRETER`).
+     */
+    int64_t setup_us;
 } ei_impulse_result_timing_t;
 
 /**
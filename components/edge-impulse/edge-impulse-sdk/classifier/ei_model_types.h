@@ -467,12 +467,27 @@ public:
     }
 };
 
+/**
+ * Result storage of one handle. Bounding boxes and classification arrays of a result point
+ * in here, so they stay valid until the next call on the same handle, and handles that are
+ * used from different tasks at the same time never share output buffers.
+ */
+typedef struct {
+    std::vector<ei_impulse_result_classification_t> classification;
+    std::vector<ei_impulse_result_bounding_box_t> bounding_boxes;
+    std::vector<ei_impulse_result_bounding_box_t> class_bounding_boxes;
+    ei_vector<ei_impulse_result_bounding_box_t> visual_ad_grid_cells;
+    std::vector<ei_impulse_result_bounding_box_t> batch_bounding_boxes;
+    std::vector<ei_impulse_result_classification_t> batch_classification;
+} ei_impulse_result_storage_t;
+
 class ei_impulse_handle_t {
 public:
     ei_impulse_handle_t(const ei_impulse_t *impulse)
         : state(impulse)
         , impulse(impulse)
         , post_processing_state(nullptr)
+        , inference_state(nullptr)
 #if EI_CLASSIFIER_FREEFORM_OUTPUT
         , freeform_outputs(nullptr)
 #endif //EI_CLASSIFIER_FREEFORM_OUTPUT
@@ -481,6 +496,8 @@ public:
     ei_impulse_state_t state;
     const ei_impulse_t *impulse;
     void** post_processing_state;
+    void* inference_state; // owned by the inferencing engine, nullptr if not resident
+    ei_impulse_result_storage_t result_storage;
 #if EI_CLASSIFIER_FREEFORM_OUTPUT == 1
     ei::matrix_t *freeform_outputs;
 #endif // EI_CLASSIFIER_FREEFORM_OUTPUT
@@ -202,7 +202,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
     memset(result, 0, sizeof(ei_impulse_result_t));
 
 #if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
-    static std::vector<ei_impulse_result_classification_t> classification_results;
+    std::vector<ei_impulse_result_classification_t> &classification_results = handle->result_storage.classification;
     classification_results.clear(); // todo, should not clear and re-gen this every time...
 
     if (handle->impulse->results_type == EI_CLASSIFIER_TYPE_CLASSIFICATION ||
@@ -240,7 +240,13 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
     // Shortcut for quantized image models
     ei_learning_block_t block = handle->impulse->learning_blocks[0];
     if (can_run_classifier_image_quantized(handle->impulse, block) == EI_IMPULSE_OK) {
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+        EI_IMPULSE_ERROR res = handle->inference_state
+            ? run_nn_inference_image_quantized_resident(handle, signal, result, debug)
+            : run_classifier_image_quantized(handle->impulse, signal, result, debug);
+#else
         EI_IMPULSE_ERROR res = run_classifier_image_quantized(handle->impulse, signal, result, debug);
+#endif // EI_CLASSIFIER_HAS_TFLITE_RESIDENT
         if (res != EI_IMPULSE_OK) {
             return res;
         }
@@ -427,7 +433,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     memset(result, 0, sizeof(ei_impulse_result_t));
 
 #if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
-    static std::vector<ei_impulse_result_classification_t> classification_results;
+    std::vector<ei_impulse_result_classification_t> &classification_results = handle->result_storage.classification;
     classification_results.clear(); // todo, should not clear and re-gen this every time...
 
     if (handle->impulse->results_type == EI_CLASSIFIER_TYPE_CLASSIFICATION ||
@@ -839,6 +845,9 @@ extern "C" void run_classifier_init(void)
 #if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
     init_data_normalization(&ei_default_impulse);
 #endif
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+    inference_tflite_resident_init(&ei_default_impulse);
+#endif
 }
 
 /**
@@ -851,6 +860,10 @@ extern "C" void run_classifier_init(void)
  *
  * **Blocking**: yes
  *
+ * With `EI_CLASSIFIER_TFLITE_RESIDENT_INTERPRETER` enabled this also allocates the tensor
+ * arena and builds the TFLite interpreter once for the handle. Later calls to
+ * `run_classifier()` on the same handle reuse them until `run_classifier_deinit()`.
+ *
  * **Example**: [nano_ble33_sense_microphone_continuous.ino](https://github.com/edgeimpulse/example-lacuna-ls200/blob/main/nano_ble33_sense_microphone_continous/nano_ble33_sense_microphone_continuous.ino)
  *
  * @param[in]   handle struct with information about model and DSP
@@ -864,6 +877,9 @@ __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
 #if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
     init_data_normalization(handle);
 #endif
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+    inference_tflite_resident_init(handle);
+#endif
 }
 
 /**
@@ -880,6 +896,9 @@ __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
 extern "C" void run_classifier_deinit(void)
 {
     deinit_postprocessing(&ei_default_impulse);
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+    inference_tflite_resident_deinit(&ei_default_impulse);
+#endif
 }
 
 __attribute__((unused)) void run_classifier_deinit(ei_impulse_handle_t *handle)
@@ -888,6 +907,9 @@ __attribute__((unused)) void run_classifier_deinit(ei_impulse_handle_t *handle)
 #if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
     deinit_data_normalization(handle);
 #endif
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+    inference_tflite_resident_deinit(handle);
+#endif
 }
 
 /**
@@ -1069,6 +1091,234 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_classifier(
     return process_impulse(impulse, signal, result, debug);
 }
 
+/**
+ * @brief Run the classifier over a batch of raw features arrays, e.g. several crops of
+ *  the same camera frame.
+ *
+ * Every signal goes through the same preprocessing (DSP), inference and post-processing as
+ * [run_classifier()](#run_classifier-1). If the handle holds a resident interpreter (see
+ * `run_classifier_init()`) and the impulse can use the quantized image path, each signal
+ * is quantized straight into the input tensor and invoked back-to-back on that one
+ * interpreter, so the fixed per-call overhead is paid once per batch instead of once per
+ * signal. Otherwise the signals are classified one after another with `run_classifier()`.
+ *
+ * The bounding boxes (and classification arrays, if not statically allocated) of all
+ * results stay valid until the next call to `run_classifier_batch()` on the same handle.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] impulse Pointer to an `ei_impulse_handle_t` struct that contains the model and
+ *  preprocessing information.
+ * @param[in] signals Array of `n` pointers to `signal_t` structs, one per sample.
+ * @param[in] n Number of signals in `signals` and of results in `results`.
+ * @param[out] results Array of `n` `ei_impulse_result_t` structs, `results[i]` holds the
+ *  output for `signals[i]`.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. Will be `EI_IMPULSE_OK` if inference
+ *  completed successfully for all signals, otherwise the error of the first signal that failed.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_batch(
+    ei_impulse_handle_t *impulse,
+    signal_t **signals,
+    size_t n,
+    ei_impulse_result_t *results,
+    bool debug = false)
+{
+    if ((impulse == nullptr) || (impulse->impulse == nullptr) || (signals == nullptr) || (results == nullptr)) {
+        return EI_IMPULSE_INFERENCE_ERROR;
+    }
+
+    // post-processing reuses its output storage on every call, so keep a copy per batch
+    std::vector<ei_impulse_result_bounding_box_t> &batch_bounding_boxes = impulse->result_storage.batch_bounding_boxes;
+    batch_bounding_boxes.clear();
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    std::vector<ei_impulse_result_classification_t> &batch_classification = impulse->result_storage.batch_classification;
+    batch_classification.clear();
+    bool has_classification = impulse->impulse->results_type == EI_CLASSIFIER_TYPE_CLASSIFICATION ||
+                              impulse->impulse->results_type == EI_CLASSIFIER_TYPE_REGRESSION;
+#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+    bool back_to_back = impulse->inference_state != nullptr &&
+        impulse->impulse->results_type == EI_CLASSIFIER_TYPE_OBJECT_DETECTION &&
+        can_run_classifier_image_quantized(impulse->impulse, impulse->impulse->learning_blocks[0]) == EI_IMPULSE_OK;
+
+    uint8_t num_results = impulse->impulse->output_tensors_size;
+    std::unique_ptr<ei_feature_t[]> raw_results_ptr(back_to_back ? new ei_feature_t[num_results] : nullptr);
+#endif // EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+
+    for (size_t ix = 0; ix < n; ix++) {
+        ei_impulse_result_t *result = &results[ix];
+        EI_IMPULSE_ERROR res;
+
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+        if (back_to_back) {
+            memset(result, 0, sizeof(ei_impulse_result_t));
+            result->_raw_outputs = raw_results_ptr.get();
+            memset(result->_raw_outputs, 0, sizeof(ei_feature_t) * num_results);
+
+            res = run_nn_inference_image_quantized_resident(impulse, signals[ix], result, debug);
+            if (res == EI_IMPULSE_OK) {
+                res = run_postprocessing(impulse, result);
+            }
+            result->_raw_outputs = nullptr;
+        }
+        else
+#endif // EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+        {
+            res = process_impulse(impulse, signals[ix], result, debug);
+        }
+
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+
+        for (uint32_t bx = 0; bx < result->bounding_boxes_count; bx++) {
+            batch_bounding_boxes.push_back(result->bounding_boxes[bx]);
+        }
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+        if (has_classification) {
+            for (uint16_t cx = 0; cx < impulse->impulse->label_count; cx++) {
+                batch_classification.push_back(result->classification[cx]);
+            }
+        }
+#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    }
+
+    // the copies are complete (no more reallocation), point the results at them
+    size_t bounding_box_ix = 0;
+    for (size_t ix = 0; ix < n; ix++) {
+        results[ix].bounding_boxes = batch_bounding_boxes.data() + bounding_box_ix;
+        bounding_box_ix += results[ix].bounding_boxes_count;
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+        if (has_classification) {
+            results[ix].classification = batch_classification.data() + ix * impulse->impulse->label_count;
+        }
+#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    }
+
+    return EI_IMPULSE_OK;
+}
+
+#if EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+/**
+ * @brief Run an object detection (FOMO) impulse once over `tiles_x` impulse-sized images
+ *  placed side by side, e.g. a strip of digits.
+ *
+ * The signal holds an image of `tiles_x * EI_CLASSIFIER_INPUT_WIDTH` by
+ * `EI_CLASSIFIER_INPUT_HEIGHT` pixels. FOMO is fully convolutional, so instead of cutting
+ * the image into crops the model itself is widened: on the first call a copy of the model
+ * with `tiles_x` times wider tensors is built next to the resident interpreter (see
+ * `run_classifier_init()`), and every call is a single DSP pass and a single `Invoke()`.
+ * Tiles share their borders, so a cell next to a tile edge sees the pixels of the
+ * neighbouring tile instead of zero padding.
+ *
+ * Bounding boxes are in pixels of the whole image, never span two tiles, and
+ * `x / EI_CLASSIFIER_INPUT_WIDTH` is the index of the tile they were found in. They stay
+ * valid until the next call to `run_classifier_image_tiled()` on the same handle.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] impulse Pointer to an initialized `ei_impulse_handle_t` struct.
+ * @param[in] signal Pointer to a `signal_t` struct with the whole (widened) image.
+ * @param[in] tiles_x Number of tiles along the width.
+ * @param[out] result Pointer to an `ei_impulse_result_t` struct that will contain the bounding boxes.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. `EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE`
+ *  if the handle has no resident interpreter or the impulse is not a quantized FOMO model, in
+ *  which case the caller can fall back to `run_classifier_batch()` on the crops.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_image_tiled(
+    ei_impulse_handle_t *impulse,
+    signal_t *signal,
+    uint32_t tiles_x,
+    ei_impulse_result_t *result,
+    bool debug = false)
+{
+    if ((impulse == nullptr) || (impulse->impulse == nullptr) || (signal == nullptr) || (result == nullptr) || (tiles_x == 0)) {
+        return EI_IMPULSE_INFERENCE_ERROR;
+    }
+
+    const ei_impulse_t *model = impulse->impulse;
+    if (impulse->inference_state == nullptr ||
+        model->postprocessing_blocks_size != 1 ||
+        model->postprocessing_blocks[0].postprocess_fn != process_fomo_i8 ||
+        can_run_classifier_image_quantized(model, model->learning_blocks[0]) != EI_IMPULSE_OK) {
+        return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
+    }
+
+    memset(result, 0, sizeof(ei_impulse_result_t));
+
+    uint8_t num_results = model->output_tensors_size;
+    std::unique_ptr<ei_feature_t[]> raw_results_ptr(new ei_feature_t[num_results]);
+    result->_raw_outputs = raw_results_ptr.get();
+    memset(result->_raw_outputs, 0, sizeof(ei_feature_t) * num_results);
+
+    EI_IMPULSE_ERROR res = run_nn_inference_image_quantized_resident_tiled(impulse, signal, tiles_x, result, debug);
+    if (res == EI_IMPULSE_OK) {
+        ei_trace_begin("ei_postprocess");
+        res = process_fomo_i8_tiled(impulse,
+                                    model->postprocessing_blocks[0].input_block_id,
+                                    result,
+                                    model->postprocessing_blocks[0].config,
+                                    tiles_x);
+        ei_trace_end("ei_postprocess");
+    }
+
+    for (size_t ix = 0; ix < num_results; ix++) {
+        if (result->_raw_outputs[ix].matrix) {
+            delete result->_raw_outputs[ix].matrix;
+        }
+    }
+    result->_raw_outputs = nullptr;
+
+    return res;
+}
+
+/**
+ * @brief Tensor arena bytes used by the resident interpreters of a handle.
+ *
+ * The high-water mark of the arenas allocated by `run_classifier_init()` (and the tiled
+ * interpreter of `run_classifier_image_tiled()`, once built): what the arena sizes could be
+ * trimmed to.
+ *
+ * @param[in] impulse Pointer to an initialized `ei_impulse_handle_t` struct.
+ *
+ * @return Bytes in use, 0 if the handle has no resident interpreter.
+ */
+__attribute__((unused)) size_t run_classifier_arena_used(ei_impulse_handle_t *impulse)
+{
+    if (impulse == nullptr) {
+        return 0;
+    }
+    return inference_tflite_resident_arena_used(impulse);
+}
+
+#if EI_CLASSIFIER_OP_PROFILER == 1
+/**
+ * @brief Per-op profiler of a resident interpreter of a handle.
+ *
+ * Accumulates the time of every op type over all inferences since the interpreter was
+ * built (or since `reset()`), see `ei_op_profiler_t`. Nothing is printed.
+ *
+ * @param[in] impulse Pointer to an initialized `ei_impulse_handle_t` struct.
+ * @param[in] tiled The interpreter of `run_classifier_image_tiled()` instead of the one
+ *                  built by `run_classifier_init()`.
+ *
+ * @return The profiler, nullptr if that interpreter does not exist (yet).
+ */
+__attribute__((unused)) ei_op_profiler_t* run_classifier_op_profiler(ei_impulse_handle_t *impulse, bool tiled = false)
+{
+    if (impulse == nullptr) {
+        return nullptr;
+    }
+    return inference_tflite_resident_op_profiler(impulse, tiled);
+}
+#endif // EI_CLASSIFIER_OP_PROFILER == 1
+#endif // EI_CLASSIFIER_HAS_TFLITE_RESIDENT == 1
+
 #if EI_CLASSIFIER_FREEFORM_OUTPUT
 /**
  * Set the location for freeform outputs. For impulses with freeform output the application needs to allocate
@@ -40,6 +40,7 @@
 #include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
 #include "edge-impulse-sdk/classifier/ei_signal_with_range.h"
 #include "edge-impulse-sdk/dsp/ei_flatten.h"
+#include "edge-impulse-sdk/dsp/image/processing.hpp"
 #include "model-parameters/model_metadata.h"
 
 #if EI_CLASSIFIER_HR_ENABLED
@@ -1262,20 +1263,176 @@ __attribute__((unused)) int extract_drpai_features_quantized(signal_t *signal, m
 
 #if (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1) && (EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_DRPAI)
 
+/**
+ * Quantize one pixel into channel_count (1 or 3) values of out, the conversion every image
+ * signal goes through (whether it is read through get_data() or from a raw image)
+ */
+static inline void quantize_image_pixel(int32_t r, int32_t g, int32_t b, int16_t channel_count, float scale, float zero_point,
+                                        int image_scaling, int8_t *out) {
+    const int32_t iRedToGray = (int32_t)(0.299f * 65536.0f);
+    const int32_t iGreenToGray = (int32_t)(0.587f * 65536.0f);
+    const int32_t iBlueToGray = (int32_t)(0.114f * 65536.0f);
+
+    static const float torch_mean[] = { 0.485, 0.456, 0.406 };
+    static const float torch_std[] = { 0.229, 0.224, 0.225 };
+
+    if (channel_count == 3) {
+        // fast code path
+        if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+            out[0] = static_cast<int8_t>(r + zero_point);
+            out[1] = static_cast<int8_t>(g + zero_point);
+            out[2] = static_cast<int8_t>(b + zero_point);
+        }
+        // slow code path
+        else {
+            float rf = static_cast<float>(r);
+            float gf = static_cast<float>(g);
+            float bf = static_cast<float>(b);
+
+            if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+                rf /= 255.0f;
+                gf /= 255.0f;
+                bf /= 255.0f;
+            }
+            else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
+                rf /= 255.0f;
+                gf /= 255.0f;
+                bf /= 255.0f;
+
+                rf = (rf - torch_mean[0]) / torch_std[0];
+                gf = (gf - torch_mean[1]) / torch_std[1];
+                bf = (bf - torch_mean[2]) / torch_std[2];
+            }
+            else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
+                rf -= 128.0f;
+                gf -= 128.0f;
+                bf -= 128.0f;
+            }
+
+            out[0] = static_cast<int8_t>(round(rf / scale) + zero_point);
+            out[1] = static_cast<int8_t>(round(gf / scale) + zero_point);
+            out[2] = static_cast<int8_t>(round(bf / scale) + zero_point);
+        }
+    }
+    else {
+        // fast code path
+        if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+            // ITU-R 601-2 luma transform
+            // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
+            int32_t gray = (iRedToGray * r) + (iGreenToGray * g) + (iBlueToGray * b);
+            gray >>= 16; // scale down to int8_t
+            gray += zero_point;
+            if (gray < - 128) gray = -128;
+            else if (gray > 127) gray = 127;
+            out[0] = static_cast<int8_t>(gray);
+        }
+        // slow code path
+        else {
+            float rf = static_cast<float>(r);
+            float gf = static_cast<float>(g);
+            float bf = static_cast<float>(b);
+
+            if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+                rf /= 255.0f;
+                gf /= 255.0f;
+                bf /= 255.0f;
+            }
+            else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
+                rf /= 255.0f;
+                gf /= 255.0f;
+                bf /= 255.0f;
+
+                rf = (rf - torch_mean[0]) / torch_std[0];
+                gf = (gf - torch_mean[1]) / torch_std[1];
+                bf = (bf - torch_mean[2]) / torch_std[2];
+            }
+            else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
+                rf -= 128.0f;
+                gf -= 128.0f;
+                bf -= 128.0f;
+            }
+
+            // ITU-R 601-2 luma transform
+            // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
+            float v = (0.299f * rf) + (0.587f * gf) + (0.114f * bf);
+            out[0] = static_cast<int8_t>(round(v / scale) + zero_point);
+        }
+    }
+}
+
+/**
+ * Quantize a raw 8-bit image (signal->image) straight into the output, no float page and no
+ * allocation. A GRAY8 pixel is used as is for a Grayscale block (no luma transform) and
+ * replicated into R, G and B for an RGB block.
+ */
+static int extract_image_features_quantized_from_image(const ei_signal_image_t *image, size_t total_length, matrix_i8_t *output_matrix,
+                                                       int16_t channel_count, float scale, float zero_point, int image_scaling) {
+    if (image->width * image->height != total_length ||
+        output_matrix->rows * output_matrix->cols < total_length * channel_count) {
+        EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+    }
+
+    int8_t *out = output_matrix->buffer;
+
+    const int pixel_size = image->format == EI_SIGNAL_IMAGE_GRAY8 ? 1 : 3;
+
+    // fast code path, crop + gray + quantize in one pass of the fused image kernel
+    if (channel_count == 1 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE &&
+        image->stride % pixel_size == 0) {
+        return ei::image::processing::crop_and_quantize_gray_i8(image->data, image->stride / pixel_size, image->height,
+            pixel_size, 0, 0, image->width, image->height, scale, zero_point, out);
+    }
+
+    for (size_t y = 0; y < image->height; y++) {
+        const uint8_t *row = image->data + y * image->stride;
+        for (size_t x = 0; x < image->width; x++) {
+            int32_t r, g, b;
+            if (image->format == EI_SIGNAL_IMAGE_GRAY8) {
+                r = g = b = row[x];
+            }
+            else {
+                r = row[x * 3];
+                g = row[x * 3 + 1];
+                b = row[x * 3 + 2];
+            }
+
+            if (image->format == EI_SIGNAL_IMAGE_GRAY8 && channel_count == 1) {
+                // same as the fast code path above: no luma transform on a luma pixel
+                float v = static_cast<float>(r);
+                if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
+                    v -= 128.0f;
+                }
+                else {
+                    v /= 255.0f;
+                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
+                        // torch normalization of a gray pixel, channel weights as in the luma transform
+                        v = (0.299f * (v - 0.485f) / 0.229f) + (0.587f * (v - 0.456f) / 0.224f) + (0.114f * (v - 0.406f) / 0.225f);
+                    }
+                }
+                *out++ = static_cast<int8_t>(round(v / scale) + zero_point);
+                continue;
+            }
+
+            quantize_image_pixel(r, g, b, channel_count, scale, zero_point, image_scaling, out);
+            out += channel_count;
+        }
+    }
+
+    return EIDSP_OK;
+}
+
 __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, matrix_i8_t *output_matrix, void *config_ptr, float scale, float zero_point, const float frequency,
                                                              int image_scaling) {
     ei_dsp_config_image_t config = *((ei_dsp_config_image_t*)config_ptr);
 
     int16_t channel_count = strcmp(config.channels, "Grayscale") == 0 ? 1 : 3;
 
-    size_t output_ix = 0;
-
-    const int32_t iRedToGray = (int32_t)(0.299f * 65536.0f);
-    const int32_t iGreenToGray = (int32_t)(0.587f * 65536.0f);
-    const int32_t iBlueToGray = (int32_t)(0.114f * 65536.0f);
+    if (signal->image) {
+        return extract_image_features_quantized_from_image(signal->image, signal->total_length, output_matrix,
+            channel_count, scale, zero_point, image_scaling);
+    }
 
-    static const float torch_mean[] = { 0.485, 0.456, 0.406 };
-    static const float torch_std[] = { 0.229, 0.224, 0.225 };
+    size_t output_ix = 0;
 
 #if defined(EI_DSP_IMAGE_BUFFER_STATIC_SIZE)
     const size_t page_size = EI_DSP_IMAGE_BUFFER_STATIC_SIZE;
@@ -1301,96 +1458,10 @@ __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, m
         for (size_t jx = 0; jx < elements_to_read; jx++) {
             uint32_t pixel = static_cast<uint32_t>(input_matrix.buffer[jx]);
 
-            if (channel_count == 3) {
-                // fast code path
-                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
-                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
-                    int32_t b = static_cast<int32_t>(pixel & 0xff);
-
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(r + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(g + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(b + zero_point);
-                }
-                // slow code path
-                else {
-                    float r = static_cast<float>(pixel >> 16 & 0xff);
-                    float g = static_cast<float>(pixel >> 8 & 0xff);
-                    float b = static_cast<float>(pixel & 0xff);
-
-                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-
-                        r = (r - torch_mean[0]) / torch_std[0];
-                        g = (g - torch_mean[1]) / torch_std[1];
-                        b = (b - torch_mean[2]) / torch_std[2];
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
-                        r -= 128.0f;
-                        g -= 128.0f;
-                        b -= 128.0f;
-                    }
-
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(r / scale) + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(g / scale) + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(b / scale) + zero_point);
-                }
-            }
-            else {
-                // fast code path
-                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
-                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
-                    int32_t b = static_cast<int32_t>(pixel & 0xff);
-
-                    // ITU-R 601-2 luma transform
-                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
-                    int32_t gray = (iRedToGray * r) + (iGreenToGray * g) + (iBlueToGray * b);
-                    gray >>= 16; // scale down to int8_t
-                    gray += zero_point;
-                    if (gray < - 128) gray = -128;
-                    else if (gray > 127) gray = 127;
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(gray);
-                }
-                // slow code path
-                else {
-                    float r = static_cast<float>(pixel >> 16 & 0xff);
-                    float g = static_cast<float>(pixel >> 8 & 0xff);
-                    float b = static_cast<float>(pixel & 0xff);
-
-                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-
-                        r = (r - torch_mean[0]) / torch_std[0];
-                        g = (g - torch_mean[1]) / torch_std[1];
-                        b = (b - torch_mean[2]) / torch_std[2];
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
-                        r -= 128.0f;
-                        g -= 128.0f;
-                        b -= 128.0f;
-                    }
-
-                    // ITU-R 601-2 luma transform
-                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
-                    float v = (0.299f * r) + (0.587f * g) + (0.114f * b);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(v / scale) + zero_point);
-                }
-            }
+            quantize_image_pixel(static_cast<int32_t>(pixel >> 16 & 0xff), static_cast<int32_t>(pixel >> 8 & 0xff),
+                static_cast<int32_t>(pixel & 0xff), channel_count, scale, zero_point, image_scaling,
+                &output_matrix->buffer[output_ix]);
+            output_ix += channel_count;
         }
 
         bytes_left -= elements_to_read;
@@ -44,7 +44,9 @@
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_interpreter.h"
 #include "edge-impulse-sdk/tensorflow/lite/schema/schema_generated.h"
 #include "edge-impulse-sdk/tensorflow/lite/schema/schema_generated_full.h"
+#include "edge-impulse-sdk/tensorflow/lite/schema/schema_utils.h"
 #include "edge-impulse-sdk/classifier/ei_aligned_malloc.h"
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
 #include "edge-impulse-sdk/classifier/ei_model_types.h"
 #include "edge-impulse-sdk/classifier/inferencing_engines/tflite_helper.h"
 
@@ -52,8 +54,14 @@
 #include "tflite-model/tflite-resolver.h"
 #endif // EI_CLASSIFIER_HAS_TFLITE_OPS_RESOLVER
 
-#ifdef EI_CLASSIFIER_ENABLE_PROFILER
-#include "edge-impulse-sdk/tensorflow/lite/micro/micro_profiler.h"
+// Per-op timing of the resident interpreters (ei_op_profiler_t, two timer reads per node),
+// off unless the build defines EI_CLASSIFIER_OP_PROFILER=1 (also read by micro_graph.cc)
+#ifndef EI_CLASSIFIER_OP_PROFILER
+#define EI_CLASSIFIER_OP_PROFILER 0
+#endif
+
+#if EI_CLASSIFIER_OP_PROFILER == 1
+#include "edge-impulse-sdk/classifier/inferencing_engines/tflite_op_profiler.h"
 #endif
 
 #ifdef EI_CLASSIFIER_ALLOCATION_STATIC
@@ -88,6 +96,23 @@
 #define DEFINE_SECTION(x) __attribute__((section(x)))
 #endif
 
+/**
+ * Op resolver shared by every interpreter. Built once (function-local statics are
+ * initialized thread-safely) and only read afterwards; it must outlive the interpreters.
+ */
+static const tflite::MicroOpResolver& inference_tflite_resolver() {
+#ifdef EI_TFLITE_RESOLVER
+    static const tflite::MicroOpResolver *shared_resolver = []() -> const tflite::MicroOpResolver* {
+        EI_TFLITE_RESOLVER
+        return &resolver;
+    }();
+    return *shared_resolver;
+#else
+    static tflite::AllOpsResolver resolver;
+    return resolver;
+#endif
+}
+
 /**
  * Setup the TFLite runtime
  *
@@ -96,6 +121,7 @@
  * @param      output             Pointer to output tensor
  * @param      micro_interpreter  Pointer to interpreter (for non-compiled models)
  * @param      micro_tensor_arena Pointer to the arena that will be allocated
+ * @param      profiler           Profiler of the interpreter (nullptr: none), must outlive it
  *
  * @return  EI_IMPULSE_OK if successful
  */
@@ -106,7 +132,7 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
     TfLiteTensor** outputs,
     tflite::MicroInterpreter** micro_interpreter,
     ei_unique_ptr_t& p_tensor_arena,
-    void** micro_profiler) {
+    tflite::MicroProfilerInterface* profiler) {
 
     *ctx_start_us = ei_read_timer_us();
 
@@ -126,57 +152,25 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
     p_tensor_arena = ei_unique_ptr_t(tensor_arena, ei_aligned_free);
 #endif
 
-    static bool tflite_first_run = true;
-    static uint8_t *model_arr = NULL;
-
-    if (model_arr != graph_config->model) {
-        tflite_first_run = true;
-        model_arr = (uint8_t*)graph_config->model;
-    }
-
-    static const tflite::Model* model = nullptr;
-
-    // ======
-    // Initialization code start
-    // This part can be run once, but that would require the TFLite arena
-    // to be allocated at all times, which is not ideal (e.g. when doing MFCC)
-    // ======
-    if (tflite_first_run) {
-        // Map the model into a usable data structure. This doesn't involve any
-        // copying or parsing, it's a very lightweight operation.
-        model = tflite::GetModel(graph_config->model);
-        if (model->version() != TFLITE_SCHEMA_VERSION) {
-            ei_printf(
-                "Model provided is schema version %d not equal "
-                "to supported version %d.",
-                model->version(), TFLITE_SCHEMA_VERSION);
-            return EI_IMPULSE_TFLITE_ERROR;
-        }
-        tflite_first_run = false;
+    // Map the model into a usable data structure. This doesn't involve any
+    // copying or parsing, it's a very lightweight operation. Kept local (and the
+    // resolver below is shared read-only) so interpreters can be set up and run
+    // from different tasks.
+    const tflite::Model* model = tflite::GetModel(graph_config->model);
+    if (model->version() != TFLITE_SCHEMA_VERSION) {
+        ei_printf(
+            "Model provided is schema version %d not equal "
+            "to supported version %d.",
+            model->version(), TFLITE_SCHEMA_VERSION);
+        return EI_IMPULSE_TFLITE_ERROR;
     }
 
-#ifdef EI_TFLITE_RESOLVER
-    EI_TFLITE_RESOLVER
-#else
-    static tflite::AllOpsResolver resolver; // needs static to match the life of the interpreter
-#endif
+    const tflite::MicroOpResolver &resolver = inference_tflite_resolver();
 
     // Build an interpreter to run the model with.
-    // only create profiler when enabled
-#ifdef EI_CLASSIFIER_ENABLE_PROFILER
-    tflite::MicroProfiler *profiler = new tflite::MicroProfiler;
-
     tflite::MicroInterpreter *interpreter = new tflite::MicroInterpreter(
         model, resolver, tensor_arena, graph_config->arena_size, nullptr, profiler);
 
-    *micro_profiler = (void*)profiler;
-#else
-    tflite::MicroInterpreter *interpreter = new tflite::MicroInterpreter(
-        model, resolver, tensor_arena, graph_config->arena_size, nullptr, nullptr);
-
-    micro_profiler = nullptr;
-#endif
-
     *micro_interpreter = interpreter;
 
     // Allocate memory from the tensor_arena for the model's tensors.
@@ -192,10 +186,6 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
         outputs[i] = interpreter->output(block_config->output_tensors_indices[i]);
     }
 
-    if (tflite_first_run) {
-        tflite_first_run = false;
-    }
-
     return EI_IMPULSE_OK;
 }
 
@@ -204,8 +194,7 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
  *
  * @param   ctx_start_us    Start time of the setup function (see above)
  * @param   output          Output tensor
- * @param   interpreter     TFLite interpreter (non-compiled models)
- * @param   tensor_arena    Allocated arena (will be freed)
+ * @param   interpreter     TFLite interpreter (non-compiled models), not freed
  * @param   result          Struct for results
  * @param   debug           Whether to print debug info
  *
@@ -218,9 +207,18 @@ static EI_IMPULSE_ERROR inference_tflite_run(
     void* micro_profiler) {
 
     // Run inference, and report any error
+    // the interpreter is owned (and deleted) by the caller, it may be resident
+#if EI_CLASSIFIER_OP_PROFILER == 1
+    ei_op_profiler_t *profiler = (ei_op_profiler_t*)micro_profiler;
+    if (profiler) profiler->begin_invoke();
+#endif
+    ei_trace_begin("ei_invoke");
     TfLiteStatus invoke_status = interpreter->Invoke();
+    ei_trace_end("ei_invoke");
+#if EI_CLASSIFIER_OP_PROFILER == 1
+    if (profiler) profiler->end_invoke();
+#endif
     if (invoke_status != kTfLiteOk) {
-        delete interpreter;
         ei_printf("Invoke failed (%d)\n", invoke_status);
         return EI_IMPULSE_TFLITE_ERROR;
     }
@@ -232,18 +230,6 @@ static EI_IMPULSE_ERROR inference_tflite_run(
 
     EI_LOGD("Predictions (time: %d ms.):\n", result->timing.classification);
 
-#ifdef EI_CLASSIFIER_ENABLE_PROFILER
-    tflite::MicroProfiler *profiler = (tflite::MicroProfiler*)micro_profiler;
-
-    ei_printf("Profiling per individual OP\n");
-    profiler->LogCsv();
-    ei_printf("\n");
-
-    ei_printf("Profiling per OP group\n");
-    profiler->LogTicksPerTagCsv();
-    ei_printf("\n");
-#endif
-
     if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
         return EI_IMPULSE_CANCELED;
     }
@@ -273,11 +259,6 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
     ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
 
     tflite::MicroInterpreter* interpreter;
-#ifdef EI_CLASSIFIER_ENABLE_PROFILER
-    tflite::MicroProfiler* profiler;
-#else
-    void* profiler = nullptr;
-#endif
 
     EI_IMPULSE_ERROR init_res = inference_tflite_setup(
         block_config,
@@ -286,7 +267,7 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
         outputs,
         &interpreter,
         p_tensor_arena,
-        (void**)&profiler);
+        nullptr);
 
     if (init_res != EI_IMPULSE_OK) {
         return init_res;
@@ -298,7 +279,9 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
     }
 
     // Run inference, and report any error
+    ei_trace_begin("ei_invoke");
     TfLiteStatus invoke_status = interpreter->Invoke();
+    ei_trace_end("ei_invoke");
     if (invoke_status != kTfLiteOk) {
         ei_printf("Invoke failed (%d)\n", invoke_status);
         return EI_IMPULSE_TFLITE_ERROR;
@@ -343,11 +326,6 @@ EI_IMPULSE_ERROR run_nn_inference(
     ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
 
     tflite::MicroInterpreter* interpreter;
-#ifdef EI_CLASSIFIER_ENABLE_PROFILER
-    tflite::MicroProfiler* profiler;
-#else
-    void* profiler = nullptr;
-#endif
 
     EI_IMPULSE_ERROR init_res = inference_tflite_setup(
         block_config,
@@ -356,12 +334,14 @@ EI_IMPULSE_ERROR run_nn_inference(
         outputs,
         &interpreter,
         p_tensor_arena,
-        (void**)&profiler);
+        nullptr);
 
     if (init_res != EI_IMPULSE_OK) {
         return init_res;
     }
 
+    result->timing.setup_us = ei_read_timer_us() - ctx_start_us;
+
     auto input_res = fill_input_tensor_from_matrix(fmatrix,
                                                    result->_raw_outputs,
                                                    input,
@@ -377,7 +357,7 @@ EI_IMPULSE_ERROR run_nn_inference(
         ctx_start_us,
         interpreter,
         result,
-        profiler);
+        nullptr);
 
     for (uint32_t output_ix = 0; output_ix < block_config->output_tensors_size; output_ix++) {
         TfLiteTensor *output = outputs[output_ix];
@@ -436,47 +416,21 @@ EI_IMPULSE_ERROR run_nn_inference(
 
 #if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
 /**
- * Special function to run the classifier on images, only works on TFLite models (either interpreter or EON or for tensaiflow)
- * that allocates a lot less memory by quantizing in place. This only works if 'can_run_classifier_image_quantized'
- * returns EI_IMPULSE_OK.
+ * Run the image DSP straight into the (quantized) input tensor of an interpreter that
+ * has already been set up, invoke it and copy the output tensors into the result.
+ * The interpreter, tensors and arena are not freed here.
  */
-EI_IMPULSE_ERROR run_nn_inference_image_quantized(
+static EI_IMPULSE_ERROR inference_tflite_image_quantized_run(
     const ei_impulse_t *impulse,
     signal_t *signal,
     uint32_t learn_block_index,
     ei_impulse_result_t *result,
-    void *config_ptr,
-    bool debug = false)
+    ei_learning_block_config_tflite_graph_t *block_config,
+    tflite::MicroInterpreter *interpreter,
+    TfLiteTensor *input,
+    TfLiteTensor **outputs,
+    void *profiler)
 {
-    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
-
-    uint64_t ctx_start_us;
-
-    TfLiteTensor* input = nullptr; // will be owned by TFLite
-    TfLiteTensor** outputs = (TfLiteTensor**)ei_malloc(block_config->output_tensors_size * sizeof(TfLiteTensor*));
-
-    ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
-
-    tflite::MicroInterpreter* interpreter;
-#ifdef EI_CLASSIFIER_ENABLE_PROFILER
-    tflite::MicroProfiler* profiler;
-#else
-    void* profiler = nullptr;
-#endif
-
-    EI_IMPULSE_ERROR init_res = inference_tflite_setup(
-        block_config,
-        &ctx_start_us,
-        &input,
-        outputs,
-        &interpreter,
-        p_tensor_arena,
-        (void**)&profiler);
-
-    if (init_res != EI_IMPULSE_OK) {
-        return init_res;
-    }
-
     if (input->type != TfLiteType::kTfLiteInt8 && input->type != TfLiteType::kTfLiteUInt8) {
         return EI_IMPULSE_ONLY_SUPPORTED_FOR_IMAGES;
     }
@@ -484,11 +438,13 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     uint64_t dsp_start_us = ei_read_timer_us();
 
     // features matrix maps around the input tensor to not allocate any memory
-    ei::matrix_i8_t features_matrix(1, impulse->nn_input_frame_size, input->data.int8);
+    ei::matrix_i8_t features_matrix(1, input->bytes, input->data.int8);
 
     // run DSP process and quantize automatically
+    ei_trace_begin("ei_dsp");
     int ret = extract_image_features_quantized(signal, &features_matrix, impulse->dsp_blocks[0].config, input->params.scale, input->params.zero_point,
         impulse->frequency, impulse->learning_blocks[0].image_scaling);
+    ei_trace_end("ei_dsp");
     if (ret != EIDSP_OK) {
         ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
         return EI_IMPULSE_DSP_ERROR;
@@ -510,7 +466,7 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     ei_printf("\n");
 #endif
 
-    ctx_start_us = ei_read_timer_us();
+    uint64_t ctx_start_us = ei_read_timer_us();
 
     EI_IMPULSE_ERROR run_res = inference_tflite_run(
         ctx_start_us,
@@ -518,6 +474,10 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
         result,
         profiler);
 
+    if (run_res != EI_IMPULSE_OK) {
+        return run_res;
+    }
+
     for (uint32_t output_ix = 0; output_ix < block_config->output_tensors_size; output_ix++) {
         TfLiteTensor* output = outputs[output_ix];
         // calculate the size of the output by iterating through dims
@@ -563,15 +523,489 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
         result->_raw_outputs[learn_block_index + output_ix].blockId = block_config->block_id + output_ix;
     }
 
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * Special function to run the classifier on images, only works on TFLite models (either interpreter or EON or for tensaiflow)
+ * that allocates a lot less memory by quantizing in place. This only works if 'can_run_classifier_image_quantized'
+ * returns EI_IMPULSE_OK.
+ */
+EI_IMPULSE_ERROR run_nn_inference_image_quantized(
+    const ei_impulse_t *impulse,
+    signal_t *signal,
+    uint32_t learn_block_index,
+    ei_impulse_result_t *result,
+    void *config_ptr,
+    bool debug = false)
+{
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+
+    uint64_t ctx_start_us;
+
+    TfLiteTensor* input = nullptr; // will be owned by TFLite
+    TfLiteTensor** outputs = (TfLiteTensor**)ei_malloc(block_config->output_tensors_size * sizeof(TfLiteTensor*));
+
+    ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
+
+    tflite::MicroInterpreter* interpreter;
+
+    EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        block_config,
+        &ctx_start_us,
+        &input,
+        outputs,
+        &interpreter,
+        p_tensor_arena,
+        nullptr);
+
+    if (init_res != EI_IMPULSE_OK) {
+        return init_res;
+    }
+
+    result->timing.setup_us = ei_read_timer_us() - ctx_start_us;
+
+    EI_IMPULSE_ERROR run_res = inference_tflite_image_quantized_run(
+        impulse,
+        signal,
+        learn_block_index,
+        result,
+        block_config,
+        interpreter,
+        input,
+        outputs,
+        nullptr);
+
     delete interpreter;
     ei_free(outputs);
 
-    if (run_res != EI_IMPULSE_OK) {
-        return run_res;
+    return run_res;
+}
+
+#if EI_CLASSIFIER_TFLITE_RESIDENT_INTERPRETER == 1
+#define EI_CLASSIFIER_HAS_TFLITE_RESIDENT           1
+
+/**
+ * Width of a 4D (NHWC) tensor, -1 if the tensor is not 4D
+ */
+static int32_t inference_tflite_tensor_width(const tflite::Tensor *tensor)
+{
+    if (!tensor->shape() || tensor->shape()->size() != 4) {
+        return -1;
+    }
+    return tensor->shape()->Get(2);
+}
+
+/**
+ * Rewrite the tensor shapes of a (writable) copy of a fully convolutional NHWC graph so it
+ * takes an input that is tiles_x times wider. Output widths are propagated op by op, the
+ * same way the converter computed them. Weights and the height dimension are untouched.
+ * Only the ops a FOMO model is made of are supported (conv, depthwise conv, pad and
+ * shape preserving ops), anything else is refused.
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR inference_tflite_widen_model(uint8_t *model_data, uint32_t tiles_x)
+{
+    const tflite::Model *model = tflite::GetModel(model_data);
+    if (model->version() != TFLITE_SCHEMA_VERSION || model->subgraphs()->size() != 1) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+
+    // offline planned arenas are only valid for the original shapes
+    if (model->metadata()) {
+        for (auto metadata : *model->metadata()) {
+            if (metadata->name() && strcmp(metadata->name()->c_str(), "OfflineMemoryAllocation") == 0) {
+                return EI_IMPULSE_TFLITE_ERROR;
+            }
+        }
+    }
+
+    const tflite::SubGraph *subgraph = model->subgraphs()->Get(0);
+    auto tensors = subgraph->tensors();
+
+    auto set_width = [&](int32_t tensor_ix, int32_t width) {
+        auto shape = const_cast<flatbuffers::Vector<int32_t>*>(tensors->Get(tensor_ix)->shape());
+        shape->Mutate(2, width);
+    };
+
+    int32_t input_ix = subgraph->inputs()->Get(0);
+    int32_t input_width = inference_tflite_tensor_width(tensors->Get(input_ix));
+    if (subgraph->inputs()->size() != 1 || input_width <= 0) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+    set_width(input_ix, input_width * tiles_x);
+
+    for (auto op : *subgraph->operators()) {
+        auto op_code = model->operator_codes()->Get(op->opcode_index());
+        int32_t in_width = inference_tflite_tensor_width(tensors->Get(op->inputs()->Get(0)));
+        int32_t out_ix = op->outputs()->Get(0);
+        int32_t out_width;
+
+        if (in_width <= 0 || op->outputs()->size() != 1) {
+            return EI_IMPULSE_TFLITE_ERROR;
+        }
+
+        switch (tflite::GetBuiltinCode(op_code)) {
+            case tflite::BuiltinOperator_CONV_2D:
+            case tflite::BuiltinOperator_DEPTHWISE_CONV_2D: {
+                tflite::Padding padding;
+                int32_t stride, dilation;
+                if (op->builtin_options_type() == tflite::BuiltinOptions_Conv2DOptions) {
+                    auto options = op->builtin_options_as_Conv2DOptions();
+                    padding = options->padding();
+                    stride = options->stride_w();
+                    dilation = options->dilation_w_factor();
+                }
+                else {
+                    auto options = op->builtin_options_as_DepthwiseConv2DOptions();
+                    padding = options->padding();
+                    stride = options->stride_w();
+                    dilation = options->dilation_w_factor();
+                }
+                // OHWI for conv, 1HWO for depthwise conv, filter width is dim 2 for both
+                int32_t filter_width = inference_tflite_tensor_width(tensors->Get(op->inputs()->Get(1)));
+                if (filter_width <= 0 || stride <= 0) {
+                    return EI_IMPULSE_TFLITE_ERROR;
+                }
+                if (padding == tflite::Padding_SAME) {
+                    out_width = (in_width + stride - 1) / stride;
+                }
+                else {
+                    out_width = (in_width - ((filter_width - 1) * dilation + 1)) / stride + 1;
+                }
+                break;
+            }
+            case tflite::BuiltinOperator_PAD: {
+                // paddings is a constant [4, 2] tensor, the width paddings are in row 2
+                const tflite::Tensor *paddings = tensors->Get(op->inputs()->Get(1));
+                auto buffer = model->buffers()->Get(paddings->buffer());
+                if (paddings->type() != tflite::TensorType_INT32 || !buffer->data() || buffer->data()->size() != 8 * sizeof(int32_t)) {
+                    return EI_IMPULSE_TFLITE_ERROR;
+                }
+                int32_t pads[8];
+                memcpy(pads, buffer->data()->data(), sizeof(pads));
+                out_width = in_width + pads[2 * 2] + pads[2 * 2 + 1];
+                break;
+            }
+            case tflite::BuiltinOperator_ADD:
+            case tflite::BuiltinOperator_MUL: {
+                // no broadcasting along the width
+                if (inference_tflite_tensor_width(tensors->Get(op->inputs()->Get(1))) != in_width) {
+                    return EI_IMPULSE_TFLITE_ERROR;
+                }
+                out_width = in_width;
+                break;
+            }
+            case tflite::BuiltinOperator_SOFTMAX:
+            case tflite::BuiltinOperator_RELU:
+            case tflite::BuiltinOperator_RELU6:
+            case tflite::BuiltinOperator_LOGISTIC:
+            case tflite::BuiltinOperator_QUANTIZE:
+            case tflite::BuiltinOperator_DEQUANTIZE:
+                out_width = in_width;
+                break;
+            default:
+                ei_printf("ERR: Cannot widen model, unsupported op (%d)\n", (int)tflite::GetBuiltinCode(op_code));
+                return EI_IMPULSE_TFLITE_ERROR;
+        }
+
+        if (out_width <= 0 || inference_tflite_tensor_width(tensors->Get(out_ix)) <= 0) {
+            return EI_IMPULSE_TFLITE_ERROR;
+        }
+        set_width(out_ix, out_width);
+    }
+
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * Interpreter, tensor arena and tensor pointers of the first learning block, kept
+ * between inferences. Owned by an ei_impulse_handle_t (handle->inference_state).
+ */
+class ei_tflite_resident_t {
+public:
+    ei_tflite_resident_t(ei_learning_block_config_tflite_graph_t *block_config)
+        : block_config(block_config)
+        , tensor_arena(nullptr, ei_aligned_free)
+    {
+        outputs = (TfLiteTensor**)ei_calloc(block_config->output_tensors_size, sizeof(TfLiteTensor*));
+    }
+
+    ~ei_tflite_resident_t()
+    {
+        delete tiled;
+        delete interpreter;
+#if EI_CLASSIFIER_OP_PROFILER == 1
+        delete (ei_op_profiler_t*)profiler;
+#endif
+        ei_free(outputs);
+    }
+
+    void* operator new(size_t size) {
+        return ei_malloc(size);
+    }
+
+    void operator delete(void* ptr) {
+        ei_free(ptr);
+    }
+
+    ei_learning_block_config_tflite_graph_t *block_config;
+    ei_unique_ptr_t tensor_arena;
+    tflite::MicroInterpreter *interpreter = nullptr;
+    TfLiteTensor *input = nullptr;
+    TfLiteTensor **outputs = nullptr;
+    void *profiler = nullptr;   // ei_op_profiler_t with EI_CLASSIFIER_OP_PROFILER
+    uint64_t setup_us = 0;
+
+    // interpreter on a tiles_x times wider copy of the model, built on first use
+    ei_tflite_resident_t *tiled = nullptr;
+    uint32_t tiles_x = 1;
+
+    // only used by a tiled interpreter: the reshaped model and the configs pointing at it
+    ei_unique_ptr_t model = ei_unique_ptr_t(nullptr, ei_aligned_free);
+    ei_config_tflite_graph_t tiled_graph_config;
+    ei_learning_block_config_tflite_graph_t tiled_block_config;
+};
+
+/**
+ * Release the resident interpreter and arena of a handle (if any)
+ */
+__attribute__((unused)) static void inference_tflite_resident_deinit(ei_impulse_handle_t *handle)
+{
+    delete (ei_tflite_resident_t*)handle->inference_state;
+    handle->inference_state = nullptr;
+}
+
+/**
+ * Tensor arena bytes in use by the resident interpreters of a handle (plain and tiled),
+ * 0 if it has none
+ */
+__attribute__((unused)) static size_t inference_tflite_resident_arena_used(ei_impulse_handle_t *handle)
+{
+    ei_tflite_resident_t *resident = (ei_tflite_resident_t*)handle->inference_state;
+    if (!resident) {
+        return 0;
+    }
+
+    size_t used = resident->interpreter ? resident->interpreter->arena_used_bytes() : 0;
+    if (resident->tiled && resident->tiled->interpreter) {
+        used += resident->tiled->interpreter->arena_used_bytes();
+    }
+    return used;
+}
+
+#if EI_CLASSIFIER_OP_PROFILER == 1
+/**
+ * Op profiler of the resident interpreter of a handle, or of its tiled interpreter;
+ * nullptr if that interpreter was not built
+ */
+__attribute__((unused)) static ei_op_profiler_t* inference_tflite_resident_op_profiler(ei_impulse_handle_t *handle, bool tiled)
+{
+    ei_tflite_resident_t *resident = (ei_tflite_resident_t*)handle->inference_state;
+    if (resident && tiled) {
+        resident = resident->tiled;
+    }
+    return resident ? (ei_op_profiler_t*)resident->profiler : nullptr;
+}
+#endif
+
+/**
+ * Allocate the tensor arena, build the interpreter and allocate the tensors once, so
+ * every following inference on this handle only has to fill the input and Invoke().
+ * On failure the handle falls back to setting up the interpreter on every call.
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+__attribute__((unused)) static EI_IMPULSE_ERROR inference_tflite_resident_init(ei_impulse_handle_t *handle)
+{
+    inference_tflite_resident_deinit(handle);
+
+    const ei_impulse_t *impulse = handle->impulse;
+    if (impulse->learning_blocks_size != 1 || impulse->learning_blocks[0].infer_fn != run_nn_inference) {
+        return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
     }
 
+    ei_learning_block_config_tflite_graph_t *block_config =
+        (ei_learning_block_config_tflite_graph_t*)impulse->learning_blocks[0].config;
+
+    ei_tflite_resident_t *resident = new ei_tflite_resident_t(block_config);
+    if (!resident || !resident->outputs) {
+        delete resident;
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+#if EI_CLASSIFIER_OP_PROFILER == 1
+    ei_op_profiler_t *profiler = new ei_op_profiler_t;
+    resident->profiler = profiler;
+#else
+    tflite::MicroProfilerInterface *profiler = nullptr;
+#endif
+
+    uint64_t ctx_start_us;
+    EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        block_config,
+        &ctx_start_us,
+        &resident->input,
+        resident->outputs,
+        &resident->interpreter,
+        resident->tensor_arena,
+        profiler);
+
+    if (init_res != EI_IMPULSE_OK) {
+        delete resident;
+        return init_res;
+    }
+
+    resident->setup_us = ei_read_timer_us() - ctx_start_us;
+    handle->inference_state = resident;
+
+    EI_LOGI("Resident TFLite interpreter ready (%d us setup)\n", (int)resident->setup_us);
+
     return EI_IMPULSE_OK;
 }
+
+/**
+ * Same as run_nn_inference_image_quantized, but on the resident interpreter of the handle.
+ * No arena allocation, interpreter construction or AllocateTensors() happens here.
+ */
+EI_IMPULSE_ERROR run_nn_inference_image_quantized_resident(
+    ei_impulse_handle_t *handle,
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    bool debug = false)
+{
+    ei_tflite_resident_t *resident = (ei_tflite_resident_t*)handle->inference_state;
+
+    result->timing.setup_us = 0;
+
+    return inference_tflite_image_quantized_run(
+        handle->impulse,
+        signal,
+        0,
+        result,
+        resident->block_config,
+        resident->interpreter,
+        resident->input,
+        resident->outputs,
+        resident->profiler);
+}
+
+/**
+ * Build a resident interpreter for tiles_x impulse-sized images placed side by side.
+ * The model is copied to RAM and widened (see inference_tflite_widen_model), the arena
+ * is scaled with the number of tiles.
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR inference_tflite_resident_tiled_init(ei_tflite_resident_t *resident, uint32_t tiles_x)
+{
+    delete resident->tiled;
+    resident->tiled = nullptr;
+
+    const ei_config_tflite_graph_t *graph_config = (ei_config_tflite_graph_t*)resident->block_config->graph_config;
+
+    ei_tflite_resident_t *tiled = new ei_tflite_resident_t(resident->block_config);
+    if (!tiled || !tiled->outputs) {
+        delete tiled;
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+    uint8_t *model = (uint8_t*)ei_aligned_calloc(16, graph_config->model_size);
+    if (!model) {
+        delete tiled;
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+    memcpy(model, graph_config->model, graph_config->model_size);
+    tiled->model = ei_unique_ptr_t(model, ei_aligned_free);
+
+    EI_IMPULSE_ERROR res = inference_tflite_widen_model(model, tiles_x);
+    if (res != EI_IMPULSE_OK) {
+        delete tiled;
+        return res;
+    }
+
+    tiled->tiles_x = tiles_x;
+    tiled->tiled_graph_config = *graph_config;
+    tiled->tiled_graph_config.model = model;
+    tiled->tiled_graph_config.arena_size = graph_config->arena_size * tiles_x;
+    tiled->tiled_block_config = *resident->block_config;
+    tiled->tiled_block_config.graph_config = &tiled->tiled_graph_config;
+    tiled->block_config = &tiled->tiled_block_config;
+
+#if EI_CLASSIFIER_OP_PROFILER == 1
+    ei_op_profiler_t *profiler = new ei_op_profiler_t;
+    tiled->profiler = profiler;
+#else
+    tflite::MicroProfilerInterface *profiler = nullptr;
+#endif
+
+    uint64_t ctx_start_us;
+    res = inference_tflite_setup(
+        tiled->block_config,
+        &ctx_start_us,
+        &tiled->input,
+        tiled->outputs,
+        &tiled->interpreter,
+        tiled->tensor_arena,
+        profiler);
+
+    if (res != EI_IMPULSE_OK) {
+        delete tiled;
+        return res;
+    }
+
+    tiled->setup_us = ei_read_timer_us() - ctx_start_us;
+    resident->tiled = tiled;
+
+    EI_LOGI("Resident TFLite interpreter for %d tiles ready (%d us setup)\n", (int)tiles_x, (int)tiled->setup_us);
+
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * Run the resident interpreter on tiles_x impulse-sized images placed side by side in one
+ * signal (impulse->input_width * tiles_x by impulse->input_height pixels) in a single Invoke().
+ * The tiled interpreter is built on the first call (its setup time is reported in
+ * result->timing.setup_us) and kept until the handle is deinitialized.
+ */
+EI_IMPULSE_ERROR run_nn_inference_image_quantized_resident_tiled(
+    ei_impulse_handle_t *handle,
+    signal_t *signal,
+    uint32_t tiles_x,
+    ei_impulse_result_t *result,
+    bool debug = false)
+{
+    ei_tflite_resident_t *resident = (ei_tflite_resident_t*)handle->inference_state;
+
+    result->timing.setup_us = 0;
+
+    if (!resident->tiled || resident->tiled->tiles_x != tiles_x) {
+        EI_IMPULSE_ERROR res = inference_tflite_resident_tiled_init(resident, tiles_x);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+        result->timing.setup_us = resident->tiled->setup_us;
+    }
+
+    ei_tflite_resident_t *tiled = resident->tiled;
+
+    if (signal->total_length != (size_t)handle->impulse->input_width * handle->impulse->input_height * tiles_x) {
+        return EI_IMPULSE_INVALID_SIZE;
+    }
+
+    return inference_tflite_image_quantized_run(
+        handle->impulse,
+        signal,
+        0,
+        result,
+        tiled->block_config,
+        tiled->interpreter,
+        tiled->input,
+        tiled->outputs,
+        tiled->profiler);
+}
+#endif // EI_CLASSIFIER_TFLITE_RESIDENT_INTERPRETER == 1
 #endif // EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
 
 __attribute__((unused)) int extract_tflite_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
@@ -0,0 +1,183 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _EI_CLASSIFIER_INFERENCING_ENGINE_TFLITE_OP_PROFILER_H_
+#define _EI_CLASSIFIER_INFERENCING_ENGINE_TFLITE_OP_PROFILER_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/micro_profiler_interface.h"
+
+#ifndef EI_OP_PROFILER_MAX_OPS
+#define EI_OP_PROFILER_MAX_OPS      16  // distinct op types tracked per interpreter
+#endif
+#ifndef EI_OP_PROFILER_BUCKETS
+#define EI_OP_PROFILER_BUCKETS      16  // log2 buckets of microseconds, the last one is open
+#endif
+
+/**
+ * Accumulated timing of one op type (all nodes of that type) of an interpreter
+ */
+typedef struct {
+    const char *name;       // op name reported by the interpreter, e.g. "CONV_2D"
+    uint32_t count;         // node invocations
+    uint64_t total_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    // histogram[0]: under 2 us, histogram[i]: [2^i, 2^(i+1)) us, the last bucket has no upper bound
+    uint32_t histogram[EI_OP_PROFILER_BUCKETS];
+} ei_op_profile_t;
+
+/**
+ * Profiler kept with an interpreter for its whole life. Every op invocation is added to the
+ * aggregate of its op type (a linear search on the tag pointer, no allocation, nothing printed),
+ * so the cost per node is two timer reads.
+ *
+ * Written only by the task running the interpreter. get_ops() may be called from any task: a
+ * copy taken during an Invoke() can have op types one invocation apart. reset() from another
+ * task is applied when the next Invoke() starts.
+ */
+class ei_op_profiler_t : public tflite::MicroProfilerInterface {
+public:
+    uint32_t BeginEvent(const char *tag) override
+    {
+        uint32_t ix;
+        for (ix = 0; ix < op_count; ix++) {
+            // tags are the interpreter's static op names, the pointer nearly always matches
+            if (ops[ix].name == tag || strcmp(ops[ix].name, tag) == 0) {
+                break;
+            }
+        }
+        if (ix == op_count) {
+            if (op_count == EI_OP_PROFILER_MAX_OPS) {
+                return EI_OP_PROFILER_MAX_OPS;
+            }
+            memset(&ops[ix], 0, sizeof(ops[ix]));
+            ops[ix].name = tag;
+            ops[ix].min_us = UINT32_MAX;
+            op_count++;
+        }
+
+        start_us[ix] = ei_read_timer_us();
+        return ix;
+    }
+
+    void EndEvent(uint32_t event_handle) override
+    {
+        if (event_handle >= EI_OP_PROFILER_MAX_OPS) {
+            return;
+        }
+
+        uint32_t us = (uint32_t)(ei_read_timer_us() - start_us[event_handle]);
+        ei_op_profile_t &op = ops[event_handle];
+        op.count++;
+        op.total_us += us;
+        if (us < op.min_us) op.min_us = us;
+        if (us > op.max_us) op.max_us = us;
+
+        uint32_t bucket = us < 2 ? 0 : 31 - __builtin_clz(us);
+        op.histogram[bucket < EI_OP_PROFILER_BUCKETS ? bucket : EI_OP_PROFILER_BUCKETS - 1]++;
+    }
+
+    /**
+     * Around every Invoke() of the interpreter
+     */
+    void begin_invoke()
+    {
+        if (reset_requested) {
+            op_count = 0;
+            invokes = 0;
+            invoke_total_us = 0;
+            reset_requested = false;
+        }
+        invoke_start_us = ei_read_timer_us();
+    }
+
+    void end_invoke()
+    {
+        invoke_total_us += ei_read_timer_us() - invoke_start_us;
+        invokes++;
+    }
+
+    /**
+     * Copy the aggregates of up to max_ops op types, in order of first appearance
+     *
+     * @return  Number of op types copied
+     */
+    size_t get_ops(ei_op_profile_t *out, size_t max_ops) const
+    {
+        size_t n = op_count < max_ops ? op_count : max_ops;
+        for (size_t ix = 0; ix < n; ix++) {
+            out[ix] = ops[ix];
+        }
+        return n;
+    }
+
+    uint32_t get_invokes() const { return invokes; }
+    uint64_t get_invoke_total_us() const { return invoke_total_us; }
+
+    void reset() { reset_requested = true; }
+
+    /**
+     * Print the aggregates as CSV (op,count,total_us,min_us,max_us)
+     */
+    void log() const
+    {
+        ei_printf("op,count,total_us,min_us,max_us\n");
+        for (size_t ix = 0; ix < op_count; ix++) {
+            ei_printf("%s,%u,%llu,%u,%u\n", ops[ix].name, (unsigned)ops[ix].count,
+                (unsigned long long)ops[ix].total_us, (unsigned)ops[ix].min_us, (unsigned)ops[ix].max_us);
+        }
+    }
+
+    void* operator new(size_t size) {
+        return ei_malloc(size);
+    }
+
+    void operator delete(void* ptr) {
+        ei_free(ptr);
+    }
+
+private:
+    ei_op_profile_t ops[EI_OP_PROFILER_MAX_OPS];
+    uint64_t start_us[EI_OP_PROFILER_MAX_OPS];
+    volatile size_t op_count = 0;
+    volatile uint32_t invokes = 0;
+    volatile uint64_t invoke_total_us = 0;
+    uint64_t invoke_start_us = 0;
+    volatile bool reset_requested = false;
+};
+
+#endif // _EI_CLASSIFIER_INFERENCING_ENGINE_TFLITE_OP_PROFILER_H_
@@ -106,6 +106,7 @@ extern "C" EI_IMPULSE_ERROR run_postprocessing(ei_impulse_handle_t *handle,
     }
     auto impulse = handle->impulse;
 
+    ei_trace_begin("ei_postprocess");
     for (size_t ix = 0; ix < impulse->postprocessing_blocks_size; ix++) {
         void* state = NULL;
         if (handle->post_processing_state != NULL) {
@@ -119,9 +120,11 @@ extern "C" EI_IMPULSE_ERROR run_postprocessing(ei_impulse_handle_t *handle,
                                                                                 impulse->postprocessing_blocks[ix].config,
                                                                                 state);
         if (res != EI_IMPULSE_OK) {
+            ei_trace_end("ei_postprocess");
             return res;
         }
     }
+    ei_trace_end("ei_postprocess");
 
     // free raw results
     for (size_t ix = 0; ix < impulse->output_tensors_size; ix++) {
@@ -341,7 +341,7 @@ void nhwc_to_nchw_inplace(std::vector<T>& data,
 }
 
 template<typename T>
-__attribute__((unused)) static EI_IMPULSE_ERROR process_qc_face_det_lite_common(const ei_impulse_t *impulse,
+__attribute__((unused)) static EI_IMPULSE_ERROR process_qc_face_det_lite_common(ei_impulse_handle_t *handle,
                                                                                 ei_impulse_result_t *result,
                                                                                 T *heatmap_buf,
                                                                                 uint32_t heatmap_buf_size,
@@ -354,11 +354,12 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_qc_face_det_lite_common(
                                                                                 float threshold,
                                                                                 size_t object_detection_count,
                                                                                 ei_object_detection_nms_config_t nms_config) {
+    const ei_impulse_t *impulse = handle->impulse;
     const int width = impulse->input_width;
     const int height = impulse->input_height;
     const uint32_t grid_size_x = width / 8;
     const uint32_t grid_size_y = height / 8;
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
 
     results.clear();
 
@@ -492,7 +493,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_qc_face_det_lite_f32(ei_
         return EI_IMPULSE_POSTPROCESSING_ERROR;
     }
 
-    return process_qc_face_det_lite_common(impulse,
+    return process_qc_face_det_lite_common(handle,
                                            result,
                                            heatmap_mtx->buffer,
                                            heatmap_mtx->cols * heatmap_mtx->rows,
@@ -120,11 +120,13 @@ __attribute__((unused)) static void ei_handle_cube(std::vector<ei_classifier_cub
     }
 }
 
-__attribute__((unused)) static void process_cubes(ei_impulse_result_t *result, std::vector<ei_classifier_cube_t*> *cubes, uint32_t out_width_factor, uint32_t object_detection_count) {
+/**
+ * Merge overlapping cubes and append them as bounding boxes (in input pixels) to results.
+ * The cubes are freed. Returns the number of bounding boxes added.
+ */
+__attribute__((unused)) static uint32_t ei_cubes_to_bounding_boxes(std::vector<ei_impulse_result_bounding_box_t> *results, std::vector<ei_classifier_cube_t*> *cubes, uint32_t out_width_factor, uint32_t x_offset) {
     std::vector<ei_classifier_cube_t*> bbs;
-    static std::vector<ei_impulse_result_bounding_box_t> results;
     uint32_t added_boxes_count = 0;
-    results.clear();
 
     for (auto sc : *cubes) {
         bool has_overlapping = false;
@@ -154,17 +156,30 @@ __attribute__((unused)) static void process_cubes(ei_impulse_result_t *result, s
 
         ei_impulse_result_bounding_box_t tmp = {
             .label = sc->label,
-            .x = (uint32_t)(sc->x * out_width_factor),
+            .x = (uint32_t)(sc->x * out_width_factor) + x_offset,
             .y = (uint32_t)(sc->y * out_width_factor),
             .width = (uint32_t)(sc->width * out_width_factor),
             .height = (uint32_t)(sc->height * out_width_factor),
             .value = sc->confidence
         };
 
-        results.push_back(tmp);
+        results->push_back(tmp);
         added_boxes_count++;
     }
 
+    for (auto c : *cubes) {
+        delete c;
+    }
+
+    return added_boxes_count;
+}
+
+__attribute__((unused)) static void process_cubes(ei_impulse_handle_t *handle, ei_impulse_result_t *result, std::vector<ei_classifier_cube_t*> *cubes, uint32_t out_width_factor, uint32_t object_detection_count) {
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
+    results.clear();
+
+    uint32_t added_boxes_count = ei_cubes_to_bounding_boxes(&results, cubes, out_width_factor, 0);
+
     // if we didn't detect min required objects, fill the rest with fixed value
     if (added_boxes_count < object_detection_count) {
         results.resize(object_detection_count);
@@ -173,10 +188,6 @@ __attribute__((unused)) static void process_cubes(ei_impulse_result_t *result, s
         }
     }
 
-    for (auto c : *cubes) {
-        delete c;
-    }
-
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = added_boxes_count;
 }
@@ -454,9 +465,9 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_f32(ei_impulse_hand
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    for (size_t y = 0; y < config->out_width; y++) {
-        for (size_t x = 0; x < config->out_height; x++) {
-            size_t loc = ((y * config->out_height) + x) * (impulse->label_count + 1);
+    for (size_t y = 0; y < config->out_height; y++) {
+        for (size_t x = 0; x < config->out_width; x++) {
+            size_t loc = ((y * config->out_width) + x) * (impulse->label_count + 1);
 
             for (size_t ix = 1; ix < (size_t)impulse->label_count + 1; ix++) {
                 float vf = raw_output_mtx->buffer[loc+ix];
@@ -466,7 +477,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_f32(ei_impulse_hand
         }
     }
 
-    process_cubes(result, &cubes, out_width_factor, config->object_detection_count);
+    process_cubes(handle, result, &cubes, out_width_factor, config->object_detection_count);
 
     return EI_IMPULSE_OK;
 #else
@@ -494,9 +505,9 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_i8(ei_impulse_handl
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    for (size_t y = 0; y < config->out_width; y++) {
-        for (size_t x = 0; x < config->out_height; x++) {
-            size_t loc = ((y * config->out_height) + x) * (impulse->label_count + 1);
+    for (size_t y = 0; y < config->out_height; y++) {
+        for (size_t x = 0; x < config->out_width; x++) {
+            size_t loc = ((y * config->out_width) + x) * (impulse->label_count + 1);
 
             for (size_t ix = 1; ix < (size_t)impulse->label_count + 1; ix++) {
                 int8_t v = raw_output_mtx->buffer[loc+ix];
@@ -507,7 +518,71 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_i8(ei_impulse_handl
         }
     }
 
-    process_cubes(result, &cubes, out_width_factor, config->object_detection_count);
+    process_cubes(handle, result, &cubes, out_width_factor, config->object_detection_count);
+
+    return EI_IMPULSE_OK;
+#else
+    return EI_IMPULSE_LAST_LAYER_NOT_AVAILABLE;
+#endif
+}
+
+/**
+ * Same as process_fomo_i8, for an output grid that covers tiles_x impulse-sized tiles side by
+ * side (out_height x (out_width * tiles_x) cells, see run_classifier_image_tiled).
+ * Cells are never merged across tiles, so every bounding box lies within one tile and
+ * x / input_width is the index of the tile it was found in. Boxes are ordered by tile.
+ */
+__attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_i8_tiled(ei_impulse_handle_t *handle,
+                                                                     uint32_t input_block_id,
+                                                                     ei_impulse_result_t *result,
+                                                                     void *config_ptr,
+                                                                     uint32_t tiles_x) {
+#if EI_HAS_FOMO
+    const ei_impulse_t *impulse = handle->impulse;
+    const ei_fill_result_fomo_i8_config_t *config = (ei_fill_result_fomo_i8_config_t*)config_ptr;
+
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
+    results.clear();
+
+    int out_width_factor = impulse->input_width / config->out_width;
+    size_t grid_width = config->out_width * tiles_x;
+    uint32_t added_boxes_count = 0;
+
+    ei::matrix_i8_t* raw_output_mtx = NULL;
+    bool find_mtx_res = find_mtx_by_idx(result->_raw_outputs, &raw_output_mtx, input_block_id, impulse->output_tensors_size);
+    if (!find_mtx_res) {
+        return EI_IMPULSE_OUTPUT_TENSOR_NULL;
+    }
+
+    for (uint32_t tile = 0; tile < tiles_x; tile++) {
+        std::vector<ei_classifier_cube_t*> cubes;
+
+        for (size_t y = 0; y < config->out_height; y++) {
+            for (size_t x = 0; x < config->out_width; x++) {
+                size_t loc = ((y * grid_width) + (tile * config->out_width) + x) * (impulse->label_count + 1);
+
+                for (size_t ix = 1; ix < (size_t)impulse->label_count + 1; ix++) {
+                    int8_t v = raw_output_mtx->buffer[loc+ix];
+                    float vf = static_cast<float>(v - config->zero_point) * config->scale;
+
+                    ei_handle_cube(&cubes, x, y, vf, impulse->categories[ix - 1], config->threshold);
+                }
+            }
+        }
+
+        added_boxes_count += ei_cubes_to_bounding_boxes(&results, &cubes, out_width_factor, tile * impulse->input_width);
+    }
+
+    // if we didn't detect min required objects, fill the rest with fixed value
+    if (added_boxes_count < config->object_detection_count) {
+        results.resize(config->object_detection_count);
+        for (size_t ix = added_boxes_count; ix < config->object_detection_count; ix++) {
+            results[ix].value = 0.0f;
+        }
+    }
+
+    result->bounding_boxes = results.data();
+    result->bounding_boxes_count = added_boxes_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -548,7 +623,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_visual_ad_f32(ei_impulse
     result->visual_ad_result.mean_value = sum_val / (config->grid_size_x * config->grid_size_y);
     result->visual_ad_result.max_value = max_val;
 
-    static ei_vector<ei_impulse_result_bounding_box_t> results;
+    ei_vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.visual_ad_grid_cells;
 
     results.clear();
 
@@ -590,7 +665,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_ssd_f32(ei_impulse_handl
     const ei_impulse_t *impulse = handle->impulse;
     const ei_fill_result_object_detection_f32_config_t *config = (ei_fill_result_object_detection_f32_config_t*)config_ptr;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
     int added_boxes_count = 0;
     results.clear();
     results.resize(config->object_detection_count);
@@ -662,7 +737,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov5_f32(ei_impulse_ha
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
     results.clear();
 
     size_t col_size = 5 + impulse->label_count;
@@ -766,7 +841,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov5_i8(ei_impulse_han
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
     results.clear();
 
     size_t col_size = 5 + impulse->label_count;
@@ -869,7 +944,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolox_f32(ei_impulse_han
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
     results.clear();
 
     // START: def yolox_postprocess()
@@ -1084,7 +1159,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolox_detect_f32(ei_impu
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
     results.clear();
 
     // expected format [xmin ymin xmax ymax score label]
@@ -1160,7 +1235,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov7_f32(ei_impulse_ha
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
     results.clear();
 
     size_t col_size = 7;
@@ -1316,7 +1391,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov2_f32(ei_impulse_ha
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
     results.clear();
 
     // Example output shape: (7, 7, 5, 7)
@@ -1479,7 +1554,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov2_f32(ei_impulse_ha
 
 #if EI_HAS_TAO_DECODE_DETECTIONS
 template<typename T>
-__attribute__((unused)) static EI_IMPULSE_ERROR process_tao_decode_detections_common(const ei_impulse_t *impulse,
+__attribute__((unused)) static EI_IMPULSE_ERROR process_tao_decode_detections_common(ei_impulse_handle_t *handle,
                                                                                      ei_impulse_result_t *result,
                                                                                      T *data,
                                                                                      float zero_point,
@@ -1488,12 +1563,13 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_decode_detections_co
                                                                                      float threshold,
                                                                                      size_t object_detection_count,
                                                                                      ei_object_detection_nms_config_t nms_config) {
+    const ei_impulse_t *impulse = handle->impulse;
 
     size_t col_size = 12 + impulse->label_count + 1;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
+    std::vector<ei_impulse_result_bounding_box_t> &class_results = handle->result_storage.class_bounding_boxes;
     results.clear();
 
     for (size_t cls_idx = 1; cls_idx < (size_t)(impulse->label_count + 1); cls_idx++)  {
@@ -1612,7 +1688,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_decode_detections_co
 
 #if EI_HAS_TAO_YOLOV3
 template<typename T>
-__attribute__((unused)) static EI_IMPULSE_ERROR  process_tao_yolov3_common(const ei_impulse_t *impulse,
+__attribute__((unused)) static EI_IMPULSE_ERROR  process_tao_yolov3_common(ei_impulse_handle_t *handle,
                                                                                      ei_impulse_result_t *result,
                                                                                      T *data,
                                                                                      float zero_point,
@@ -1621,13 +1697,14 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  process_tao_yolov3_common(const
                                                                                      float threshold,
                                                                                      size_t object_detection_count,
                                                                                      ei_object_detection_nms_config_t nms_config) {
+    const ei_impulse_t *impulse = handle->impulse;
     // # x: 3-D tensor. Last dimension is
     //          (cy, cx, ph, pw, step_y, step_x, pred_y, pred_x, pred_h, pred_w, object, cls...)
     size_t col_size = 11 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
+    std::vector<ei_impulse_result_bounding_box_t> &class_results = handle->result_storage.class_bounding_boxes;
 
     results.clear();
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
@@ -1707,7 +1784,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  process_tao_yolov3_common(const
 
 #if EI_HAS_TAO_YOLOV4
 template<typename T>
-__attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_common(const ei_impulse_t *impulse,
+__attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_common(ei_impulse_handle_t *handle,
                                                                           ei_impulse_result_t *result,
                                                                           T *data,
                                                                           float zero_point,
@@ -1716,13 +1793,14 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_common(const
                                                                           float threshold,
                                                                           size_t object_detection_count,
                                                                           ei_object_detection_nms_config_t nms_config) {
+    const ei_impulse_t *impulse = handle->impulse;
     // # x: 3-D tensor. Last dimension is
     //          (cy, cx, ph, pw, step_y, step_x, pred_y, pred_x, pred_h, pred_w, object, cls...)
     size_t col_size = 11 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
+    std::vector<ei_impulse_result_bounding_box_t> &class_results = handle->result_storage.class_bounding_boxes;
     results.clear();
 
     const float grid_scale_xy = 1.0f;
@@ -1828,7 +1906,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_detection_i8(ei_impu
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    EI_IMPULSE_ERROR res = process_tao_decode_detections_common(impulse,
+    EI_IMPULSE_ERROR res = process_tao_decode_detections_common(handle,
                                                                result,
                                                                raw_output_mtx->buffer,
                                                                config->zero_point,
@@ -1860,7 +1938,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_detection_f32(ei_imp
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    EI_IMPULSE_ERROR res = process_tao_decode_detections_common(impulse,
+    EI_IMPULSE_ERROR res = process_tao_decode_detections_common(handle,
                                                                result,
                                                                raw_output_mtx->buffer,
                                                                0.0f,
@@ -1891,7 +1969,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov3_f32(ei_impuls
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    EI_IMPULSE_ERROR res = process_tao_yolov3_common(impulse,
+    EI_IMPULSE_ERROR res = process_tao_yolov3_common(handle,
                                                      result,
                                                      raw_output_mtx->buffer,
                                                      0.0f,
@@ -1922,7 +2000,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov3_i8(ei_impulse
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    EI_IMPULSE_ERROR res = process_tao_yolov3_common(impulse,
+    EI_IMPULSE_ERROR res = process_tao_yolov3_common(handle,
                                                      result,
                                                      raw_output_mtx->buffer,
                                                      config->zero_point,
@@ -1953,7 +2031,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_f32(ei_impuls
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    EI_IMPULSE_ERROR res = process_tao_yolov4_common(impulse,
+    EI_IMPULSE_ERROR res = process_tao_yolov4_common(handle,
                                                      result,
                                                      raw_output_mtx->buffer,
                                                      0.0f,
@@ -1984,7 +2062,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_i8(ei_impulse
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    EI_IMPULSE_ERROR res = process_tao_yolov4_common(impulse,
+    EI_IMPULSE_ERROR res = process_tao_yolov4_common(handle,
                                                      result,
                                                      raw_output_mtx->buffer,
                                                      config->zero_point,
@@ -2001,7 +2079,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_i8(ei_impulse
 
 #if EI_HAS_YOLO_PRO
 template<typename T>
-__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_common(const ei_impulse_t *impulse,
+__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_common(ei_impulse_handle_t *handle,
                                                                                     ei_impulse_result_t *result,
                                                                                     T *data,
                                                                                     float zero_point,
@@ -2010,11 +2088,12 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
                                                                                     float threshold,
                                                                                     size_t object_detection_count,
                                                                                     ei_object_detection_nms_config_t nms_config) {
+    const ei_impulse_t *impulse = handle->impulse;
     size_t col_size = 4 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
+    std::vector<ei_impulse_result_bounding_box_t> &class_results = handle->result_storage.class_bounding_boxes;
     results.clear();
 
     // (xmin, ymin, xmax, ymax, cls...)
@@ -2116,7 +2195,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolo_pro_f32(ei_impulse_
     if (!find_mtx_res) {
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
-    EI_IMPULSE_ERROR res = fill_result_struct_yolo_pro_common(impulse,
+    EI_IMPULSE_ERROR res = fill_result_struct_yolo_pro_common(handle,
                                                                 result,
                                                                 raw_output_mtx->buffer,
                                                                 0.0f,
@@ -2147,7 +2226,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolo_pro_i8(ei_impulse_h
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    EI_IMPULSE_ERROR res = fill_result_struct_yolo_pro_common(impulse,
+    EI_IMPULSE_ERROR res = fill_result_struct_yolo_pro_common(handle,
                                                     result,
                                                     raw_output_mtx->buffer,
                                                     config->zero_point,
@@ -2168,7 +2247,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolo_pro_i8(ei_impulse_h
 #define EI_YOLOV11_COORD_NORMALIZED 1
 
 template<typename T>
-__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_common(const ei_impulse_t *impulse,
+__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_common(ei_impulse_handle_t *handle,
                                                                                    ei_impulse_result_t *result,
                                                                                    bool is_coord_normalized,
                                                                                    T *data,
@@ -2178,11 +2257,12 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_commo
                                                                                    float threshold,
                                                                                    size_t object_detection_count,
                                                                                    ei_object_detection_nms_config_t nms_config) {
+    const ei_impulse_t *impulse = handle->impulse;
     size_t row_count = 4 + impulse->label_count;
     size_t col_size = output_features_count / row_count;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    std::vector<ei_impulse_result_bounding_box_t> &results = handle->result_storage.bounding_boxes;
+    std::vector<ei_impulse_result_bounding_box_t> &class_results = handle->result_storage.class_bounding_boxes;
     results.clear();
 
     // output shape: (num_classes + 4, num_detections) e.g. (5, 189)
@@ -2311,7 +2391,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov11_f32(ei_impulse_h
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    return fill_result_struct_yolov11_common(impulse,
+    return fill_result_struct_yolov11_common(handle,
                                              result,
                                              config->version == EI_YOLOV11_COORD_NORMALIZED,
                                              raw_output_mtx->buffer,
@@ -2345,7 +2425,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov11_i8(ei_impulse_ha
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    return fill_result_struct_yolov11_common(impulse,
+    return fill_result_struct_yolov11_common(handle,
                                              result,
                                              config->version == EI_YOLOV11_COORD_NORMALIZED,
                                              raw_output_mtx->buffer,
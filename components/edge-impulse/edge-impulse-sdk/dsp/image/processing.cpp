@@ -36,6 +36,12 @@
 #include "edge-impulse-sdk/classifier/ei_constants.h"
 #include <string.h>
 #include <stddef.h>
+#include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace ei {
 namespace image {
@@ -544,6 +550,155 @@ int resize_image_using_mode(
     // shouldn't get here
     return -2;
 }
+
+/**
+ * Quantize one row of mono pixels with scale 1/255 and zero point -128, i.e. v - 128,
+ * which is flipping the top bit. Returns the number of pixels done, the caller finishes
+ * the rest of the row.
+ */
+static int quantize_gray_row_u8_to_i8(const uint8_t *src, int8_t *dst, int width)
+{
+#if defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_S3) && (EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_S3 == 1)
+    // PIE loads and stores ignore the low 4 address bits: pixels up to an aligned dst are
+    // done one by one, then stores are aligned and the source may be at any offset
+    int x = 0;
+    while (x < width && ((uintptr_t)(dst + x) & 15) != 0) {
+        dst[x] = static_cast<int8_t>(src[x] ^ 0x80);
+        x++;
+    }
+
+    static const uint8_t sign_bit = 0x80;
+    const uint8_t *s = src + x;
+    int8_t *d = dst + x;
+    int blocks;
+    if (((uintptr_t)s & 15) == 0) {
+        blocks = (width - x) / 16;
+        if (blocks > 0) {
+            __asm__ volatile (
+                "ee.vldbc.8 q1, %[bit]\n"
+                "loopnez %[n], 1f\n"
+                "ee.vld.128.ip q0, %[s], 16\n"
+                "ee.xorq q0, q0, q1\n"
+                "ee.vst.128.ip q0, %[d], 16\n"
+                "1:\n"
+                : [s] "+r"(s), [d] "+r"(d)
+                : [n] "r"(blocks), [bit] "r"(&sign_bit)
+                : "memory");
+        }
+    }
+    else {
+        // ee.ld.128.usar sets SAR_BYTE from the address, ee.src.q shifts the 16 source bytes
+        // out of two aligned loads. One aligned load runs ahead, so the last block is left
+        // to the caller and nothing past the row is read.
+        blocks = (width - x) / 16 - 1;
+        if (blocks > 0) {
+            __asm__ volatile (
+                "ee.vldbc.8 q3, %[bit]\n"
+                "ee.ld.128.usar.ip q0, %[s], 16\n"
+                "loopnez %[n], 1f\n"
+                "ee.ld.128.usar.ip q1, %[s], 16\n"
+                "ee.src.q.qup q2, q0, q1\n"
+                "ee.xorq q2, q2, q3\n"
+                "ee.vst.128.ip q2, %[d], 16\n"
+                "1:\n"
+                : [s] "+r"(s), [d] "+r"(d)
+                : [n] "r"(blocks), [bit] "r"(&sign_bit)
+                : "memory");
+        }
+    }
+    return blocks > 0 ? x + blocks * 16 : x;
+#elif defined(__SSE2__)
+    const __m128i sign_bit = _mm_set1_epi8((char)0x80);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_xor_si128(v, sign_bit));
+    }
+    return x;
+#elif defined(__ARM_NEON)
+    const uint8x16_t sign_bit = vdupq_n_u8(0x80);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        vst1q_s8(dst + x, vreinterpretq_s8_u8(veorq_u8(vld1q_u8(src + x), sign_bit)));
+    }
+    return x;
+#else
+    (void)src;
+    (void)dst;
+    (void)width;
+    return 0;
+#endif
+}
+
+int crop_and_quantize_gray_i8(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    int pixel_size_B,
+    int startX,
+    int startY,
+    int dstWidth,
+    int dstHeight,
+    float scale,
+    float zero_point,
+    int8_t *dstTensor)
+{
+    if (startX < 0 || startY < 0 || dstWidth < 0 || dstHeight < 0 ||
+        startX + dstWidth > srcWidth || startY + dstHeight > srcHeight ||
+        (pixel_size_B != MONO_B_SIZE && pixel_size_B != RGB888_B_SIZE) || scale == 0.0f) {
+        return EIDSP_PARAMETER_INVALID;
+    }
+
+    const bool identity = scale == 0.003921568859368563f && zero_point == -128;
+
+    // Every gray level maps to one value, so the float math runs 256 times, not once a pixel
+    int8_t lut[256];
+    for (int v = 0; v < 256; v++) {
+        if (identity) {
+            lut[v] = static_cast<int8_t>(v - 128);
+        }
+        else {
+            lut[v] = static_cast<int8_t>(round((static_cast<float>(v) / 255.0f) / scale) + zero_point);
+        }
+    }
+
+    const int32_t iRedToGray = (int32_t)(0.299f * 65536.0f);
+    const int32_t iGreenToGray = (int32_t)(0.587f * 65536.0f);
+    const int32_t iBlueToGray = (int32_t)(0.114f * 65536.0f);
+
+    int8_t *out = dstTensor;
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t *row = srcImage + ((startY + y) * srcWidth + startX) * pixel_size_B;
+
+        if (pixel_size_B == MONO_B_SIZE) {
+            int x = identity ? quantize_gray_row_u8_to_i8(row, out, dstWidth) : 0;
+            for (; x < dstWidth; x++) {
+                out[x] = lut[row[x]];
+            }
+        }
+        else if (identity) {
+            for (int x = 0; x < dstWidth; x++) {
+                // ITU-R 601-2 luma transform with the integer weights of the DSP fast path
+                int32_t gray = (iRedToGray * row[x * 3]) + (iGreenToGray * row[x * 3 + 1]) +
+                    (iBlueToGray * row[x * 3 + 2]);
+                out[x] = lut[gray >> 16];
+            }
+        }
+        else {
+            for (int x = 0; x < dstWidth; x++) {
+                // float luma as in the DSP slow path, the sum is not rounded to a gray level first
+                float rf = static_cast<float>(row[x * 3]) / 255.0f;
+                float gf = static_cast<float>(row[x * 3 + 1]) / 255.0f;
+                float bf = static_cast<float>(row[x * 3 + 2]) / 255.0f;
+                float v = (0.299f * rf) + (0.587f * gf) + (0.114f * bf);
+                out[x] = static_cast<int8_t>(round(v / scale) + zero_point);
+            }
+        }
+        out += dstWidth;
+    }
+
+    return EIDSP_OK;
+}
 } //namespaces
 }
 }
@@ -216,5 +216,39 @@ int resize_image_using_mode(
     int dstHeight,
     int pixel_size_B,
     int mode);
+/**
+ * @brief Crops, converts to grayscale and quantizes in one pass, straight into an int8
+ * input tensor. Gray pixels are mapped through the same float math as the image DSP block
+ * with no image scaling (round((v / 255) / scale) + zero_point); RGB pixels are reduced to
+ * luma as the DSP block does, with the ITU-R 601-2 integer weights for scale 1/255 and zero
+ * point -128 and in float otherwise, so the output is bit-exact with it. The common
+ * (scale 1/255, zero point -128) case on a mono image is a single XOR per pixel and has
+ * PIE (ESP32-S3), SSE2 and NEON variants, rows at any alignment.
+ *
+ * @param srcImage Input image buffer, rows srcWidth pixels apart
+ * @param srcWidth Input width in pixels (row pitch)
+ * @param srcHeight Input height in pixels
+ * @param pixel_size_B Size of pixels in Bytes. 3 for RGB (R, G, B order), 1 for mono
+ * @param startX X coord of first pixel to keep
+ * @param startY Y coord of the first pixel to keep
+ * @param dstWidth Width of the crop in pixels
+ * @param dstHeight Height of the crop in pixels
+ * @param scale Quantization scale of the tensor
+ * @param zero_point Quantization zero point of the tensor
+ * @param dstTensor Output, dstWidth * dstHeight values
+ * @return int Status code (EIDSP_OK for success)
+ */
+int crop_and_quantize_gray_i8(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    int pixel_size_B,
+    int startX,
+    int startY,
+    int dstWidth,
+    int dstHeight,
+    float scale,
+    float zero_point,
+    int8_t *dstTensor);
 }}} //namespaces
 #endif //!__EI_IMAGE_PROCESSING__H__
\ No newline at end of file
@@ -650,6 +650,29 @@ typedef enum {
  * @{
  */
 
+/**
+ * @brief Pixel layout of an `ei_signal_image_t`.
+ */
+typedef enum {
+    EI_SIGNAL_IMAGE_GRAY8 = 0,      /**< 1 byte per pixel, luma */
+    EI_SIGNAL_IMAGE_RGB888 = 1,     /**< 3 bytes per pixel, R, G, B */
+} ei_signal_image_format_t;
+
+/**
+ * @brief An 8-bit image in memory that backs a signal.
+ *
+ * Image DSP blocks that support it read the pixels straight from here instead of through
+ * `get_data()`, which has to pack every pixel into a float. `stride` lets a signal point at
+ * a crop of a larger image without copying it.
+ */
+typedef struct {
+    const uint8_t *data;                /**< First pixel of the image */
+    size_t width;                       /**< Width in pixels */
+    size_t height;                      /**< Height in pixels */
+    size_t stride;                      /**< Bytes from the start of one row to the next */
+    ei_signal_image_format_t format;    /**< Pixel layout */
+} ei_signal_image_t;
+
 /**
  * @brief Holds the callback pointer for retrieving raw data and the length
  *  of data to be retrieved.
@@ -699,6 +722,13 @@ typedef struct ei_signal_t {
      *  preprocessing and inference.
     */
     size_t total_length;
+
+    /**
+     * Optional raw image with the same `total_length` pixels (`width * height`). When set,
+     * the quantized image DSP path reads it directly and `get_data()` is not called.
+     * `get_data()` should still be set for DSP blocks and engines that need it.
+     */
+    const ei_signal_image_t *image = nullptr;
 } signal_t;
 
 /** @} */
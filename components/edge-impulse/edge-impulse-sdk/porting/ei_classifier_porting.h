@@ -257,6 +257,18 @@ void *ei_calloc(size_t nitems, size_t size);
  */
 void ei_free(void *ptr);
 
+/**
+ * @brief Mark the start and end of an inference stage (DSP, Invoke, postprocessing)
+ *
+ * Called around each stage so the application can trace where the time of an inference goes.
+ * The default implementations do nothing, define both to receive the events. `name` is a
+ * string literal, the calls nest and always come in pairs on the calling task.
+ *
+ * @param[in] name Name of the stage
+ */
+void ei_trace_begin(const char *name);
+void ei_trace_end(const char *name);
+
 /** @} */
 
 #if defined(__cplusplus) && EI_C_LINKAGE == 1
@@ -53,7 +53,8 @@
 
 #include <edge-impulse-sdk/porting/espressif/ESP-NN/src/common/common_functions.h>
 
-static int16_t *scratch_buffer = NULL;
+/* thread-local: the conv kernel sets it right before each call, and two interpreters may run at once */
+static __thread int16_t *scratch_buffer = NULL;
 
 extern void esp_nn_conv_s8_mult8_1x1_esp32s3(
                 const int8_t *input_data,
@@ -19,7 +19,8 @@
 
 #include <edge-impulse-sdk/porting/espressif/ESP-NN/src/common/common_functions.h>
 
-static int16_t *scratch_buffer = NULL;
+/* per task, see esp_nn_conv_esp32s3.c */
+static __thread int16_t *scratch_buffer = NULL;
 
 extern void esp_nn_depthwise_conv_s16_mult8_3x3_esp32s3(const int16_t *input_data,
                                                         const uint16_t input_wd,
@@ -17,7 +17,8 @@
 #include "softmax_common.h"
 #include <stdio.h>
 
-static int32_t *scratch_buf = NULL;
+/* per task, see esp_nn_conv_esp32s3.c */
+static __thread int32_t *scratch_buf = NULL;
 
 /**
  * @brief   Get scratch buffer size needed by softmax function
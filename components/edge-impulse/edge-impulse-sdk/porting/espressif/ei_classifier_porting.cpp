@@ -91,6 +91,12 @@ __attribute__((weak)) void ei_printf(const char *format, ...) {
     }
 }
 
+__attribute__((weak)) void ei_trace_begin(const char *name) {
+}
+
+__attribute__((weak)) void ei_trace_end(const char *name) {
+}
+
 __attribute__((weak)) void ei_printf_float(float f) {
     ei_printf("%f", f);
 }
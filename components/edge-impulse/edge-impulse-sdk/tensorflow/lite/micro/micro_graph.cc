@@ -35,6 +35,32 @@ const char* OpNameFromRegistration(const TfLiteRegistration* registration) {
   }
 }
 
+#if defined(EI_CLASSIFIER_OP_PROFILER) && EI_CLASSIFIER_OP_PROFILER == 1
+// ScopedMicroProfiler for the per-op profiler (ei_op_profiler_t). micro_log.h
+// defines TF_LITE_STRIP_ERROR_STRINGS, which makes ScopedMicroProfiler a no-op;
+// the op names only come from the schema's static table, nothing is stripped.
+class ScopedOpProfiler {
+ public:
+  ScopedOpProfiler(const TfLiteRegistration* registration,
+                   MicroProfilerInterface* profiler)
+      : profiler_(profiler) {
+    if (profiler_ != nullptr) {
+      event_handle_ = profiler_->BeginEvent(OpNameFromRegistration(registration));
+    }
+  }
+
+  ~ScopedOpProfiler() {
+    if (profiler_ != nullptr) {
+      profiler_->EndEvent(event_handle_);
+    }
+  }
+
+ private:
+  uint32_t event_handle_ = 0;
+  MicroProfilerInterface* profiler_ = nullptr;
+};
+#endif
+
 }  // namespace
 
 MicroGraph::MicroGraph(TfLiteContext* context, const Model* model,
@@ -172,7 +198,11 @@ TfLiteStatus MicroGraph::InvokeSubgraph(int subgraph_idx) {
 // This ifdef is needed (even though ScopedMicroProfiler itself is a no-op with
 // -DTF_LITE_STRIP_ERROR_STRINGS) because the function OpNameFromRegistration is
 // only defined for builds with the error strings.
-#if !defined(TF_LITE_STRIP_ERROR_STRINGS)
+#if defined(EI_CLASSIFIER_OP_PROFILER) && EI_CLASSIFIER_OP_PROFILER == 1
+    ScopedOpProfiler scoped_profiler(
+        registration,
+        reinterpret_cast<MicroProfilerInterface*>(context_->profiler));
+#elif !defined(TF_LITE_STRIP_ERROR_STRINGS)
     ScopedMicroProfiler scoped_profiler(
         OpNameFromRegistration(registration),
         reinterpret_cast<MicroProfilerInterface*>(context_->profiler));
@@ -0,0 +1,12 @@
+#pragma once
+
+// main/config.h with archive limits small enough for test_frame_archive to roll and evict
+// segments within a few hundred frames
+#include "../../main/config.h"
+
+#undef ARCHIVE_SEGMENT_MAX_BYTES
+#undef ARCHIVE_SEGMENT_MAX_RECORDS
+#undef ARCHIVE_MAX_BYTES
+#define ARCHIVE_SEGMENT_MAX_BYTES   4096
+#define ARCHIVE_SEGMENT_MAX_RECORDS 16
+#define ARCHIVE_MAX_BYTES           (32 * 1024ULL)
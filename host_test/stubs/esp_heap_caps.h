@@ -0,0 +1,22 @@
+#pragma once
+
+// Host stand-in for esp_heap_caps.h, every capability is the C heap
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+
+static inline void* heap_caps_malloc(size_t size, uint32_t) {
+    return malloc(size);
+}
+
+static inline void* heap_caps_calloc(size_t n, size_t size, uint32_t) {
+    return calloc(n, size);
+}
+
+static inline void heap_caps_free(void* ptr) {
+    free(ptr);
+}
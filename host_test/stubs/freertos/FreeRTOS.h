@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS types the firmware modules under test use
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE         0
+#define pdTRUE          1
+#define portMAX_DELAY   ((TickType_t)0xffffffff)
@@ -0,0 +1,22 @@
+#pragma once
+
+// Host stand-in for FreeRTOS mutexes, on std::mutex. Timeouts are not supported, every take
+// waits as with portMAX_DELAY.
+#include <mutex>
+#include "FreeRTOS.h"
+
+typedef std::mutex* SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new std::mutex;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t) {
+    mutex->lock();
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    mutex->unlock();
+    return pdTRUE;
+}
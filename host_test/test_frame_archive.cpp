@@ -0,0 +1,410 @@
+/*
+ * Frame archive (main/sd/frame_archive): frames appended to segment files in a temporary
+ * directory, with the segment limits of archive_config/config.h. Every frame must read back as
+ * it was appended, after segments roll, after the archive is closed and opened again, and after
+ * a reset left the last segment open with a record cut short.
+ * The oldest segments must be evicted once the archive is over ARCHIVE_MAX_BYTES, or once they
+ * are older than ARCHIVE_MAX_AGE_S by a clock that was set, and the stored bytes must always be
+ * the size of the segment files.
+ */
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "frame_archive.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// The archive takes the wall clock from time(), this one replaces the C library's
+static time_t fake_now = 0;
+
+extern "C" time_t time(time_t* t) noexcept
+{
+    if (t) *t = fake_now;
+    return fake_now;
+}
+
+// A frame with images and digits derived from its frame id
+struct TestFrame {
+    uint8_t roi[160];
+    uint8_t crops[DIGIT_NUM][32];
+    char digits[DIGIT_NUM];
+    float scores[DIGIT_NUM];
+    ArchiveFrame frame;
+};
+
+static void make_frame(uint32_t frame_id, TestFrame* f)
+{
+    f->frame.captured_us = frame_id * 1000003LL;
+    f->frame.digits = f->digits;
+    f->frame.scores = f->scores;
+    f->frame.roi_img = f->roi;
+    f->frame.roi_len = 40 + frame_id * 13 % 120;
+    for (size_t k = 0; k < f->frame.roi_len; k++) f->roi[k] = (uint8_t)(frame_id * 31 + k);
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        f->frame.crop_img[i] = f->crops[i];
+        f->frame.crop_len[i] = 8 + (frame_id * 7 + i) % 24;
+        for (size_t k = 0; k < f->frame.crop_len[i]; k++) f->crops[i][k] = (uint8_t)(frame_id * 17 + i * 5 + k);
+        f->digits[i] = (frame_id + i) % 7 == 0 ? DIGIT_EMPTY : (char)('0' + (frame_id * 3 + i) % 10);
+        f->scores[i] = (float)((frame_id + i) % 16) / 15.0f;
+    }
+}
+
+static uint32_t append(FrameArchive& archive, uint32_t frame_id)
+{
+    TestFrame f;
+    make_frame(frame_id, &f);
+    return archive.append(f.frame);
+}
+
+// Header and every image of frame_id as make_frame() made them
+static bool frame_matches(FrameArchive& archive, uint32_t frame_id)
+{
+    TestFrame f;
+    make_frame(frame_id, &f);
+
+    ArchiveRecordHeader header;
+    if (!archive.read_header(frame_id, &header) || header.frame_id != frame_id ||
+        header.captured_us != f.frame.captured_us || memcmp(header.digits, f.digits, DIGIT_NUM) != 0) {
+        return false;
+    }
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        if (header.confidence[i] != (uint8_t)(f.scores[i] * 255.0f + 0.5f)) return false;
+    }
+
+    uint8_t out[256];
+    if (archive.read_image(frame_id, ARCHIVE_IMAGE_ROI, out, sizeof(out)) != f.frame.roi_len ||
+        memcmp(out, f.roi, f.frame.roi_len) != 0) {
+        return false;
+    }
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        if (archive.read_image(frame_id, i, out, sizeof(out)) != f.frame.crop_len[i] ||
+            memcmp(out, f.crops[i], f.frame.crop_len[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Segment file names in dir, oldest first
+static std::vector<std::string> list_segments(const char* dir)
+{
+    std::vector<std::string> names;
+    DIR* d = opendir(dir);
+    struct dirent* entry;
+    while (d && (entry = readdir(d)) != nullptr) {
+        if (strncmp(entry->d_name, "SEG", 3) == 0) names.push_back(entry->d_name);
+    }
+    if (d) closedir(d);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+static long file_size(const char* dir, const std::string& name)
+{
+    struct stat st;
+    std::string path = std::string(dir) + "/" + name;
+    return stat(path.c_str(), &st) == 0 ? (long)st.st_size : -1;
+}
+
+// The index of a closed segment must hold its records, each segment within the limits
+static bool segment_closed_within_limits(const char* dir, const std::string& name)
+{
+    std::string path = std::string(dir) + "/" + name;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    ArchiveSegmentFooter footer;
+    bool ok = fseek(file, -(long)sizeof(footer), SEEK_END) == 0 && fread(&footer, sizeof(footer), 1, file) == 1 &&
+              footer.magic == ARCHIVE_INDEX_MAGIC && footer.count > 0 &&
+              footer.count <= ARCHIVE_SEGMENT_MAX_RECORDS && footer.index_offset <= ARCHIVE_SEGMENT_MAX_BYTES;
+    fclose(file);
+    return ok;
+}
+
+static uint64_t disk_bytes(const char* dir)
+{
+    uint64_t bytes = 0;
+    for (const std::string& name : list_segments(dir)) bytes += file_size(dir, name);
+    return bytes;
+}
+
+static void remove_dir(const char* dir)
+{
+    for (const std::string& name : list_segments(dir)) {
+        remove((std::string(dir) + "/" + name).c_str());
+    }
+    rmdir(dir);
+}
+
+static void test_append_and_reopen(const char* dir)
+{
+    FrameArchive archive;
+    CHECK(archive.init(dir));
+    CHECK(archive.first_frame_id() == 0 && archive.last_frame_id() == 0);
+
+    // Enough frames for several segments, closed by size or by record count
+    for (uint32_t id = 1; id <= 60; id++) {
+        CHECK(append(archive, id) == id);
+    }
+    CHECK(archive.first_frame_id() == 1 && archive.last_frame_id() == 60);
+    for (uint32_t id = 1; id <= 60; id++) {
+        CHECK(frame_matches(archive, id));
+    }
+
+    ArchiveRecordHeader header;
+    uint8_t small[8];
+    CHECK(!archive.read_header(0, &header));
+    CHECK(!archive.read_header(61, &header));
+    CHECK(archive.read_image(1, ARCHIVE_IMAGE_ROI, small, sizeof(small)) == 0);
+    CHECK(archive.read_image(1, DIGIT_NUM, small, sizeof(small)) == 0);
+    CHECK(archive.read_header(1, &header) && header.unix_time == 0);
+
+    std::vector<std::string> names = list_segments(dir);
+    CHECK(names.size() >= 4 && names.size() == archive.get_usage().segments);
+    archive.close();
+
+    for (const std::string& name : names) {
+        CHECK(segment_closed_within_limits(dir, name));
+    }
+
+    // Opened again: the segments are found from their indexes, appends go to a new segment
+    FrameArchive reopened;
+    CHECK(reopened.init(dir));
+    CHECK(reopened.first_frame_id() == 1 && reopened.last_frame_id() == 60);
+    for (uint32_t id = 1; id <= 60; id++) {
+        CHECK(frame_matches(reopened, id));
+    }
+    CHECK(append(reopened, 61) == 61);
+    CHECK(frame_matches(reopened, 61));
+    CHECK(list_segments(dir).size() == names.size() + 1);
+    reopened.close();
+}
+
+static void test_recovery(const char* dir)
+{
+    // A reset: the archive is never closed, the open segment has no index and its last record
+    // was cut short
+    FrameArchive* crashed = new FrameArchive;
+    CHECK(crashed->init(dir));
+    for (uint32_t id = 1; id <= 20; id++) {
+        CHECK(append(*crashed, id) == id);
+    }
+    std::vector<std::string> names = list_segments(dir);
+    std::string last = std::string(dir) + "/" + names.back();
+    long size = file_size(dir, names.back());
+    CHECK(truncate(last.c_str(), size - 10) == 0);
+    // leaked on purpose, as a reset would, the file stays open
+    crashed = nullptr;
+
+    FrameArchive recovered;
+    CHECK(recovered.init(dir));
+    CHECK(recovered.first_frame_id() == 1 && recovered.last_frame_id() == 19);
+    for (uint32_t id = 1; id <= 19; id++) {
+        CHECK(frame_matches(recovered, id));
+    }
+    ArchiveRecordHeader header;
+    CHECK(!recovered.read_header(20, &header));
+    CHECK(segment_closed_within_limits(dir, names.back()));
+
+    // The cut frame id is given to the next frame, in a new segment
+    CHECK(append(recovered, 20) == 20);
+    CHECK(frame_matches(recovered, 20));
+    CHECK(list_segments(dir).size() == names.size() + 1);
+
+    // Another reset: the recovered index of the first cut segment is used from then on, the
+    // segment of frame 20 is rebuilt in turn
+    FrameArchive* crashed_again = new FrameArchive;
+    CHECK(crashed_again->init(dir));
+    CHECK(crashed_again->last_frame_id() == 20);
+    for (uint32_t id = 1; id <= 20; id++) {
+        CHECK(frame_matches(*crashed_again, id));
+    }
+    CHECK(append(*crashed_again, 21) == 21);
+
+    // A segment cut within its first record has nothing to recover, it is removed
+    names = list_segments(dir);
+    last = std::string(dir) + "/" + names.back();
+    CHECK(truncate(last.c_str(), sizeof(ArchiveSegmentHeader) + 20) == 0);
+    crashed_again = nullptr;
+
+    FrameArchive emptied;
+    CHECK(emptied.init(dir));
+    CHECK(list_segments(dir).size() == names.size() - 1);
+    CHECK(emptied.first_frame_id() == 1 && emptied.last_frame_id() == 20);
+    CHECK(!emptied.read_header(21, &header));
+    CHECK(append(emptied, 21) == 21);
+    for (uint32_t id = 1; id <= 21; id++) {
+        CHECK(frame_matches(emptied, id));
+    }
+    emptied.close();
+}
+
+static void test_size_eviction(const char* dir)
+{
+    fake_now = 0;
+    FrameArchive archive;
+    CHECK(archive.init(dir));
+
+    // The budget is crossed after several segments, from then on every append that goes over it
+    // evicts the oldest segment, only as many as needed
+    uint32_t evictions = 0;
+    for (uint32_t id = 1; id <= 400; id++) {
+        std::vector<std::string> before = list_segments(dir);
+        long oldest_size = file_size(dir, before.empty() ? "" : before.front());
+        CHECK(append(archive, id) == id);
+        std::vector<std::string> after = list_segments(dir);
+
+        ArchiveUsage usage = archive.get_usage();
+        CHECK(usage.bytes == disk_bytes(dir));
+        CHECK(usage.bytes <= ARCHIVE_MAX_BYTES);
+        CHECK(usage.segments == after.size());
+        if (usage.evicted_segments != evictions) {
+            CHECK(usage.evicted_segments == evictions + 1 && before.front() != after.front());
+            CHECK(usage.bytes + oldest_size > ARCHIVE_MAX_BYTES);
+            evictions = usage.evicted_segments;
+        }
+    }
+    CHECK(evictions >= 10 && archive.get_usage().segments >= 4);
+
+    uint32_t first = archive.first_frame_id();
+    ArchiveRecordHeader header;
+    CHECK(first > 1 && !archive.read_header(first - 1, &header));
+    for (uint32_t id = first; id <= 400; id++) {
+        CHECK(frame_matches(archive, id));
+    }
+
+    // close_segment adds the index, init counts the files as they are
+    archive.close();
+    CHECK(archive.get_usage().bytes == disk_bytes(dir));
+    FrameArchive* crashed = new FrameArchive;
+    CHECK(crashed->init(dir));
+    CHECK(crashed->get_usage().bytes == disk_bytes(dir));
+    CHECK(crashed->first_frame_id() == first && crashed->last_frame_id() == 400);
+    for (uint32_t id = 401; id <= 405; id++) {
+        CHECK(append(*crashed, id) == id);
+        CHECK(crashed->get_usage().bytes == disk_bytes(dir));
+    }
+
+    // and recover_segment the index it writes
+    std::vector<std::string> names = list_segments(dir);
+    std::string last = std::string(dir) + "/" + names.back();
+    CHECK(truncate(last.c_str(), file_size(dir, names.back()) - 10) == 0);
+    crashed = nullptr;
+
+    FrameArchive recovered;
+    CHECK(recovered.init(dir));
+    CHECK(recovered.last_frame_id() == 404);
+    CHECK(recovered.get_usage().bytes == disk_bytes(dir));
+    CHECK(recovered.get_usage().bytes <= ARCHIVE_MAX_BYTES);
+    recovered.close();
+}
+
+static void test_no_clock(const char* dir)
+{
+    // Frames archived before the clock was set have no time, no age makes them expire
+    fake_now = 0;
+    FrameArchive archive;
+    CHECK(archive.init(dir));
+    for (uint32_t id = 1; id <= 40; id++) {
+        CHECK(append(archive, id) == id);
+    }
+    fake_now = 1700000000 + 10 * ARCHIVE_MAX_AGE_S;
+    CHECK(append(archive, 41) == 41);
+    CHECK(archive.get_usage().evicted_segments == 0 && archive.first_frame_id() == 1);
+    archive.close();
+}
+
+static void test_age_eviction(const char* dir)
+{
+    const time_t start = 1700000000;
+    fake_now = start;
+    FrameArchive archive;
+    CHECK(archive.init(dir));
+
+    // A frame a minute, first_ids[n] is the first frame of segment n
+    std::vector<uint32_t> first_ids;
+    for (uint32_t id = 1; id <= 60; id++, fake_now += 60) {
+        size_t segments = list_segments(dir).size();
+        CHECK(append(archive, id) == id);
+        if (list_segments(dir).size() != segments) first_ids.push_back(id);
+    }
+    CHECK(first_ids.size() >= 4 && archive.get_usage().evicted_segments == 0);
+
+    // Just past the age of the first segment's newest frame: that segment goes, the next stays
+    ArchiveRecordHeader header;
+    CHECK(archive.read_header(first_ids[1] - 1, &header));
+    fake_now = (time_t)header.unix_time + ARCHIVE_MAX_AGE_S + 1;
+    CHECK(append(archive, 61) == 61);
+    ArchiveUsage usage = archive.get_usage();
+    CHECK(usage.evicted_segments == 1 && usage.first_frame_id == first_ids[1]);
+    CHECK(usage.bytes == disk_bytes(dir));
+    CHECK(!archive.read_header(first_ids[1] - 1, &header));
+    CHECK(frame_matches(archive, first_ids[1]));
+    archive.close();
+
+    // After a reset the clock is not set until SNTP: nothing is too old, the new segment has
+    // frames without a time
+    fake_now = 1000;
+    FrameArchive rebooted;
+    CHECK(rebooted.init(dir));
+    CHECK(rebooted.get_usage().evicted_segments == 0 && rebooted.first_frame_id() == first_ids[1]);
+    CHECK(append(rebooted, 62) == 62);
+    CHECK(rebooted.get_usage().evicted_segments == 0);
+    rebooted.close();
+
+    // Opened with the clock set long after: init evicts every segment that has a time, the one
+    // without stays
+    fake_now = start + 10 * ARCHIVE_MAX_AGE_S;
+    FrameArchive later;
+    CHECK(later.init(dir));
+    usage = later.get_usage();
+    CHECK(usage.segments == 1 && usage.evicted_segments == first_ids.size() - 1);
+    CHECK(usage.first_frame_id == 62 && usage.last_frame_id == 62);
+    CHECK(usage.bytes == disk_bytes(dir));
+    CHECK(frame_matches(later, 62));
+    later.close();
+}
+
+int main()
+{
+    char base[] = "/tmp/archive.XXXXXX";
+    if (!mkdtemp(base)) {
+        printf("FAIL: no temporary directory\n");
+        return 1;
+    }
+
+    struct {
+        const char* name;
+        void (*run)(const char* dir);
+    } tests[] = {
+        { "append", test_append_and_reopen },
+        { "recovery", test_recovery },
+        { "size", test_size_eviction },
+        { "noclock", test_no_clock },
+        { "age", test_age_eviction },
+    };
+
+    for (auto& test : tests) {
+        std::string dir = std::string(base) + "/" + test.name;
+        mkdir(dir.c_str(), 0700);
+        test.run(dir.c_str());
+        remove_dir(dir.c_str());
+    }
+    rmdir(base);
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * crop_and_quantize_gray_i8 (dsp/image/processing.cpp) against the DSP block it replaces:
+ * RGB888 crops against extract_image_features_quantized reading packed pixels through
+ * signal_t::get_data (the path used before the kernel), mono crops against the block's
+ * float math for a luma pixel. Built once per SIMD variant, see CMakeLists.txt.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+#define IMG_W 320
+#define IMG_H 240
+
+struct Crop {
+    int x, y, w, h;
+};
+
+struct Quant {
+    float scale;
+    float zero_point;
+};
+
+static uint8_t gray_image[IMG_W * IMG_H];
+static uint8_t rgb_image[IMG_W * IMG_H * 3];
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, const Crop &c, const Quant &q, int mismatches)
+{
+    if (!ok) {
+        printf("FAIL %s crop %d,%d %dx%d scale %g zp %g: %d mismatches\n",
+            what, c.x, c.y, c.w, c.h, q.scale, q.zero_point, mismatches);
+        failures++;
+    }
+}
+
+// The old path: packed 0xRRGGBB pixels read a page at a time through get_data
+static std::vector<int8_t> reference_rgb(const Crop &c, const Quant &q)
+{
+    std::vector<int8_t> out(c.w * c.h);
+    ei::matrix_i8_t matrix(1, out.size(), out.data());
+    signal_t signal;
+    signal.total_length = c.w * c.h;
+    signal.get_data = [&c](size_t offset, size_t length, float *buf) {
+        for (size_t i = 0; i < length; i++) {
+            size_t px = offset + i;
+            const uint8_t *p = rgb_image + ((c.y + px / c.w) * IMG_W + c.x + px % c.w) * 3;
+            buf[i] = static_cast<float>((p[0] << 16) + (p[1] << 8) + p[2]);
+        }
+        return 0;
+    };
+    ei_dsp_config_image_t config = {};
+    config.axes = 1;
+    config.channels = "Grayscale";
+    int res = extract_image_features_quantized(&signal, &matrix, &config, q.scale, q.zero_point, 0,
+        EI_CLASSIFIER_IMAGE_SCALING_NONE);
+    if (res != EIDSP_OK) {
+        printf("FAIL reference returned %d\n", res);
+        failures++;
+    }
+    return out;
+}
+
+// The image DSP block on a luma pixel, no luma transform: round((v / 255) / scale) + zero_point
+static std::vector<int8_t> reference_mono(const Crop &c, const Quant &q)
+{
+    std::vector<int8_t> out;
+    for (int y = 0; y < c.h; y++) {
+        for (int x = 0; x < c.w; x++) {
+            float v = static_cast<float>(gray_image[(c.y + y) * IMG_W + c.x + x]) / 255.0f;
+            out.push_back(static_cast<int8_t>(round(v / q.scale) + q.zero_point));
+        }
+    }
+    return out;
+}
+
+static int count_mismatches(const int8_t *a, const std::vector<int8_t> &b)
+{
+    int n = 0;
+    for (size_t i = 0; i < b.size(); i++) {
+        n += a[i] != b[i];
+    }
+    return n;
+}
+
+static void test_crop(const Crop &c, const Quant &q, int dst_offset)
+{
+    // 16-byte aligned storage, dst_offset moves the output off the alignment
+    alignas(16) static int8_t out[IMG_W * IMG_H + 32];
+    const size_t n = c.w * c.h;
+
+    std::vector<int8_t> ref = reference_mono(c, q);
+    memset(out, 0x55, sizeof(out));
+    int res = ei::image::processing::crop_and_quantize_gray_i8(gray_image, IMG_W, IMG_H, 1,
+        c.x, c.y, c.w, c.h, q.scale, q.zero_point, out + dst_offset);
+    int bad = res == EIDSP_OK ? count_mismatches(out + dst_offset, ref) : -1;
+    check(bad == 0, "mono", c, q, bad);
+    check(out[dst_offset + n] == 0x55 && (dst_offset == 0 || out[dst_offset - 1] == 0x55),
+        "mono bounds", c, q, 0);
+
+    ref = reference_rgb(c, q);
+    memset(out, 0x55, sizeof(out));
+    res = ei::image::processing::crop_and_quantize_gray_i8(rgb_image, IMG_W, IMG_H, 3,
+        c.x, c.y, c.w, c.h, q.scale, q.zero_point, out + dst_offset);
+    bad = res == EIDSP_OK ? count_mismatches(out + dst_offset, ref) : -1;
+    check(bad == 0, "rgb888", c, q, bad);
+    check(out[dst_offset + n] == 0x55, "rgb888 bounds", c, q, 0);
+}
+
+// extract_image_features_quantized on signal_t::image (dispatches to the kernel) against get_data
+static void test_signal_image(const Crop &c, const Quant &q)
+{
+    std::vector<int8_t> out(c.w * c.h);
+    ei::matrix_i8_t matrix(1, out.size(), out.data());
+    ei_signal_image_t image = {
+        rgb_image + (c.y * IMG_W + c.x) * 3, (uint32_t)c.w, (uint32_t)c.h, IMG_W * 3, EI_SIGNAL_IMAGE_RGB888
+    };
+    signal_t signal;
+    signal.total_length = c.w * c.h;
+    signal.image = &image;
+    ei_dsp_config_image_t config = {};
+    config.axes = 1;
+    config.channels = "Grayscale";
+    int res = extract_image_features_quantized(&signal, &matrix, &config, q.scale, q.zero_point, 0,
+        EI_CLASSIFIER_IMAGE_SCALING_NONE);
+    int bad = res == EIDSP_OK ? count_mismatches(out.data(), reference_rgb(c, q)) : -1;
+    check(bad == 0, "signal image rgb888", c, q, bad);
+}
+
+int main()
+{
+    srand(8);
+    for (auto &p : gray_image) {
+        p = rand();
+    }
+    for (auto &p : rgb_image) {
+        p = rand();
+    }
+    // every gray level and the extremes of every channel show up in the first rows
+    for (int v = 0; v < 256; v++) {
+        gray_image[v] = v;
+        rgb_image[v * 3] = rgb_image[v * 3 + 1] = rgb_image[v * 3 + 2] = v;
+        rgb_image[IMG_W * 3 + v * 3] = v;
+        rgb_image[IMG_W * 3 + v * 3 + 1] = 255 - v;
+        rgb_image[IMG_W * 3 + v * 3 + 2] = (v * 7) & 0xff;
+    }
+
+    const Quant quants[] = {
+        { 0.003921568859368563f, -128 },    // 1/255, -128: the model's input, XOR path
+        { 0.00392156862745098f, -127 },
+        { 0.0078125f, -1 },
+        { 0.02f, 3 },
+        { 0.5f, 0 },
+    };
+    std::vector<Crop> crops = {
+        { 0, 0, IMG_W, IMG_H },
+        { 0, 0, 256, 2 },
+        { 40, 115, 240, 48 },   // the meter ROI
+        { 88, 115, 48, 48 },    // one digit
+        { 1, 0, 17, 3 },
+        { 3, 5, 33, 7 },
+        { 15, 2, 47, 5 },
+        { 7, 1, 63, 4 },
+        { 17, 9, 1, 1 },
+        { 319, 239, 1, 1 },
+        { 300, 230, 20, 10 },
+        { 0, 0, 31, 2 },
+    };
+    for (int x = 0; x <= 17; x++) {
+        crops.push_back({ x, 1, 48, 2 });
+        crops.push_back({ x, 3, 16 + x, 2 });
+    }
+
+    for (const Quant &q : quants) {
+        for (const Crop &c : crops) {
+            for (int dst_offset = 0; dst_offset < 2; dst_offset++) {
+                test_crop(c, q, dst_offset);
+            }
+            test_signal_image(c, q);
+        }
+    }
+
+    // out of bounds and unsupported pixel sizes
+    int8_t out[16];
+    const struct { int w, x, pixel_size; } invalid[] = { { 4, IMG_W - 3, 1 }, { -1, 0, 1 }, { 4, 0, 2 } };
+    for (auto &i : invalid) {
+        int res = ei::image::processing::crop_and_quantize_gray_i8(gray_image, IMG_W, IMG_H, i.pixel_size,
+            i.x, 0, i.w, 1, 0.02f, 0, out);
+        if (res != EIDSP_PARAMETER_INVALID) {
+            printf("FAIL invalid crop x %d w %d pixel size %d returned %d\n", i.x, i.w, i.pixel_size, res);
+            failures++;
+        }
+    }
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Two impulse handles classifying on two threads at once (the inference task and the helper
+ * task of the camera) must give the same boxes as when they run one after the other: all the
+ * inference state is per handle. Run on a synthetic seven-segment ROI, through the crop batch
+ * and the tiled whole-ROI paths.
+ */
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+#define ROI_W       240
+#define ROI_H       48
+#define DIGIT_W     EI_CLASSIFIER_INPUT_WIDTH
+#define DIGIT_NUM   (ROI_W / DIGIT_W)
+#define ITERATIONS  30
+
+static uint8_t roi[ROI_W * ROI_H];
+
+static void fill_rect(int x0, int y0, int w, int h)
+{
+    for (int y = y0; y < y0 + h; y++) {
+        for (int x = x0; x < x0 + w; x++) {
+            roi[y * ROI_W + x] = 220;
+        }
+    }
+}
+
+// Light segments on a dark background, 12x24 pixels centered in the slot: not real meter
+// digits, but the model reports boxes on them
+static void draw_digit(int slot, int digit)
+{
+    static const uint8_t segments[10] = { 0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07, 0x7f, 0x6f };
+    const uint8_t m = segments[digit];
+    const int w = 12, h = 24, t = 5;
+    const int x = slot * DIGIT_W + (DIGIT_W - w) / 2, y = (ROI_H - h) / 2;
+    if (m & 0x01) fill_rect(x, y, w, t);
+    if (m & 0x02) fill_rect(x + w - t, y, t, h / 2);
+    if (m & 0x04) fill_rect(x + w - t, y + h / 2, t, h / 2);
+    if (m & 0x08) fill_rect(x, y + h - t, w, t);
+    if (m & 0x10) fill_rect(x, y + h / 2, t, h / 2);
+    if (m & 0x20) fill_rect(x, y, t, h / 2);
+    if (m & 0x40) fill_rect(x, y + (h - t) / 2, w, t);
+}
+
+static int no_data(size_t, size_t, float*)
+{
+    return -1;
+}
+
+// The boxes found in digits [first, first + count) as text, "ERR" if the classifier failed
+static std::string classify(ei_impulse_handle_t* handle, int first, int count, bool tiled)
+{
+    std::string boxes;
+    char buf[64];
+
+    if (tiled) {
+        ei_signal_image_t image = {
+            roi + first * DIGIT_W, (uint32_t)(count * DIGIT_W), ROI_H, ROI_W, EI_SIGNAL_IMAGE_GRAY8
+        };
+        signal_t signal;
+        signal.total_length = count * DIGIT_W * ROI_H;
+        signal.image = &image;
+        signal.get_data = no_data;
+        ei_impulse_result_t result;
+        if (run_classifier_image_tiled(handle, &signal, count, &result) != EI_IMPULSE_OK) {
+            return "ERR";
+        }
+        for (uint32_t i = 0; i < result.bounding_boxes_count; i++) {
+            const ei_impulse_result_bounding_box_t& bb = result.bounding_boxes[i];
+            snprintf(buf, sizeof(buf), "%s@%u,%u=%.4f ", bb.label, (unsigned)(bb.x + first * DIGIT_W),
+                (unsigned)bb.y, bb.value);
+            boxes += buf;
+        }
+        return boxes;
+    }
+
+    ei_signal_image_t images[DIGIT_NUM];
+    signal_t signals[DIGIT_NUM];
+    signal_t* signal_ptrs[DIGIT_NUM];
+    ei_impulse_result_t results[DIGIT_NUM];
+    for (int i = 0; i < count; i++) {
+        images[i] = { roi + (first + i) * DIGIT_W, DIGIT_W, ROI_H, ROI_W, EI_SIGNAL_IMAGE_GRAY8 };
+        signals[i].total_length = DIGIT_W * ROI_H;
+        signals[i].image = &images[i];
+        signals[i].get_data = no_data;
+        signal_ptrs[i] = &signals[i];
+    }
+    if (run_classifier_batch(handle, signal_ptrs, count, results) != EI_IMPULSE_OK) {
+        return "ERR";
+    }
+    for (int d = 0; d < count; d++) {
+        for (uint32_t i = 0; i < results[d].bounding_boxes_count; i++) {
+            const ei_impulse_result_bounding_box_t& bb = results[d].bounding_boxes[i];
+            snprintf(buf, sizeof(buf), "%d:%s=%.4f ", first + d, bb.label, bb.value);
+            boxes += buf;
+        }
+    }
+    return boxes;
+}
+
+int main()
+{
+    for (auto& p : roi) {
+        p = 30;
+    }
+    for (int slot = 0; slot < DIGIT_NUM; slot++) {
+        draw_digit(slot, slot + 2);
+    }
+
+    // the first digits on the default handle, the last two on a second one, as the camera does
+    ei_impulse_handle_t helper(ei_default_impulse.impulse);
+    run_classifier_init(&ei_default_impulse);
+    run_classifier_init(&helper);
+    const int split = DIGIT_NUM - 2;
+
+    int failures = 0;
+    for (int tiled = 0; tiled < 2; tiled++) {
+        const std::string main_ref = classify(&ei_default_impulse, 0, split, tiled);
+        const std::string helper_ref = classify(&helper, split, DIGIT_NUM - split, tiled);
+        printf("%s: %s| %s\n", tiled ? "tiled" : "batch", main_ref.c_str(), helper_ref.c_str());
+        // no boxes at all would make the comparison below meaningless
+        if (main_ref == "ERR" || helper_ref == "ERR" || main_ref.empty() || helper_ref.empty()) {
+            printf("FAIL %s: sequential run\n", tiled ? "tiled" : "batch");
+            failures++;
+            continue;
+        }
+
+        int mismatches = 0;
+        std::thread helper_thread([&] {
+            for (int i = 0; i < ITERATIONS; i++) {
+                mismatches += classify(&helper, split, DIGIT_NUM - split, tiled) != helper_ref;
+            }
+        });
+        int main_mismatches = 0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            main_mismatches += classify(&ei_default_impulse, 0, split, tiled) != main_ref;
+        }
+        helper_thread.join();
+        if (mismatches || main_mismatches) {
+            printf("FAIL %s: %d + %d of %d parallel runs differ from the sequential ones\n",
+                tiled ? "tiled" : "batch", main_mismatches, mismatches, ITERATIONS);
+            failures++;
+        }
+    }
+
+    run_classifier_deinit(&helper);
+    run_classifier_deinit(&ei_default_impulse);
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
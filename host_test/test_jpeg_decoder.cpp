@@ -0,0 +1,283 @@
+/*
+ * JpegDecoder (main/jpeg) against libjpeg: frames encoded by libjpeg with the subsamplings,
+ * qualities and restart intervals a camera may use, decoded by both to RGB888, GRAY8 and the
+ * 1/8 scale DC thumbnail. libjpeg runs with the
+ * integer IDCT and no fancy upsampling, which is what JpegDecoder implements, so the output
+ * must match exactly. Truncated, cut and corrupt frames must fail without reading out of bounds.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <jpeglib.h>
+#include "jpeg_decoder.hpp"
+
+#define IMG_W 320
+#define IMG_H 240
+
+struct EncodeParams {
+    int components;
+    int h_samp, v_samp;     // luma sampling factors (chroma is 1x1)
+    int quality;
+    int restart_rows;       // 0: no restart markers
+};
+
+struct Window {
+    int x, y, w, h;
+};
+
+static int failures = 0;
+
+static std::vector<uint8_t> encode(const std::vector<uint8_t>& rgb, int w, int h, const EncodeParams& p)
+{
+    jpeg_compress_struct c;
+    jpeg_error_mgr err;
+    c.err = jpeg_std_error(&err);
+    jpeg_create_compress(&c);
+    unsigned char* buf = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&c, &buf, &size);
+    c.image_width = w;
+    c.image_height = h;
+    c.input_components = 3;
+    c.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&c);
+    jpeg_set_quality(&c, p.quality, TRUE);
+    if (p.components == 1) {
+        jpeg_set_colorspace(&c, JCS_GRAYSCALE);
+    }
+    else {
+        c.comp_info[0].h_samp_factor = p.h_samp;
+        c.comp_info[0].v_samp_factor = p.v_samp;
+    }
+    c.restart_in_rows = p.restart_rows;
+    jpeg_start_compress(&c, TRUE);
+    while (c.next_scanline < (unsigned)h) {
+        JSAMPROW row = (JSAMPROW)&rgb[c.next_scanline * w * 3];
+        jpeg_write_scanlines(&c, &row, 1);
+    }
+    jpeg_finish_compress(&c);
+    std::vector<uint8_t> jpg(buf, buf + size);
+    free(buf);
+    jpeg_destroy_compress(&c);
+    return jpg;
+}
+
+// scale_denom 8 is libjpeg's DC-only decode, one pixel per 8x8 block
+static std::vector<uint8_t> reference_decode(const std::vector<uint8_t>& jpg, J_COLOR_SPACE color_space, int bpp,
+                                             int scale_denom = 1)
+{
+    jpeg_decompress_struct d;
+    jpeg_error_mgr err;
+    d.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&d);
+    jpeg_mem_src(&d, jpg.data(), jpg.size());
+    jpeg_read_header(&d, TRUE);
+    d.out_color_space = color_space;
+    d.dct_method = JDCT_ISLOW;
+    d.do_fancy_upsampling = FALSE;
+    d.scale_num = 1;
+    d.scale_denom = scale_denom;
+    jpeg_start_decompress(&d);
+    std::vector<uint8_t> out(d.output_width * d.output_height * bpp);
+    while (d.output_scanline < d.output_height) {
+        JSAMPROW row = &out[d.output_scanline * d.output_width * bpp];
+        jpeg_read_scanlines(&d, &row, 1);
+    }
+    jpeg_finish_decompress(&d);
+    jpeg_destroy_decompress(&d);
+    return out;
+}
+
+// Gradients, noise, a checkerboard (worst case for the AC coefficients) and dark digit-like bars
+static std::vector<uint8_t> test_image(int w, int h)
+{
+    std::vector<uint8_t> img(w * h * 3);
+    srand(7);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint8_t* p = &img[(y * w + x) * 3];
+            p[0] = (x * 255 / w) ^ (rand() & 31);
+            p[1] = (y * 255 / h) + (rand() & 15);
+            p[2] = ((x / 13 + y / 7) & 1) ? 220 : 30;
+            if (y > 110 && y < 170 && (x % 48) > 14 && (x % 48) < 34) {
+                p[0] = p[1] = p[2] = 10;
+            }
+            if (y < 64) {
+                p[0] = p[1] = p[2] = ((x ^ y) & 1) ? 255 : 0;
+            }
+        }
+    }
+    return img;
+}
+
+// Offset of the first marker FF <marker> (0 if there is none)
+static size_t find_marker(const std::vector<uint8_t>& jpg, uint8_t marker)
+{
+    for (size_t i = 2; i + 1 < jpg.size(); i++) {
+        if (jpg[i] == 0xFF && jpg[i + 1] == marker) return i;
+    }
+    return 0;
+}
+
+static void check_window(const char* what, const EncodeParams& p, const Window& wn, bool ok,
+                         const uint8_t* out, const std::vector<uint8_t>& ref, int bpp)
+{
+    int mismatches = 0;
+    for (int y = 0; y < wn.h; y++) {
+        for (int x = 0; x < wn.w * bpp; x++) {
+            mismatches += out[y * wn.w * bpp + x] != ref[((wn.y + y) * IMG_W + wn.x) * bpp + x];
+        }
+    }
+    if (!ok || mismatches) {
+        printf("FAIL %s: %d components %dx%d q%d restart %d, window %d,%d %dx%d: ok %d, %d mismatches\n",
+            what, p.components, p.h_samp, p.v_samp, p.quality, p.restart_rows, wn.x, wn.y, wn.w, wn.h,
+            ok, mismatches);
+        failures++;
+    }
+}
+
+int main()
+{
+    const std::vector<uint8_t> img = test_image(IMG_W, IMG_H);
+    const EncodeParams params[] = {
+        { 3, 2, 1, 80, 0 },     // 4:2:2, the OV2640 default
+        { 3, 2, 1, 80, 1 },
+        { 3, 2, 2, 60, 0 },     // 4:2:0
+        { 3, 1, 2, 80, 0 },     // 4:4:0
+        { 3, 1, 1, 95, 2 },     // 4:4:4
+        { 3, 1, 1, 100, 0 },
+        { 3, 2, 1, 30, 1 },
+        { 1, 1, 1, 80, 0 },     // grayscale
+        { 1, 1, 1, 75, 1 },
+    };
+    const Window windows[] = {
+        { 40, 115, 240, 48 },   // the meter ROI
+        { 0, 0, IMG_W, IMG_H },
+        { 3, 5, 17, 9 },
+        { 300, 230, 20, 10 },
+        { 16, 8, 16, 8 },
+    };
+
+    JpegDecoder decoder;
+    for (const EncodeParams& p : params) {
+        const std::vector<uint8_t> jpg = encode(img, IMG_W, IMG_H, p);
+
+        const std::vector<uint8_t> ref = reference_decode(jpg, JCS_EXT_BGR, 3);
+        for (const Window& wn : windows) {
+            std::vector<uint8_t> out(wn.w * wn.h * 3, 0xAA);
+            bool ok = decoder.decode_roi(jpg.data(), jpg.size(), wn.x, wn.y, wn.w, wn.h, out.data());
+            check_window("rgb888", p, wn, ok, out.data(), ref, 3);
+        }
+
+        // GRAY8 is the Y plane as libjpeg outputs it for JCS_GRAYSCALE
+        const std::vector<uint8_t> gray_ref = reference_decode(jpg, JCS_GRAYSCALE, 1);
+        for (const Window& wn : windows) {
+            std::vector<uint8_t> out(wn.w * wn.h, 0xAA);
+            bool ok = decoder.decode_roi(jpg.data(), jpg.size(), wn.x, wn.y, wn.w, wn.h, out.data(),
+                                         JpegFormat::GRAY8);
+            check_window("gray8", p, wn, ok, out.data(), gray_ref, 1);
+        }
+    }
+
+    // DC thumbnails of the QVGA frame and of one that is not a whole number of MCUs
+    for (int size = 0; size < 2; size++) {
+        const int w = size ? 317 : IMG_W;
+        const int h = size ? 233 : IMG_H;
+        const std::vector<uint8_t> frame = test_image(w, h);
+        for (const EncodeParams& p : params) {
+            const std::vector<uint8_t> jpg = encode(frame, w, h, p);
+            const std::vector<uint8_t> ref = reference_decode(jpg, JCS_GRAYSCALE, 1, 8);
+            std::vector<uint8_t> thumb(64 * 64, 0xAA);
+            bool ok = decoder.decode_dc_thumbnail(jpg.data(), jpg.size(), thumb.data(), 64, 64);
+            int mismatches = 0;
+            for (size_t i = 0; i < ref.size(); i++) {
+                mismatches += thumb[i] != ref[i];
+            }
+            if (!ok || mismatches || ref.size() != (size_t)((w + 7) / 8 * ((h + 7) / 8))) {
+                printf("FAIL thumbnail %dx%d: %d components %dx%d q%d restart %d: ok %d, %d mismatches\n",
+                    w, h, p.components, p.h_samp, p.v_samp, p.quality, p.restart_rows, ok, mismatches);
+                failures++;
+            }
+            // out too small for the thumbnail
+            if (decoder.decode_dc_thumbnail(jpg.data(), jpg.size(), thumb.data(), (w + 7) / 8 - 1, 64)) {
+                printf("FAIL thumbnail %dx%d decoded into a smaller buffer\n", w, h);
+                failures++;
+            }
+        }
+    }
+
+    // windows outside the image, truncated and corrupt data fail without reading out of bounds
+    const std::vector<uint8_t> jpg = encode(img, IMG_W, IMG_H, params[0]);
+    std::vector<uint8_t> out(IMG_W * IMG_H * 3);
+    const Window outside[] = { { 300, 0, 21, 8 }, { 0, 239, 8, 2 }, { -1, 0, 8, 8 }, { 0, 0, 0, 8 } };
+    for (const Window& wn : outside) {
+        if (decoder.decode_roi(jpg.data(), jpg.size(), wn.x, wn.y, wn.w, wn.h, out.data())) {
+            printf("FAIL window %d,%d %dx%d outside the image decoded\n", wn.x, wn.y, wn.w, wn.h);
+            failures++;
+        }
+    }
+    // (decoding stops after the window, so a whole frame window needs all the entropy data)
+    for (size_t cut : { (size_t)10, (size_t)300, jpg.size() / 2, jpg.size() - 100 }) {
+        if (decoder.decode_roi(jpg.data(), cut, 0, 0, IMG_W, IMG_H, out.data()) ||
+            decoder.decode_dc_thumbnail(jpg.data(), cut, out.data(), 64, 64)) {
+            printf("FAIL jpeg truncated to %zu bytes decoded\n", cut);
+            failures++;
+        }
+    }
+    // a short frame ended by EOI mid-scan: the rows before the cut decode, the window across it fails
+    for (const EncodeParams& p : { params[0], params[7] }) {
+        const std::vector<uint8_t> full = encode(img, IMG_W, IMG_H, p);
+        std::vector<uint8_t> cut(full.begin(), full.begin() + full.size() / 2);
+        cut.push_back(0xFF);
+        cut.push_back(0xD9);
+        const std::vector<uint8_t> ref = reference_decode(full, JCS_EXT_BGR, 3);
+        const Window top = { 0, 0, IMG_W, 16 };
+        bool ok = decoder.decode_roi(cut.data(), cut.size(), top.x, top.y, top.w, top.h, out.data());
+        check_window("eoi cut, rows before", p, top, ok, out.data(), ref, 3);
+        if (decoder.decode_roi(cut.data(), cut.size(), 0, 0, IMG_W, IMG_H, out.data()) ||
+            decoder.decode_dc_thumbnail(cut.data(), cut.size(), out.data(), 64, 64)) {
+            printf("FAIL jpeg cut by EOI decoded\n");
+            failures++;
+        }
+    }
+
+    // header segments: a DHT with more codes than fit, an SOS without its component count
+    const size_t dht = find_marker(jpg, 0xC4), sos = find_marker(jpg, 0xDA);
+    std::vector<uint8_t> bad = jpg;
+    bad[dht + 5] = 3;   // three 1-bit codes
+    if (decoder.decode_roi(bad.data(), bad.size(), 40, 115, 240, 48, out.data()) ||
+        decoder.decode_dc_thumbnail(bad.data(), bad.size(), out.data(), 64, 64)) {
+        printf("FAIL jpeg with an oversubscribed DHT decoded\n");
+        failures++;
+    }
+    bad = jpg;
+    bad[sos + 2] = 0;
+    bad[sos + 3] = 2;
+    bad.resize(sos + 4);    // the segment is the last byte of the data
+    if (decoder.decode_roi(bad.data(), bad.size(), 40, 115, 240, 48, out.data())) {
+        printf("FAIL jpeg with an empty SOS decoded\n");
+        failures++;
+    }
+
+    // corrupt headers (SOF, DHT, DQT, SOS) and entropy data, run under ASan/UBSan where available
+    const size_t header_end = sos + 2 + ((jpg[sos + 2] << 8) | jpg[sos + 3]);
+    for (int i = 0; i < 3000; i++) {
+        std::vector<uint8_t> corrupt = jpg;
+        for (int n = 0; n < 1 + i % 3; n++) {
+            corrupt[2 + rand() % (header_end - 2)] = rand();
+        }
+        decoder.decode_roi(corrupt.data(), corrupt.size(), 40, 115, 240, 48, out.data());
+        decoder.decode_dc_thumbnail(corrupt.data(), corrupt.size(), out.data(), 64, 64);
+    }
+    for (int i = 0; i < 200; i++) {
+        std::vector<uint8_t> corrupt = jpg;
+        for (int n = 0; n < 5; n++) {
+            corrupt[600 + rand() % (corrupt.size() - 600)] = rand();
+        }
+        decoder.decode_roi(corrupt.data(), corrupt.size(), 40, 115, 240, 48, out.data());
+        decoder.decode_dc_thumbnail(corrupt.data(), corrupt.size(), out.data(), 64, 64);
+    }
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
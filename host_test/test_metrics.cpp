@@ -0,0 +1,128 @@
+/*
+ * Metrics (main/metrics): a small registry rendered through a flush buffer of a few bytes must
+ * give the exact Prometheus text: one HELP and TYPE per family with its members after it, the
+ * cumulative le buckets of a histogram and its 64-bit sum.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "metrics.hpp"
+
+static_assert(HISTOGRAM_MIN_US == 64 && HISTOGRAM_BUCKETS == 17, "the expected text has these buckets");
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// Registered in this order, rendered newest first
+static Counter requests_a("test_requests_total", "path=\"/a\"", "HTTP requests");
+static Gauge temperature("test_temperature_celsius", nullptr, "Sensor temperature");
+static Counter requests_b("test_requests_total", "path=\"/b\"", "HTTP requests");
+static Histogram latency("test_latency_seconds", "stage=\"infer\"", "Inference time");
+static uint32_t queue_depth = 7;
+static CallbackMetric queued("test_queue_depth", nullptr, "Frames queued", Metric::GAUGE,
+                             CallbackMetric::read_u32, &queue_depth);
+
+static const char EXPECTED[] =
+    "# HELP test_queue_depth Frames queued\n"
+    "# TYPE test_queue_depth gauge\n"
+    "test_queue_depth 7\n"
+    "# HELP test_latency_seconds Inference time\n"
+    "# TYPE test_latency_seconds histogram\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.000064\"} 2\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.000128\"} 4\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.000256\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.000512\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.001024\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.002048\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.004096\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.008192\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.016384\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.032768\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.065536\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.131072\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.262144\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"0.524288\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"1.048576\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"2.097152\"} 5\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"4.194304\"} 6\n"
+    "test_latency_seconds_bucket{stage=\"infer\",le=\"+Inf\"} 8\n"
+    "test_latency_seconds_sum{stage=\"infer\"} 4304.161985\n"
+    "test_latency_seconds_count{stage=\"infer\"} 8\n"
+    "# HELP test_requests_total HTTP requests\n"
+    "# TYPE test_requests_total counter\n"
+    "test_requests_total{path=\"/b\"} 42\n"
+    "test_requests_total{path=\"/a\"} 3\n"
+    "# HELP test_temperature_celsius Sensor temperature\n"
+    "# TYPE test_temperature_celsius gauge\n"
+    "test_temperature_celsius -5\n";
+
+struct Output {
+    std::string text;
+    size_t longest = 0;         // flushed at once
+    int flushes_left = -1;      // fails after that many flushes, -1 never
+};
+
+static bool flush(const char* data, size_t len, void* arg)
+{
+    Output* out = static_cast<Output*>(arg);
+    if (out->flushes_left == 0) return false;
+    if (out->flushes_left > 0) out->flushes_left--;
+    out->text.append(data, len);
+    if (len > out->longest) out->longest = len;
+    return true;
+}
+
+static std::string written(void (*fill)(MetricsWriter& w))
+{
+    char buf[5];
+    Output out;
+    MetricsWriter w(buf, sizeof(buf), flush, &out);
+    fill(w);
+    CHECK(w.finish());
+    return out.text;
+}
+
+int main()
+{
+    // The number formats
+    CHECK(written([](MetricsWriter& w) { w.u64(0); }) == "0");
+    CHECK(written([](MetricsWriter& w) { w.u64(UINT64_MAX); }) == "18446744073709551615");
+    CHECK(written([](MetricsWriter& w) { w.i64(-5); w.chr(' '); w.i64(INT64_MIN); }) == "-5 -9223372036854775808");
+    CHECK(written([](MetricsWriter& w) { w.seconds(0); }) == "0.000000");
+    CHECK(written([](MetricsWriter& w) { w.seconds(1234567); }) == "1.234567");
+    CHECK(written([](MetricsWriter& w) { w.seconds(64); }) == "0.000064");
+    CHECK(written([](MetricsWriter& w) { w.str("longer than the buffer"); }) == "longer than the buffer");
+
+    requests_a.inc(3);
+    requests_b.inc();
+    requests_b.inc(41);
+    temperature.set(-5);
+    // Bucket bounds are inclusive, the last observation carries into the high word of the sum
+    static const uint32_t observations[] = { 0, 64, 65, 128, 129, 4194304, 5000000, UINT32_MAX };
+    for (uint32_t us : observations) latency.observe_us(us);
+
+    for (size_t size = 1; size <= 64; size++) {
+        char buf[64];
+        Output out;
+        MetricsWriter w(buf, size, flush, &out);
+        CHECK(Metric::render_all(w));
+        CHECK(out.text == EXPECTED && out.longest == size);
+    }
+
+    // A failed flush (the client went away) fails the render, nothing is sent after it
+    char buf[16];
+    Output out;
+    out.flushes_left = 3;
+    MetricsWriter w(buf, sizeof(buf), flush, &out);
+    CHECK(!Metric::render_all(w));
+    CHECK(out.text == std::string(EXPECTED, 3 * sizeof(buf)));
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
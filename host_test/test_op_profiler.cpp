@@ -0,0 +1,134 @@
+/*
+ * Per-op profiler of the resident interpreters (EI_CLASSIFIER_OP_PROFILER, see CMakeLists.txt):
+ * the real model classifying digit crops and the whole ROI must have every one of its op types
+ * timed, the counts following the Invoke() calls, and reset() starting over.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+#define ROI_W       240
+#define ROI_H       48
+#define DIGIT_W     EI_CLASSIFIER_INPUT_WIDTH
+#define DIGIT_NUM   (ROI_W / DIGIT_W)
+#define ROUNDS      3
+
+static uint8_t roi[ROI_W * ROI_H];
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+static int no_data(size_t, size_t, float*)
+{
+    return -1;
+}
+
+static bool classify_crops()
+{
+    ei_signal_image_t images[DIGIT_NUM];
+    signal_t signals[DIGIT_NUM];
+    signal_t* signal_ptrs[DIGIT_NUM];
+    ei_impulse_result_t results[DIGIT_NUM];
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        images[i] = { roi + i * DIGIT_W, DIGIT_W, ROI_H, ROI_W, EI_SIGNAL_IMAGE_GRAY8 };
+        signals[i].total_length = DIGIT_W * ROI_H;
+        signals[i].image = &images[i];
+        signals[i].get_data = no_data;
+        signal_ptrs[i] = &signals[i];
+    }
+    return run_classifier_batch(&ei_default_impulse, signal_ptrs, DIGIT_NUM, results) == EI_IMPULSE_OK;
+}
+
+static bool classify_roi()
+{
+    ei_signal_image_t image = { roi, ROI_W, ROI_H, ROI_W, EI_SIGNAL_IMAGE_GRAY8 };
+    signal_t signal;
+    signal.total_length = ROI_W * ROI_H;
+    signal.image = &image;
+    signal.get_data = no_data;
+    ei_impulse_result_t result;
+    return run_classifier_image_tiled(&ei_default_impulse, &signal, DIGIT_NUM, &result) == EI_IMPULSE_OK;
+}
+
+// Op types of the model, each timed at every Invoke()
+static void check_ops(ei_op_profiler_t* profiler, uint32_t invokes)
+{
+    static const char* const model_ops[] = { "ADD", "CONV_2D", "DEPTHWISE_CONV_2D", "PAD", "SOFTMAX" };
+    ei_op_profile_t ops[EI_OP_PROFILER_MAX_OPS];
+    const size_t op_count = profiler->get_ops(ops, EI_OP_PROFILER_MAX_OPS);
+    CHECK(profiler->get_invokes() == invokes);
+
+    uint64_t ops_us = 0;
+    for (const char* name : model_ops) {
+        bool found = false;
+        for (size_t i = 0; i < op_count; i++) {
+            found |= strcmp(ops[i].name, name) == 0;
+        }
+        if (!found) {
+            printf("FAIL op %s not profiled\n", name);
+            failures++;
+        }
+    }
+    for (size_t i = 0; i < op_count; i++) {
+        const ei_op_profile_t& op = ops[i];
+        uint32_t in_histogram = 0;
+        for (uint32_t n : op.histogram) {
+            in_histogram += n;
+        }
+        // every node of the type once per Invoke()
+        if (op.count == 0 || op.count % invokes != 0 || in_histogram != op.count || op.min_us > op.max_us) {
+            printf("FAIL op %s: count %u over %u invokes, %u in the histogram, min %u max %u\n", op.name,
+                (unsigned)op.count, (unsigned)invokes, (unsigned)in_histogram, (unsigned)op.min_us,
+                (unsigned)op.max_us);
+            failures++;
+        }
+        ops_us += op.total_us;
+    }
+    CHECK(ops_us <= profiler->get_invoke_total_us());
+}
+
+int main()
+{
+    for (int i = 0; i < ROI_W * ROI_H; i++) {
+        roi[i] = (i % ROI_W) % DIGIT_W < DIGIT_W / 2 ? 200 : 40;
+    }
+
+    run_classifier_init(&ei_default_impulse);
+    ei_op_profiler_t* profiler = run_classifier_op_profiler(&ei_default_impulse);
+    CHECK(profiler != nullptr && run_classifier_op_profiler(&ei_default_impulse, true) == nullptr);
+    if (!profiler) {
+        printf("FAIL: %d failures\n", failures);
+        return 1;
+    }
+
+    for (int round = 0; round < ROUNDS; round++) {
+        CHECK(classify_crops());
+    }
+    check_ops(profiler, ROUNDS * DIGIT_NUM);
+    profiler->log();
+
+    // applied when the next Invoke() starts
+    profiler->reset();
+    CHECK(classify_crops());
+    check_ops(profiler, DIGIT_NUM);
+
+    // the whole ROI interpreter has a profiler of its own
+    CHECK(classify_roi());
+    ei_op_profiler_t* tiled = run_classifier_op_profiler(&ei_default_impulse, true);
+    CHECK(tiled != nullptr && tiled != profiler);
+    if (tiled) {
+        check_ops(tiled, 1);
+        tiled->log();
+    }
+    CHECK(profiler->get_invokes() == DIGIT_NUM);
+
+    run_classifier_deinit(&ei_default_impulse);
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * QOI codec (main/qoi): lossless round trips of GRAY8 and RGB888 images, RGB888 streams checked
+ * by a straightforward decoder written from the qoiformat.org spec, crops through the stride,
+ * and truncated streams and small output buffers rejected.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "qoi_codec.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// Reference decoder of a 3/4 channel stream to R, G, B
+static bool reference_decode(const uint8_t* d, size_t n, std::vector<uint8_t>& out, int* w, int* h)
+{
+    struct Pixel { uint8_t r, g, b, a; };
+    if (n < QOI_HEADER_SIZE + QOI_END_SIZE || memcmp(d, "qoif", 4) != 0) return false;
+    *w = (d[4] << 24) | (d[5] << 16) | (d[6] << 8) | d[7];
+    *h = (d[8] << 24) | (d[9] << 16) | (d[10] << 8) | d[11];
+    out.resize(*w * *h * 3);
+    Pixel index[64] = {};
+    Pixel px = { 0, 0, 0, 255 };
+    size_t p = QOI_HEADER_SIZE;
+    int run = 0;
+    for (int i = 0; i < *w * *h; i++) {
+        if (run > 0) {
+            run--;
+        }
+        else {
+            if (p >= n - QOI_END_SIZE) return false;
+            int b = d[p++];
+            if (b == 0xfe) {
+                px.r = d[p++]; px.g = d[p++]; px.b = d[p++];
+            }
+            else if (b == 0xff) {
+                px.r = d[p++]; px.g = d[p++]; px.b = d[p++]; px.a = d[p++];
+            }
+            else if ((b >> 6) == 0) {
+                px = index[b];
+            }
+            else if ((b >> 6) == 1) {
+                px.r += ((b >> 4) & 3) - 2;
+                px.g += ((b >> 2) & 3) - 2;
+                px.b += (b & 3) - 2;
+            }
+            else if ((b >> 6) == 2) {
+                int b2 = d[p++];
+                int vg = (b & 63) - 32;
+                px.r += vg - 8 + ((b2 >> 4) & 15);
+                px.g += vg;
+                px.b += vg - 8 + (b2 & 15);
+            }
+            else {
+                run = b & 63;
+            }
+            index[(px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64] = px;
+        }
+        out[i * 3] = px.r;
+        out[i * 3 + 1] = px.g;
+        out[i * 3 + 2] = px.b;
+    }
+    static const uint8_t end[QOI_END_SIZE] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    return p + QOI_END_SIZE == n && memcmp(d + p, end, QOI_END_SIZE) == 0;
+}
+
+// A meter ROI: smooth background, dark digit strokes, sensor noise
+static void meter_roi(uint8_t* roi, int w, int h)
+{
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int v = 170 + x / 20 - y / 6;
+            int dx = x % 48 - 24, dy = y - 24;
+            if (abs(abs(dx) - 8) < 3 && abs(dy) < 16) v = 40;
+            if (abs(abs(dy) - 14) < 3 && abs(dx) < 8) v = 45;
+            roi[y * w + x] = v + rand() % 7 - 3;
+        }
+    }
+}
+
+int main()
+{
+    srand(1);
+    const int W = 240, H = 48;
+    static uint8_t roi[W * H];
+    static uint8_t enc[QOI_MAX_SIZE(W, H)];
+    static uint8_t dec[W * H * 3];
+    int w, h;
+
+    // GRAY8 round trip, and decoded to RGB888 (gray replicated)
+    meter_roi(roi, W, H);
+    size_t n = qoi_encode(roi, W, H, W, QoiFormat::GRAY8, enc, sizeof(enc));
+    CHECK(n > 0 && n < (size_t)(W * H));
+    CHECK(qoi_decode(enc, n, dec, sizeof(dec), QoiFormat::GRAY8, &w, &h) && w == W && h == H &&
+          memcmp(dec, roi, W * H) == 0);
+    CHECK(qoi_decode(enc, n, dec, sizeof(dec), QoiFormat::RGB888, &w, &h));
+    bool replicated = true;
+    for (int i = 0; i < W * H; i++) {
+        replicated &= dec[i * 3] == roi[i] && dec[i * 3 + 1] == roi[i] && dec[i * 3 + 2] == roi[i];
+    }
+    CHECK(replicated);
+
+    // a crop through the stride
+    n = qoi_encode(roi + 48, 48, 48, W, QoiFormat::GRAY8, enc, sizeof(enc));
+    CHECK(qoi_decode(enc, n, dec, sizeof(dec), QoiFormat::GRAY8, &w, &h) && w == 48 && h == 48);
+    bool crop_ok = true;
+    for (int y = 0; y < 48; y++) {
+        crop_ok &= memcmp(dec + y * 48, roi + y * W + 48, 48) == 0;
+    }
+    CHECK(crop_ok);
+
+    // truncated streams and small buffers
+    n = qoi_encode(roi, W, H, W, QoiFormat::GRAY8, enc, sizeof(enc));
+    bool truncated_ok = true;
+    for (size_t len = 0; len < n; len++) {
+        truncated_ok &= !qoi_decode(enc, len, dec, sizeof(dec), QoiFormat::GRAY8, &w, &h);
+    }
+    CHECK(truncated_ok);
+    CHECK(!qoi_decode(enc, n, dec, W * H - 1, QoiFormat::GRAY8, &w, &h));
+    CHECK(qoi_encode(roi, W, H, W, QoiFormat::GRAY8, enc, 100) == 0);
+
+    // RGB888 (B, G, R in memory) is standard QOI in R, G, B order
+    const int CW = 64, CH = 40;
+    static uint8_t bgr[CW * CH * 3];
+    static uint8_t color_enc[QOI_MAX_SIZE(CW, CH)];
+    for (int i = 0; i < CW * CH * 3; i++) {
+        bgr[i] = i % 3 == 0 ? (i / 50) & 255 : rand() % ((i % 7) + 1) * 20;
+    }
+    n = qoi_encode(bgr, CW, CH, CW * 3, QoiFormat::RGB888, color_enc, sizeof(color_enc));
+    std::vector<uint8_t> ref;
+    CHECK(reference_decode(color_enc, n, ref, &w, &h) && w == CW && h == CH);
+    bool spec_ok = ref.size() == sizeof(bgr);
+    for (int i = 0; spec_ok && i < CW * CH; i++) {
+        spec_ok = ref[i * 3] == bgr[i * 3 + 2] && ref[i * 3 + 1] == bgr[i * 3 + 1] && ref[i * 3 + 2] == bgr[i * 3];
+    }
+    CHECK(spec_ok);
+    CHECK(qoi_decode(color_enc, n, dec, sizeof(dec), QoiFormat::RGB888, &w, &h) &&
+          memcmp(dec, bgr, sizeof(bgr)) == 0);
+    truncated_ok = true;
+    for (size_t len = 0; len < n; len++) {
+        truncated_ok &= !qoi_decode(color_enc, len, dec, sizeof(dec), QoiFormat::RGB888, &w, &h);
+    }
+    CHECK(truncated_ok);
+
+    // random GRAY8 images: noise, slow drift, runs, large steps
+    for (int it = 0; it < 2000; it++) {
+        const int iw = 1 + rand() % 70, ih = 1 + rand() % 20;
+        static uint8_t img[70 * 20], out[70 * 20];
+        const int mode = rand() % 4;
+        for (int i = 0; i < iw * ih; i++) {
+            const int prev = i ? img[i - 1] : 7;
+            img[i] = mode == 0 ? rand() :
+                     mode == 1 ? prev + rand() % 9 - 4 :
+                     mode == 2 ? (rand() % 5 ? prev : rand()) :
+                                 prev + rand() % 130 - 65;
+        }
+        size_t m = qoi_encode(img, iw, ih, iw, QoiFormat::GRAY8, enc, QOI_MAX_SIZE(iw, ih));
+        if (!m || !qoi_decode(enc, m, out, sizeof(out), QoiFormat::GRAY8, &w, &h) || w != iw || h != ih ||
+            memcmp(out, img, iw * ih) != 0) {
+            printf("FAIL random image %d (%dx%d, mode %d)\n", it, iw, ih, mode);
+            failures++;
+        }
+    }
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
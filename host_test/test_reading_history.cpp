@@ -0,0 +1,242 @@
+/*
+ * Reading history (main/history): a sequence of readings taken every few seconds, with the clock
+ * jumping from uptime to the wall clock, unrecognized digits and enough changes to overwrite the
+ * ring, added and queried back. Every bucket must hold the min/max/last of the raw readings in it,
+ * plus the reading still shown at its start (recorded less than HISTORY_KEEPALIVE_S before),
+ * however the steady readings between records were skipped.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "reading_history.hpp"
+
+#define PERIOD_S    7       // between readings
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+struct Reading {
+    uint32_t time;
+    bool valid;
+    int32_t value;
+    uint8_t confidence;     // lowest digit confidence, percent
+    uint32_t nibbles;       // every digit confidence, as add() compares them
+    bool recorded;          // not skipped as equal to the last record
+};
+
+static std::vector<Reading> readings;
+static size_t recorded = 0;
+
+// Digit scores derive from the value, equal readings have equal confidences
+static void add_reading(ReadingHistory& history, uint32_t time, int32_t value, bool valid)
+{
+    static Reading last;
+    static bool has_last = false;
+
+    char digits[DIGIT_NUM];
+    float scores[DIGIT_NUM];
+    int32_t v = value;
+    uint8_t min_nibble = 15;
+    uint32_t nibbles = 0;
+    for (int i = DIGIT_NUM - 1; i >= 0; i--, v /= 10) {
+        digits[i] = (char)('0' + v % 10);
+        scores[i] = (float)(10 + (value + i) % 6) / 15.0f;
+        uint8_t nibble = (uint8_t)(scores[i] * 15.0f + 0.5f);
+        if (nibble < min_nibble) min_nibble = nibble;
+        nibbles |= (uint32_t)nibble << (i * 4);
+    }
+    if (!valid) digits[value % DIGIT_NUM] = DIGIT_EMPTY;
+
+    Reading r = { time, valid, value, (uint8_t)(min_nibble * 100 / 15), nibbles, true };
+    // The keepalive rule of ReadingHistory::add()
+    if (has_last && r.valid == last.valid && (!r.valid || r.value == last.value) &&
+        r.nibbles == last.nibbles && time - last.time < HISTORY_KEEPALIVE_S) {
+        r.recorded = false;
+    } else {
+        last = r;
+        has_last = true;
+        recorded++;
+    }
+
+    history.add(time, digits, scores);
+    readings.push_back(r);
+}
+
+// The buckets query() must return for [from, to]: buckets that have a recorded reading, built
+// from the raw readings. Readings before first (overwritten in the ring) do not exist any more.
+static std::vector<HistoryBucket> expected_buckets(size_t first, uint32_t from, uint32_t to, uint32_t step)
+{
+    std::vector<HistoryBucket> buckets;
+    const Reading* held = nullptr;
+    // Readings recorded HISTORY_KEEPALIVE_S before from do not count any more
+    uint32_t since = from > HISTORY_KEEPALIVE_S ? from - HISTORY_KEEPALIVE_S : 0;
+    size_t i = std::lower_bound(readings.begin() + first, readings.end(), since,
+                                [](const Reading& r, uint32_t time) { return r.time < time; }) - readings.begin();
+
+    while (i < readings.size() && readings[i].time <= to) {
+        if (readings[i].time < from || !readings[i].valid) {
+            if (readings[i].valid && readings[i].recorded) held = &readings[i];
+            i++;
+            continue;
+        }
+
+        uint32_t start = from + (readings[i].time - from) / step * step;
+        HistoryBucket bucket = {};
+        bucket.start = start;
+        bucket.min = INT32_MAX;
+        bucket.max = INT32_MIN;
+        bucket.min_confidence = 100;
+        if (held && start - held->time < HISTORY_KEEPALIVE_S) {
+            bucket.min = bucket.max = held->value;
+            bucket.min_confidence = held->confidence;
+        }
+        for (; i < readings.size() && readings[i].time <= to && readings[i].time - from < start - from + step; i++) {
+            const Reading& r = readings[i];
+            if (!r.valid) continue;
+            if (r.value < bucket.min) bucket.min = r.value;
+            if (r.value > bucket.max) bucket.max = r.value;
+            if (r.confidence < bucket.min_confidence) bucket.min_confidence = r.confidence;
+            bucket.last = r.value;
+            if (r.recorded) {
+                bucket.count++;
+                held = &r;
+            }
+        }
+        if (bucket.count > 0) buckets.push_back(bucket);
+    }
+    return buckets;
+}
+
+struct Collected {
+    std::vector<HistoryBucket> buckets;
+    size_t limit;
+};
+
+static bool collect(const HistoryBucket& bucket, void* arg)
+{
+    Collected* c = static_cast<Collected*>(arg);
+    c->buckets.push_back(bucket);
+    return c->buckets.size() < c->limit;
+}
+
+static bool same(const HistoryBucket& a, const HistoryBucket& b)
+{
+    return a.start == b.start && a.min == b.min && a.max == b.max && a.last == b.last &&
+           a.count == b.count && a.min_confidence == b.min_confidence;
+}
+
+static void check_query(ReadingHistory& history, size_t first, uint32_t from, uint32_t to, uint32_t step)
+{
+    std::vector<HistoryBucket> expected = expected_buckets(first, from, to, step);
+    Collected c = { {}, (size_t)-1 };
+    history.query(from, to, step, collect, &c);
+
+    bool ok = c.buckets.size() == expected.size();
+    for (size_t i = 0; ok && i < expected.size(); i++) {
+        if (!same(c.buckets[i], expected[i])) {
+            printf("bucket %zu of [%u, %u] step %u: start %u min %d max %d last %d count %u conf %u, "
+                   "expected start %u min %d max %d last %d count %u conf %u\n", i, from, to, step,
+                   c.buckets[i].start, c.buckets[i].min, c.buckets[i].max, c.buckets[i].last, c.buckets[i].count,
+                   c.buckets[i].min_confidence, expected[i].start, expected[i].min, expected[i].max,
+                   expected[i].last, expected[i].count, expected[i].min_confidence);
+            ok = false;
+        }
+    }
+    if (c.buckets.size() != expected.size()) {
+        printf("[%u, %u] step %u: %zu buckets, expected %zu\n", from, to, step, c.buckets.size(), expected.size());
+    }
+    CHECK(ok);
+
+    // Stopped by the callback: the same buckets up to there
+    if (expected.size() > 3) {
+        Collected first3 = { {}, 3 };
+        history.query(from, to, step, collect, &first3);
+        CHECK(first3.buckets.size() == 3 && same(first3.buckets[2], expected[2]));
+    }
+}
+
+// A meter that mostly stands still, then runs for a while, sometimes unreadable
+static void add_readings(ReadingHistory& history, uint32_t* time, int32_t* value, int n)
+{
+    int running = 0;
+    for (int k = 0; k < n; k++, *time += PERIOD_S) {
+        if (running > 0) {
+            running--;
+            *value = (*value + 1 + rand() % 3) % 100000;
+        } else if (rand() % 40 == 0) {
+            running = rand() % 30;
+        }
+        add_reading(history, *time, *value, rand() % 25 != 0);
+    }
+}
+
+// Queries over the whole history and over ranges starting at random readings
+static void check_queries(ReadingHistory& history, size_t first)
+{
+    static const uint32_t steps[] = { 1, 60, 600, 3600, 86400 };
+    uint32_t begin = readings[first].time, end = readings.back().time;
+
+    for (uint32_t step : steps) {
+        check_query(history, first, 0, UINT32_MAX - step, step);
+        check_query(history, first, begin, end, step);
+    }
+    for (int k = 0; k < 20; k++) {
+        const Reading& a = readings[first + rand() % (readings.size() - first)];
+        uint32_t span = (uint32_t)(rand() % 200000) + 1;
+        check_query(history, first, a.time + rand() % 5, a.time + span, steps[rand() % 5]);
+    }
+}
+
+int main()
+{
+    srand(1);
+    ReadingHistory history;
+    CHECK(history.init());
+
+    // Uptime seconds until the clock is set, then the wall clock
+    uint32_t time = 3;
+    int32_t value = 12345;
+    add_readings(history, &time, &value, 20000);
+    check_queries(history, 0);
+
+    time = 1700000000;
+    add_readings(history, &time, &value, 20000);
+    check_queries(history, 0);
+
+    HistoryStats stats = history.get_stats();
+    CHECK(stats.records == recorded && stats.records + stats.skipped == readings.size());
+    CHECK(stats.first_time == readings.front().time && stats.last_time == readings.back().time);
+
+    // Until the ring has been overwritten several times, the oldest records are gone
+    while (history.get_stats().records == recorded) {
+        add_readings(history, &time, &value, 20000);
+    }
+    add_readings(history, &time, &value, 200000);
+    stats = history.get_stats();
+    CHECK(stats.records < recorded && stats.bytes <= HISTORY_BLOCKS * HISTORY_BLOCK_SIZE);
+
+    size_t first = 0;
+    for (size_t gone = recorded - stats.records; gone > 0; first++) {
+        if (readings[first].recorded) gone--;
+    }
+    while (!readings[first].recorded) first++;
+    CHECK(stats.first_time == readings[first].time);
+    check_queries(history, first);
+
+    // Ranges starting right after each record: the reading shown at the start may be the last
+    // record of a block that ends before the range
+    for (size_t i = first; i < readings.size(); i++) {
+        if (readings[i].recorded) check_query(history, first, readings[i].time + 1, readings[i].time + 600, 600);
+    }
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
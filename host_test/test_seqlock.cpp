@@ -0,0 +1,70 @@
+/*
+ * SeqLock (main/cam/seqlock.hpp) under load: one writer publishes values whose fields all hold
+ * the same counter while three readers copy them as fast as they can. A read mixing two writes
+ * (torn) or going back in time is a failure.
+ */
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "seqlock.hpp"
+
+#define WRITES      2000000
+#define READERS     3
+
+// Larger than a word and with a 64-bit member, like Camera::Reading
+struct Value {
+    uint32_t words[10];
+    int64_t counter;
+};
+
+static SeqLock<Value> lock;
+
+int main()
+{
+    std::atomic<bool> done{false};
+    std::atomic<long> reads{0}, torn{0}, backwards{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&] {
+            int64_t last = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                const Value v = lock.read();
+                reads++;
+                for (uint32_t w : v.words) {
+                    if (w != (uint32_t)v.counter) {
+                        torn++;
+                        break;
+                    }
+                }
+                if (v.counter < last) {
+                    backwards++;
+                }
+                last = v.counter;
+            }
+        });
+    }
+
+    for (int64_t i = 1; i <= WRITES; i++) {
+        Value v;
+        for (uint32_t& w : v.words) {
+            w = (uint32_t)i;
+        }
+        v.counter = i;
+        lock.write(v);
+    }
+    done = true;
+    for (std::thread& t : readers) {
+        t.join();
+    }
+
+    int failures = 0;
+    printf("%ld reads, %ld torn, %ld backwards, %u writes\n", reads.load(), torn.load(), backwards.load(),
+        lock.writes());
+    if (torn || backwards || lock.writes() != WRITES || lock.read().counter != WRITES) {
+        failures++;
+    }
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
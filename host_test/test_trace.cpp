@@ -0,0 +1,166 @@
+/*
+ * Trace ring (main/trace): events recorded from several threads while the ring wraps and is
+ * exported at the same time. Every export must be valid JSON holding at most TRACE_RING_SIZE
+ * events, each one as it was recorded.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace.hpp"
+
+#define THREADS     3
+#define EXPORTS     200     // exports while the threads record
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL line %d: %s\n", __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// Minimal JSON syntax check: objects, arrays, strings without escapes, numbers
+static bool parse_value(const char*& p);
+
+static bool parse_string(const char*& p)
+{
+    if (*p++ != '"') return false;
+    while (*p && *p != '"') {
+        if (*p == '\\' || (unsigned char)*p < 0x20) return false;
+        p++;
+    }
+    return *p++ == '"';
+}
+
+static bool parse_value(const char*& p)
+{
+    if (*p == '{' || *p == '[') {
+        const char close = *p == '{' ? '}' : ']';
+        const bool object = *p++ == '{';
+        if (*p == close) {
+            p++;
+            return true;
+        }
+        while (true) {
+            if (object && (!parse_string(p) || *p++ != ':')) return false;
+            if (!parse_value(p)) return false;
+            if (*p == close) {
+                p++;
+                return true;
+            }
+            if (*p++ != ',') return false;
+        }
+    }
+    if (*p == '"') return parse_string(p);
+    const char* start = p;
+    if (*p == '-') p++;
+    while (*p >= '0' && *p <= '9') p++;
+    return p > start && p[-1] != '-';
+}
+
+static bool valid_json(const std::string& s)
+{
+    const char* p = s.c_str();
+    return parse_value(p) && *p == 0;
+}
+
+// Each recording thread has its own name and phase
+static const char* const thread_names[THREADS] = { "t0", "t1", "t2" };
+static const char thread_phases[THREADS] = { 'B', 'E', 'i' };
+
+// Checks an export against what the threads recorded, returns the number of events (not the
+// thread name metadata) or -1: every event has the name and phase of one thread, and each
+// thread's timestamps never go back. A slot copied while it was rewritten mixes two events.
+static int check_events(const std::string& s)
+{
+    long long last_ts[THREADS] = {};
+    int n = 0;
+    for (size_t i = s.find("{\"name\":\""); i != std::string::npos; i = s.find("{\"name\":\"", i + 1)) {
+        char name[16], phase;
+        long long ts;
+        if (sscanf(s.c_str() + i, "{\"name\":\"%15[^\"]\",\"ph\":\"%c\",\"ts\":%lld", name, &phase, &ts) != 3) {
+            continue;   // thread_name metadata
+        }
+        int t = 0;
+        while (t < THREADS && strcmp(name, thread_names[t]) != 0) t++;
+        if (t == THREADS || phase != thread_phases[t] || ts < last_ts[t]) {
+            return -1;
+        }
+        last_ts[t] = ts;
+        n++;
+    }
+    return n;
+}
+
+static bool append(const char* data, size_t len, void* arg)
+{
+    ((std::string*)arg)->append(data, len);
+    return true;
+}
+
+static bool refuse(const char*, size_t, void*)
+{
+    return false;
+}
+
+static void record(int thread, int count)
+{
+    for (int i = 0; i < count; i++) {
+        trace_event(thread_names[thread], thread_phases[thread]);
+    }
+}
+
+int main()
+{
+    std::string json;
+    CHECK(!trace_export_chrome(append, &json));
+    CHECK(trace_init());
+
+    // below the ring size: everything
+    record(0, 400);
+    CHECK(trace_export_chrome(append, &json) && valid_json(json));
+    CHECK(check_events(json) == 400 && trace_recorded() == 400);
+    CHECK(!trace_export_chrome(refuse, nullptr));
+
+    // the ring wraps many times while it is exported
+    std::atomic<int> exports{0}, invalid{0}, oversized{0};
+    std::atomic<uint32_t> recorded{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            while (exports.load() < EXPORTS) {
+                record(t, 100);
+                recorded += 100;
+            }
+        });
+    }
+    while (exports.load() < EXPORTS) {
+        std::string s;
+        const int events = trace_export_chrome(append, &s) && valid_json(s) ? check_events(s) : -1;
+        invalid += events < 0;
+        oversized += events > TRACE_RING_SIZE;
+        exports++;
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    printf("%u events recorded during %d exports, %d invalid, %d oversized\n", (unsigned)recorded,
+        exports.load(), invalid.load(), oversized.load());
+    CHECK(invalid == 0 && oversized == 0);
+    CHECK(recorded > 10 * TRACE_RING_SIZE && trace_recorded() == 400 + recorded);
+
+    // Once quiet the ring holds the last TRACE_RING_SIZE events, but for at most one per thread: a
+    // thread preempted between taking its event number and writing the slot may finish after the
+    // ring wrapped past it, and that slot is then dropped from the export
+    json.clear();
+    CHECK(trace_export_chrome(append, &json) && valid_json(json));
+    const int events = check_events(json);
+    CHECK(events <= TRACE_RING_SIZE && events >= TRACE_RING_SIZE - THREADS);
+
+    printf("%s: %d failures\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -1,9 +1,35 @@
+#include <time.h>
 #include "camera.hpp"
+#include "trace.hpp"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "edge-impulse-sdk/classifier/ei_run_classifier.h"
 
 static const char* TAG = "CAMERA";
 
+static Counter frames_captured("watermeter_frames_captured_total", nullptr, "Recognition frames captured");
+static Counter frames_skipped_total("watermeter_frames_skipped_total", nullptr,
+    "Frames not classified, the ROI did not change");
+static Counter frames_processed("watermeter_frames_processed_total", nullptr, "Frames classified");
+static Counter live_view_frames("watermeter_live_view_frames_total", nullptr, "Live view frames captured");
+static Histogram capture_seconds("watermeter_stage_seconds", "stage=\"capture\"", "Pipeline stage latency");
+static Histogram extract_roi_seconds("watermeter_stage_seconds", "stage=\"extract_roi\"", "Pipeline stage latency");
+static Histogram to_process_seconds("watermeter_stage_seconds", "stage=\"to_process\"", "Pipeline stage latency");
+static Histogram recognize_seconds("watermeter_stage_seconds", "stage=\"recognize\"", "Pipeline stage latency");
+static Histogram process_seconds("watermeter_stage_seconds", "stage=\"process\"", "Pipeline stage latency");
+static Histogram frame_seconds("watermeter_frame_latency_seconds", nullptr,
+    "From the capture of a frame to its published reading");
+static Histogram digit_inference_seconds("watermeter_inference_per_digit_seconds", nullptr,
+    "Inference time of one digit, whole ROI runs split evenly");
+
+#if WHOLE_ROI_INFERENCE
+static_assert(ROI_W == DIGIT_NUM * DIGIT_W && ROI_H == DIGIT_H,
+              "Whole ROI inference needs the ROI to be exactly DIGIT_NUM digits wide");
+#endif
+static_assert(INFERENCE_HELPER_DIGITS >= 0 && INFERENCE_HELPER_DIGITS < DIGIT_NUM,
+              "The inference core needs at least one digit");
+
 #define PWDN_GPIO_NUM     -1
 #define RESET_GPIO_NUM    -1
 #define XCLK_GPIO_NUM     10
@@ -46,9 +72,9 @@ bool Camera::init() {
         .pixel_format = PIXFORMAT_JPEG,
         .frame_size = FRAMESIZE_QVGA,
         .jpeg_quality = 12,
-        .fb_count = 1,
+        .fb_count = 2,
         .fb_location = CAMERA_FB_IN_PSRAM,
-        .grab_mode = CAMERA_GRAB_WHEN_EMPTY,
+        .grab_mode = CAMERA_GRAB_LATEST,
     };
 
     esp_err_t err = esp_camera_init(&config);
@@ -71,6 +97,17 @@ bool Camera::init() {
     camera_initialized = true;
     ESP_LOGI(TAG, "Camera initialized successfully");
 
+    // Builds the resident interpreters and tensor arenas once for all frames, one per core
+    int64_t setup_start_us = esp_timer_get_time();
+    run_classifier_init(&ei_default_impulse);
+    recognizers[0] = { &ei_default_impulse, 0, DIGIT_NUM - INFERENCE_HELPER_DIGITS, WHOLE_ROI_INFERENCE };
+#if INFERENCE_HELPER_DIGITS > 0
+    helper_impulse = new ei_impulse_handle_t(ei_default_impulse.impulse);
+    run_classifier_init(helper_impulse);
+    recognizers[1] = { helper_impulse, DIGIT_NUM - INFERENCE_HELPER_DIGITS, INFERENCE_HELPER_DIGITS, WHOLE_ROI_INFERENCE };
+#endif
+    ESP_LOGI(TAG, "Classifier initialized in %lld us", esp_timer_get_time() - setup_start_us);
+
     if (sd_card.init()) {
         ESP_LOGW(TAG, "SD card initialization failed, continuing without SD card");
     }
@@ -78,107 +115,561 @@ bool Camera::init() {
     return true;
 }
 
-int Camera::ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
+void Camera::deinit() {
+    run_classifier_deinit(&ei_default_impulse);
+#if INFERENCE_HELPER_DIGITS > 0
+    run_classifier_deinit(helper_impulse);
+    delete helper_impulse;
+    helper_impulse = nullptr;
+#endif
+    camera_initialized = false;
+}
+
+int Camera::ei_camera_get_data(const ei::ei_signal_image_t* image, size_t offset, size_t length, float *out_ptr)
 {
-    size_t pixel_ix = offset * 3;
+    size_t pixel_ix = offset;
     size_t pixels_left = length;
     size_t out_ptr_ix = 0;
 
     while (pixels_left != 0) {
-        uint8_t r = digit_buf[pixel_ix + 2];
-        uint8_t g = digit_buf[pixel_ix + 1];
-        uint8_t b = digit_buf[pixel_ix];
-        
-        out_ptr[out_ptr_ix] = (r << 16) + (g << 8) + b;
+        // The image is luma, the image DSP block takes packed RGB
+        uint8_t y = image->data[(pixel_ix / image->width) * image->stride + pixel_ix % image->width];
+
+        out_ptr[out_ptr_ix] = (y << 16) + (y << 8) + y;
 
         out_ptr_ix++;
-        pixel_ix += 3;
+        pixel_ix++;
         pixels_left--;
     }
     return 0;
 }
 
-char Camera::recognize_digit() {
-    ei::signal_t signal;
-    signal.total_length = DIGIT_W * DIGIT_H;
-    signal.get_data = &ei_camera_get_data;
+void Camera::recognize(Recognizer& rec) {
+    TRACE_SCOPE("recognize");
+    HistogramTimer timer(recognize_seconds);
+    rec.setup_us = 0;
+    rec.dsp_us = 0;
+    rec.classification_us = 0;
+
+    for (int i = 0; i < rec.digit_count; i++) {
+        digits[rec.first_digit + i] = DIGIT_EMPTY;
+        scores[rec.first_digit + i] = 0.0f;
+    }
+
+    if (!recognize_roi(rec)) {
+        recognize_digits(rec);
+    }
 
-    char best_digit = DIGIT_EMPTY;
+    if (rec.classification_us > 0) {
+        digit_inference_seconds.observe_us((uint32_t)(rec.classification_us / rec.digit_count));
+    }
+}
+
+ei_op_profiler_t* Camera::get_op_profiler(int i, const char** name) {
+    static const char* const NAMES[] = { "main", "helper", "main_roi", "helper_roi" };
+    const int count = sizeof(recognizers) / sizeof(recognizers[0]);
+    *name = NAMES[(i / count) * 2 + i % count];
+#if EI_CLASSIFIER_OP_PROFILER == 1
+    return run_classifier_op_profiler(recognizers[i % count].handle, i >= count);
+#else
+    return nullptr;
+#endif
+}
+
+int64_t Camera::read_arena_used(void* arg) {
+    Camera* self = static_cast<Camera*>(arg);
+    int64_t used = 0;
+    for (const Recognizer& rec : self->recognizers) {
+        used += run_classifier_arena_used(rec.handle);
+    }
+    return used;
+}
 
-    ei_impulse_result_t result = {0};
-    EI_IMPULSE_ERROR res = run_classifier(&signal, &result, false);
+void Camera::recognize_digits(Recognizer& rec) {
+    ei::ei_signal_image_t images[DIGIT_NUM];
+    ei::signal_t signals[DIGIT_NUM];
+    ei::signal_t* signal_ptrs[DIGIT_NUM];
+
+    for (int i = 0; i < rec.digit_count; i++) {
+        // Each digit is a view into roi_buf, no crop is copied
+        images[i] = { roi_buf + (rec.first_digit + i) * DIGIT_W, DIGIT_W, DIGIT_H, ROI_W, ei::EI_SIGNAL_IMAGE_GRAY8 };
+        const ei::ei_signal_image_t* image = &images[i];
+        signals[i].total_length = DIGIT_W * DIGIT_H;
+        signals[i].image = image;
+        signals[i].get_data = [image](size_t offset, size_t length, float *out_ptr) {
+            return ei_camera_get_data(image, offset, length, out_ptr);
+        };
+        signal_ptrs[i] = &signals[i];
+    }
+
+    // All crops run back-to-back on the resident interpreter of this handle
+    ei_impulse_result_t results[DIGIT_NUM] = {};
+    EI_IMPULSE_ERROR res = run_classifier_batch(rec.handle, signal_ptrs, rec.digit_count, results, false);
 
     if (res != EI_IMPULSE_OK) {
-        ESP_LOGI(TAG, "ERR: run_classifier (%d)\n", res);
-        return DIGIT_EMPTY;
+        ESP_LOGI(TAG, "ERR: run_classifier_batch (%d)\n", res);
+        return;
     }
 
-    float best_score = THRESHOLD_VAL;
+    for (int i = 0; i < rec.digit_count; i++) {
+        const ei_impulse_result_t& result = results[i];
 
-    for (size_t i = 0; i < result.bounding_boxes_count; i++) {
-        auto bb = result.bounding_boxes[i];
-        if (bb.value > best_score) {
-            best_score = bb.value;
-            best_digit = bb.label[strlen(bb.label) - 1];
+        rec.setup_us += result.timing.setup_us;
+        rec.dsp_us += result.timing.dsp_us;
+        rec.classification_us += result.timing.classification_us;
+
+        // The best score is kept even below THRESHOLD_VAL, the archive policy looks at it
+        for (size_t j = 0; j < result.bounding_boxes_count; j++) {
+            auto bb = result.bounding_boxes[j];
+            if (bb.value > scores[rec.first_digit + i]) {
+                scores[rec.first_digit + i] = bb.value;
+                digits[rec.first_digit + i] = bb.value > THRESHOLD_VAL ? bb.label[strlen(bb.label) - 1] : DIGIT_EMPTY;
+            }
         }
     }
+}
 
-    /*if (best_digit != DIGIT_EMPTY) {
-        ESP_LOGI(TAG, " -> %c (%.2f)\n", best_digit, best_score);
-    } else {
-        ESP_LOGI(TAG, " -> not detected");
-    }*/
+bool Camera::recognize_roi(Recognizer& rec) {
+#if WHOLE_ROI_INFERENCE
+    if (!rec.whole_roi_supported) return false;
+
+    ei::ei_signal_image_t image = { roi_buf + rec.first_digit * DIGIT_W, (size_t)rec.digit_count * DIGIT_W, ROI_H, ROI_W,
+                                    ei::EI_SIGNAL_IMAGE_GRAY8 };
+    ei::signal_t signal;
+    signal.total_length = rec.digit_count * DIGIT_W * ROI_H;
+    signal.image = &image;
+    signal.get_data = [&image](size_t offset, size_t length, float *out_ptr) {
+        return ei_camera_get_data(&image, offset, length, out_ptr);
+    };
+
+    // One pass of the widened model, each digit is one input-sized tile of the ROI
+    ei_impulse_result_t result = {};
+    EI_IMPULSE_ERROR res = run_classifier_image_tiled(rec.handle, &signal, rec.digit_count, &result, false);
+
+    if (res != EI_IMPULSE_OK) {
+        ESP_LOGW(TAG, "Whole ROI inference failed (%d), falling back to digit crops", res);
+        rec.whole_roi_supported = false;
+        return false;
+    }
+
+    rec.setup_us += result.timing.setup_us;
+    rec.dsp_us += result.timing.dsp_us;
+    rec.classification_us += result.timing.classification_us;
+
+    for (size_t j = 0; j < result.bounding_boxes_count; j++) {
+        auto bb = result.bounding_boxes[j];
+        int slot = bb.x / DIGIT_W;
+        if (slot < rec.digit_count && bb.value > scores[rec.first_digit + slot]) {
+            scores[rec.first_digit + slot] = bb.value;
+            digits[rec.first_digit + slot] = bb.value > THRESHOLD_VAL ? bb.label[strlen(bb.label) - 1] : DIGIT_EMPTY;
+        }
+    }
 
-    return best_digit;
+    return true;
+#else
+    return false;
+#endif
 }
 
-bool Camera::take_photo_and_process() {
+bool Camera::frame_changed(camera_fb_t* fb) {
+    TRACE_SCOPE("frame_changed");
+    if (!jpeg_decoder.decode_dc_thumbnail(fb->buf, fb->len, thumb_buf, THUMB_W, THUMB_H)) {
+        return true;
+    }
+
+    // Compared with the last processed frame, so slow drift still adds up to a change
+    bool changed = !thumb_ref_valid || frames_skipped >= CHANGE_MAX_SKIPPED;
+    const int stride = (jpeg_decoder.image_width() + 7) / 8;
+    int moved = 0;
+
+    for (int y = ROI_Y / 8; !changed && y <= (ROI_Y + ROI_H - 1) / 8; y++) {
+        for (int x = ROI_X / 8; x <= (ROI_X + ROI_W - 1) / 8; x++) {
+            int delta = thumb_buf[y * stride + x] - thumb_ref[y * stride + x];
+            if (delta > CHANGE_PIXEL_DELTA || delta < -CHANGE_PIXEL_DELTA) {
+                moved++;
+            }
+        }
+        changed = moved >= CHANGE_MIN_PIXELS;
+    }
+
+    if (changed) {
+        memcpy(thumb_ref, thumb_buf, sizeof(thumb_ref));
+        thumb_ref_valid = true;
+        frames_skipped = 0;
+    } else {
+        frames_skipped++;
+    }
+    return changed;
+}
+
+bool Camera::start_pipeline() {
     if (!camera_initialized) return false;
 
+    free_frames = xQueueCreate(FRAME_SLOTS, sizeof(Frame*));
+    ready_frames = xQueueCreate(FRAME_SLOTS, sizeof(Frame*));
+    if (free_frames == NULL || ready_frames == NULL) {
+        ESP_LOGE(TAG, "Failed to create frame queues");
+        return false;
+    }
+
+    // Readers see an unrecognized reading until the first frame is classified
+    memset(digits, DIGIT_EMPTY, DIGIT_NUM);
+    digits[DIGIT_NUM] = '\0';
+    memset(scores, 0, sizeof(scores));
+    publish_reading(0, 0, 0);
+
+    if (!history.init()) {
+        ESP_LOGW(TAG, "Reading history disabled");
+    }
+
+    for (int i = 0; i < FRAME_SLOTS; i++) {
+        Frame* frame = &frames[i];
+        xQueueSend(free_frames, &frame, 0);
+    }
+
+    if (xTaskCreatePinnedToCore(capture_task, "capture_task", 4096, this, 5, &capture_task_handle, CAPTURE_TASK_CORE) != pdPASS ||
+        xTaskCreatePinnedToCore(inference_task, "inference_task", 8192, this, 5, &inference_task_handle, INFERENCE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create pipeline tasks");
+        return false;
+    }
+
+#if INFERENCE_HELPER_DIGITS > 0
+    if (xTaskCreatePinnedToCore(inference_helper_task, "inference_helper", 8192, this, 5, &helper_task_handle, CAPTURE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create inference helper task");
+        return false;
+    }
+#endif
+
+    if (sd_card.isSDInitialized() && !archiver.start()) {
+        ESP_LOGW(TAG, "SD archiver not started, frames will not be saved");
+    }
+
+    return true;
+}
+
+void Camera::capture_task(void* arg) {
+    Camera* self = static_cast<Camera*>(arg);
+    const TickType_t period = pdMS_TO_TICKS(UPDATE_MS);
+    TickType_t next_frame = xTaskGetTickCount();
+    bool capture_now = false;
+
+    while (true) {
+        TickType_t now = xTaskGetTickCount();
+        if (capture_now || (int32_t)(now - next_frame) >= 0) {
+            Frame* frame;
+            // Blocks while both slots are queued or being classified
+            xQueueReceive(self->free_frames, &frame, portMAX_DELAY);
+
+            if (self->capture_frame(frame)) {
+                xQueueSend(self->ready_frames, &frame, portMAX_DELAY);
+            } else {
+                xQueueSend(self->free_frames, &frame, 0);
+            }
+
+            // request_capture() restarts the period, like the first frame
+            next_frame = capture_now ? now + period : next_frame + period;
+            capture_now = false;
+        } else {
+            // Live view only, never waits for a frame slot so the recognition rate does not change
+            self->capture_live_view_frame();
+        }
+
+        // Sleeps until the next recognition frame or live view frame, request_capture() ends it early
+        TickType_t wait = next_frame - xTaskGetTickCount();
+        if ((int32_t)wait < 0) wait = 0;
+        if (self->live_view && wait > pdMS_TO_TICKS(LIVE_VIEW_FRAME_MS)) wait = pdMS_TO_TICKS(LIVE_VIEW_FRAME_MS);
+        if (wait > 0 && ulTaskNotifyTake(pdTRUE, wait) > 0 && !self->live_view) {
+            capture_now = true;
+        }
+    }
+}
+
+void Camera::inference_task(void* arg) {
+    Camera* self = static_cast<Camera*>(arg);
+
+    while (true) {
+        Frame* frame;
+        xQueueReceive(self->ready_frames, &frame, portMAX_DELAY);
+        self->process_frame(frame);
+        xQueueSend(self->free_frames, &frame, 0);
+    }
+}
+
+#if INFERENCE_HELPER_DIGITS > 0
+void Camera::inference_helper_task(void* arg) {
+    Camera* self = static_cast<Camera*>(arg);
+
+    while (true) {
+        // Started by process_frame() for every frame, on its own handle and interpreter
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->recognize(self->recognizers[1]);
+        xTaskNotifyGive(self->inference_task_handle);
+    }
+}
+#endif
+
+bool Camera::capture_frame(Frame* frame) {
+    TRACE_SCOPE("capture_frame");
+    HistogramTimer timer(capture_seconds);
+    if (xSemaphoreTake(camera_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGW(TAG, "Timeout waiting for camera mutex in capture task");
+        return false;
+    }
+
+    TRACE_BEGIN("fb_get");
     camera_fb_t* fb = esp_camera_fb_get();
+    TRACE_END("fb_get");
     if (!fb) {
         ESP_LOGE(TAG, "Capture failed");
+        xSemaphoreGive(camera_mutex);
         return false;
     }
 
-    extract_roi(fb);
+    frame->captured_us = esp_timer_get_time();
+    frames_captured.inc();
+    publish_frame_jpeg(fb);
+
+    int skipped_before = frames_skipped;
+    bool changed = frame_changed(fb);
+    if (changed) {
+        extract_roi(fb, frame->roi);
+        // One line per run of unchanged frames, a still meter skips nearly every frame
+        if (skipped_before > 0) ESP_LOGI(TAG, "%d unchanged frames skipped", skipped_before);
+    } else {
+        frames_skipped_total.inc();
+        ESP_LOGD(TAG, "ROI unchanged, frame skipped in %lld us (%d in a row)",
+                 esp_timer_get_time() - frame->captured_us, frames_skipped);
+    }
+
+    esp_camera_fb_return(fb);
+    xSemaphoreGive(camera_mutex);
+    return changed;
+}
+
+void Camera::capture_live_view_frame() {
+    TRACE_SCOPE("live_view_frame");
+    if (xSemaphoreTake(camera_mutex, pdMS_TO_TICKS(LIVE_VIEW_FRAME_MS)) != pdTRUE) return;
 
-    for(int i = 0; i < DIGIT_NUM; i++) {
-        extract_digit(i);
-        digits[i] = recognize_digit();
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (fb) {
+        live_view_frames.inc();
+        publish_frame_jpeg(fb);
+        esp_camera_fb_return(fb);
     }
+    xSemaphoreGive(camera_mutex);
+}
+
+void Camera::process_frame(Frame* frame) {
+    TRACE_SCOPE("process_frame");
+    HistogramTimer timer(process_seconds);
+    int64_t process_start_us = esp_timer_get_time();
+    to_process_seconds.observe_us((uint32_t)(process_start_us - frame->captured_us));
+
+    // roi_buf always holds the last classified ROI (served as /roi.jpg)
+    TRACE_BEGIN("roi_copy");
+    memcpy(roi_buf, frame->roi, ROI_SIZE);
+    TRACE_END("roi_copy");
+
+#if INFERENCE_HELPER_DIGITS > 0
+    // The last digits are classified on the other core at the same time
+    xTaskNotifyGive(helper_task_handle);
+    recognize(recognizers[0]);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#else
+    recognize(recognizers[0]);
+#endif
 
     digits[DIGIT_NUM] = '\0';
 
-    ESP_LOGI(TAG, "WATER METER READING: [%s]", digits);
+    uint32_t now_s = (uint32_t)time(nullptr);
+    TRACE_BEGIN("history_add");
+    history.add(now_s, digits, scores);
+    TRACE_END("history_add");
 
-    esp_camera_fb_return(fb);
+    // Written to the SD card later by the archiver task, dropped if it falls behind
+    if (sd_card.isSDInitialized()) {
+        archiver.submit(roi_buf, frame->captured_us, digits, scores);
+    }
+
+    // Inference is the longest of the parallel runs, setup and DSP add up
+    int64_t setup_us = 0, dsp_us = 0, classification_us = 0;
+    for (const Recognizer& rec : recognizers) {
+        setup_us += rec.setup_us;
+        dsp_us += rec.dsp_us;
+        if (rec.classification_us > classification_us) classification_us = rec.classification_us;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "WATER METER READING: [%s]", digits);
+    ESP_LOGI(TAG, "Frame: %lld us from capture, %lld us to classify (setup %lld us, dsp %lld us, inference %lld us)",
+             now_us - frame->captured_us, now_us - process_start_us,
+             setup_us, dsp_us, classification_us);
+
+    // The ROI images first, a reader seeing the new frame number can fetch them
+    publish_roi_jpeg(image_count);
+    publish_roi_raw(image_count);
+    publish_reading(image_count, now_s, frame->captured_us);
     image_count++;
-    return true;
+    frames_processed.inc();
+    frame_seconds.observe_us((uint32_t)(esp_timer_get_time() - frame->captured_us));
 }
 
-void Camera::extract_digit(const int item) {
-    int start_x = item * DIGIT_W;
+void Camera::publish_reading(uint32_t frame, uint32_t time, int64_t captured_us) {
+    Reading r;
+    r.frame = frame;
+    r.time = time;
+    r.captured_us = captured_us;
+    memcpy(r.scores, scores, sizeof(r.scores));
+    memcpy(r.digits, digits, sizeof(r.digits));
+    reading.write(r);
+}
 
-    for (int y = 0; y < DIGIT_H; y++) {
-        if (y >= ROI_H) break;
+void Camera::publish_roi_jpeg(uint32_t seq) {
+    TRACE_SCOPE("publish_roi_jpeg");
+    JpegSnapshot* snapshot = (JpegSnapshot*)malloc(sizeof(JpegSnapshot));
+    if (!snapshot) return;
+
+    snapshot->buf = nullptr;
+    snapshot->len = 0;
+    if (!fmt2jpg(roi_buf, ROI_SIZE, ROI_W, ROI_H, PIXFORMAT_GRAYSCALE, ROI_JPEG_QUALITY,
+                 &snapshot->buf, &snapshot->len)) {
+        ESP_LOGW(TAG, "ROI JPEG encoding failed");
+        free(snapshot);
+        return;
+    }
+    snapshot->seq = seq;
+    publish(&roi_jpeg, snapshot);
+}
 
-        size_t src_idx = (y * ROI_W + start_x) * 3;
-        size_t dst_idx = (y * DIGIT_W) * 3;
-        
-        memcpy(digit_buf + dst_idx, roi_buf + src_idx, DIGIT_W * 3);
+void Camera::publish_roi_raw(uint32_t seq) {
+    TRACE_SCOPE("publish_roi_raw");
+    JpegSnapshot* snapshot = (JpegSnapshot*)malloc(sizeof(JpegSnapshot));
+    uint8_t* buf = (uint8_t*)heap_caps_malloc(ROI_SIZE, MALLOC_CAP_SPIRAM);
+    if (!snapshot || !buf) {
+        ESP_LOGW(TAG, "Not enough memory for the ROI snapshot");
+        free(snapshot);
+        free(buf);
+        return;
     }
 
-    if (sd_card.isSDInitialized()) {
-        char name[64];
-        snprintf(name, sizeof(name), DIGIT_PATH, item, image_count);
-        sd_card.save_as_jpeg(digit_buf, DIGIT_W, DIGIT_H, name, 80);
+    memcpy(buf, roi_buf, ROI_SIZE);
+    snapshot->buf = buf;
+    snapshot->len = ROI_SIZE;
+    snapshot->seq = seq;
+    publish(&roi_raw, snapshot);
+}
+
+void Camera::request_capture() {
+    if (capture_task_handle) xTaskNotifyGive(capture_task_handle);
+}
+
+void Camera::set_live_view(bool on) {
+    if (live_view == on) return;
+    live_view = on;
+    ESP_LOGI(TAG, "Live view %s", on ? "on" : "off");
+    // Ends the wait for the next recognition frame, live view frames start right away
+    if (on) request_capture();
+}
+
+void Camera::publish_frame_jpeg(camera_fb_t* fb) {
+    TRACE_SCOPE("publish_frame_jpeg");
+    // A copy, the frame buffer goes back to the driver right after the ROI is decoded
+    JpegSnapshot* snapshot = (JpegSnapshot*)malloc(sizeof(JpegSnapshot));
+    uint8_t* buf = (uint8_t*)heap_caps_malloc(fb->len, MALLOC_CAP_SPIRAM);
+    if (!snapshot || !buf) {
+        ESP_LOGW(TAG, "Not enough memory for the frame snapshot");
+        free(snapshot);
+        free(buf);
+        return;
+    }
+
+    memcpy(buf, fb->buf, fb->len);
+    snapshot->buf = buf;
+    snapshot->len = fb->len;
+    snapshot->refs = 1;     // held by the ring until FRAME_RING_SIZE newer captures replace it
+
+    // capture_seq changes together with the ring so readers never see one without the other
+    taskENTER_CRITICAL(&snapshot_lock);
+    snapshot->seq = capture_seq + 1;
+    JpegSnapshot** slot = &frame_ring[snapshot->seq % FRAME_RING_SIZE];
+    JpegSnapshot* previous = *slot;
+    *slot = snapshot;
+    capture_seq = snapshot->seq;
+    taskEXIT_CRITICAL(&snapshot_lock);
+
+    if (previous) release_jpeg(previous);
+    TaskHandle_t listener = capture_listener;
+    if (listener) xTaskNotifyGive(listener);
+}
+
+const Camera::JpegSnapshot* Camera::acquire_frame_jpeg() {
+    taskENTER_CRITICAL(&snapshot_lock);
+    JpegSnapshot* snapshot = frame_ring[capture_seq % FRAME_RING_SIZE];
+    if (snapshot) snapshot->refs++;
+    taskEXIT_CRITICAL(&snapshot_lock);
+    return snapshot;
+}
+
+const Camera::JpegSnapshot* Camera::acquire_frame_after(uint32_t seq) {
+    taskENTER_CRITICAL(&snapshot_lock);
+    uint32_t latest = capture_seq;
+    // A viewer more than the ring behind skips to the oldest frame still there
+    uint32_t wanted = latest - seq > FRAME_RING_SIZE ? latest - FRAME_RING_SIZE + 1 : seq + 1;
+    JpegSnapshot* snapshot = frame_ring[wanted % FRAME_RING_SIZE];
+    if (seq == latest || !snapshot || snapshot->seq != wanted) {
+        snapshot = nullptr;
+    } else {
+        snapshot->refs++;
     }
+    taskEXIT_CRITICAL(&snapshot_lock);
+    return snapshot;
+}
+
+void Camera::publish(JpegSnapshot** slot, JpegSnapshot* snapshot) {
+    snapshot->refs = 1;     // held by the slot until the next snapshot replaces it
 
-    //ESP_LOGI(TAG, "Digit %d: ", item);
+    taskENTER_CRITICAL(&snapshot_lock);
+    JpegSnapshot* previous = *slot;
+    *slot = snapshot;
+    taskEXIT_CRITICAL(&snapshot_lock);
+
+    if (previous) release_jpeg(previous);
+}
+
+const Camera::JpegSnapshot* Camera::acquire(JpegSnapshot** slot) {
+    taskENTER_CRITICAL(&snapshot_lock);
+    JpegSnapshot* snapshot = *slot;
+    if (snapshot) snapshot->refs++;
+    taskEXIT_CRITICAL(&snapshot_lock);
+    return snapshot;
+}
+
+void Camera::release_jpeg(const JpegSnapshot* snapshot) {
+    JpegSnapshot* s = const_cast<JpegSnapshot*>(snapshot);
+
+    taskENTER_CRITICAL(&snapshot_lock);
+    bool last = --s->refs == 0;
+    taskEXIT_CRITICAL(&snapshot_lock);
+
+    // Freed outside the critical section
+    if (last) {
+        free(s->buf);
+        free(s);
+    }
 }
 
-void Camera::extract_roi(camera_fb_t* fb) {
+void Camera::extract_roi(camera_fb_t* fb, uint8_t* out) {
+    TRACE_SCOPE("extract_roi");
+    HistogramTimer timer(extract_roi_seconds);
+    // Only the luma of the MCUs covering the ROI is decoded, straight into out
+    if (!jpeg_decoder.decode_roi(fb->buf, fb->len, ROI_X, ROI_Y, ROI_W, ROI_H, out, JpegFormat::GRAY8)) {
+        ESP_LOGW(TAG, "ROI decode failed, decoding the full frame");
+        extract_roi_full(fb, out);
+    }
+}
+
+void Camera::extract_roi_full(camera_fb_t* fb, uint8_t* out) {
+    TRACE_SCOPE("extract_roi_full");
     size_t rgb888_size = fb->width * fb->height * 3;
     uint8_t* rgb888_buf = (uint8_t*)malloc(rgb888_size);
     if (!rgb888_buf) {
@@ -186,7 +677,9 @@ void Camera::extract_roi(camera_fb_t* fb) {
         return;
     }
 
+    TRACE_BEGIN("fmt2rgb888");
     bool converted = fmt2rgb888(fb->buf, fb->len, PIXFORMAT_JPEG, rgb888_buf);
+    TRACE_END("fmt2rgb888");
     if (!converted) {
         ESP_LOGE(TAG, "JPEG decode failed");
         free(rgb888_buf);
@@ -202,42 +695,14 @@ void Camera::extract_roi(camera_fb_t* fb) {
             if (src_x >= fb->width) break;
 
             size_t src_idx = (src_y * fb->width + src_x) * 3;
-            size_t dst_idx = (y * ROI_W + x) * 3;
 
-            roi_buf[dst_idx + 0] = rgb888_buf[src_idx + 0];  // R
-            roi_buf[dst_idx + 1] = rgb888_buf[src_idx + 1];  // G
-            roi_buf[dst_idx + 2] = rgb888_buf[src_idx + 2];  // B
+            // ITU-R 601 luma, rgb888_buf is in B, G, R order
+            uint32_t b = rgb888_buf[src_idx + 0];
+            uint32_t g = rgb888_buf[src_idx + 1];
+            uint32_t r = rgb888_buf[src_idx + 2];
+            out[y * ROI_W + x] = (uint8_t)((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
         }
     }
 
-    if(sd_card.isSDInitialized()) {
-        char name[64];
-        snprintf(name, sizeof(name), ROI_PATH, image_count);
-        sd_card.save_as_jpeg(roi_buf, ROI_W, ROI_H, name, 80);
-    }
-
     free(rgb888_buf);
-}
-
-camera_fb_t* Camera::get_frame_for_download() {
-    if (xSemaphoreTake(camera_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
-        ESP_LOGW("CAM", "Timeout waiting for camera in download handler");
-        return nullptr;
-    }
-
-    camera_fb_t* fb = esp_camera_fb_get();
-    if (!fb) {
-        ESP_LOGE("CAM", "Capture failed in download handler");
-        xSemaphoreGive(camera_mutex);
-        return nullptr;
-    }
-
-    return fb;
-}
-
-void Camera::return_frame(camera_fb_t* fb) {
-    if (fb) {
-        esp_camera_fb_return(fb);
-    }
-    xSemaphoreGive(camera_mutex);
 }
\ No newline at end of file
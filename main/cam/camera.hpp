@@ -4,33 +4,141 @@
 #include <stdint.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include "esp_camera.h"
 #include "config.h"
 #include "sd_card.hpp"
+#include "archiver.hpp"
+#include "reading_history.hpp"
+#include "jpeg_decoder.hpp"
+#include "seqlock.hpp"
+#include "metrics.hpp"
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+
+class ei_impulse_handle_t;
+class ei_op_profiler_t;
 
 class Camera {
 public:
+    // Published by the pipeline, shared by all requests until the last one releases it
+    struct JpegSnapshot {
+        uint8_t* buf;       // JPEG, or ROI_SIZE bytes of luma for the raw ROI
+        size_t len;
+        uint32_t seq;       // frame (ROI) or capture (full frame) sequence number
+        int refs;
+    };
+
+    // The result of one classified frame, published as a whole
+    struct Reading {
+        uint32_t frame;             // ROI sequence number, 0 before the first frame
+        uint32_t time;              // time() seconds
+        int64_t captured_us;
+        float scores[DIGIT_NUM];    // best score per digit, also below THRESHOLD_VAL
+        char digits[DIGIT_NUM + 1]; // DIGIT_EMPTY when not recognized
+    };
+
     SemaphoreHandle_t camera_mutex;
 
     bool init();
-    bool take_photo_and_process();
-    const char* get_digits() const { return digits; }
-    const uint8_t* get_roi() const { return roi_buf; }
-    camera_fb_t* get_frame_for_download();
-    void return_frame(camera_fb_t* fb);
+    void deinit();
+    // Capture/decode task on CAPTURE_TASK_CORE, inference task on INFERENCE_TASK_CORE
+    bool start_pipeline();
+    // A consistent copy of the last reading, never blocks the pipeline
+    Reading get_reading() const { return reading.read(); }
+    uint32_t get_capture_seq() const { return capture_seq; }
+    // The ROI JPEG of the last processed frame, the full JPEG of the last capture (nullptr until
+    // there is one), released with release_jpeg(). The camera is never locked.
+    const JpegSnapshot* acquire_roi_jpeg() { return acquire(&roi_jpeg); }
+    // A copy of the last processed ROI (roi_buf is rewritten by the next frame), same lifetime
+    const JpegSnapshot* acquire_roi_raw() { return acquire(&roi_raw); }
+    const JpegSnapshot* acquire_frame_jpeg();
+    // The oldest capture still in the ring that is newer than seq (the ring keeps the last
+    // FRAME_RING_SIZE), nullptr if there is none yet
+    const JpegSnapshot* acquire_frame_after(uint32_t seq);
+    void release_jpeg(const JpegSnapshot* snapshot);
+    // Wakes the capture task for a capture now instead of at the next period, does not wait
+    void request_capture();
+    // The task gets a notification (xTaskNotifyGive) after each capture is published, to wait
+    // for one with ulTaskNotifyTake instead of polling get_capture_seq(). One task, nullptr: none
+    void set_capture_listener(TaskHandle_t task) { capture_listener = task; }
+    // While on, frames are also captured every LIVE_VIEW_FRAME_MS for the ring only, recognition
+    // keeps its UPDATE_MS period
+    void set_live_view(bool on);
+    ArchiveStats get_archive_stats() { return archiver.get_stats(); }
+    ReadingHistory& get_history() { return history; }
+    // Op profilers of the recognizer interpreters, then of their whole ROI interpreters
+    // (EI_CLASSIFIER_OP_PROFILER), nullptr if not built
+    int get_op_profiler_count() const { return 2 * (sizeof(recognizers) / sizeof(recognizers[0])); }
+    ei_op_profiler_t* get_op_profiler(int i, const char** name);
 
 private:
+    // ROI rows and digit crops (multiples of 16 pixels) stay 16-byte aligned for the PIE kernels
+    struct Frame {
+        alignas(16) uint8_t roi[ROI_SIZE];
+        int64_t captured_us;
+    };
+
+    // One interpreter (impulse handle) and the digits it classifies
+    struct Recognizer {
+        ei_impulse_handle_t* handle;
+        int first_digit;
+        int digit_count;
+        bool whole_roi_supported;
+        int64_t setup_us;
+        int64_t dsp_us;
+        int64_t classification_us;
+    };
+
     SD_card sd_card;
-    uint8_t roi_buf[ROI_SIZE_RGB];
+    Archiver archiver;
+    ReadingHistory history;
+    JpegDecoder jpeg_decoder;
+    alignas(16) uint8_t roi_buf[ROI_SIZE];
     char digits[DIGIT_NUM+1];
+    float scores[DIGIT_NUM];
     bool camera_initialized = false;
     int image_count = 1;
+    SeqLock<Reading> reading;
+    volatile uint32_t capture_seq = 0;
+    JpegSnapshot* roi_jpeg = nullptr;
+    JpegSnapshot* roi_raw = nullptr;
+    JpegSnapshot* frame_ring[FRAME_RING_SIZE] = {};    // capture seq % FRAME_RING_SIZE
+    volatile bool live_view = false;
+    portMUX_TYPE snapshot_lock = portMUX_INITIALIZER_UNLOCKED;
+    int frames_skipped = 0;
+    bool thumb_ref_valid = false;
+    uint8_t thumb_buf[THUMB_W * THUMB_H];
+    uint8_t thumb_ref[THUMB_W * THUMB_H];
+    Frame frames[FRAME_SLOTS];
+    QueueHandle_t free_frames = nullptr;
+    QueueHandle_t ready_frames = nullptr;
+    Recognizer recognizers[INFERENCE_HELPER_DIGITS > 0 ? 2 : 1] = {};
+    ei_impulse_handle_t* helper_impulse = nullptr;
+    TaskHandle_t capture_task_handle = nullptr;
+    TaskHandle_t inference_task_handle = nullptr;
+    TaskHandle_t helper_task_handle = nullptr;
+    volatile TaskHandle_t capture_listener = nullptr;
+    CallbackMetric arena_used_metric{"watermeter_tensor_arena_used_bytes", nullptr,
+        "Tensor arena bytes used by the resident interpreters", Metric::GAUGE, read_arena_used, this};
 
-    static inline uint8_t digit_buf[DIGIT_SIZE];
-
-    void extract_roi_and_recognize(camera_fb_t* fb);
-    void extract_roi(camera_fb_t* fb);
-    void extract_digit(const int item);
-    char recognize_digit();
-    static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr);
+    static void capture_task(void* arg);
+    static void inference_task(void* arg);
+    static void inference_helper_task(void* arg);
+    static int64_t read_arena_used(void* arg);
+    bool capture_frame(Frame* frame);
+    void capture_live_view_frame();
+    void process_frame(Frame* frame);
+    bool frame_changed(camera_fb_t* fb);
+    void publish_roi_jpeg(uint32_t seq);
+    void publish_roi_raw(uint32_t seq);
+    void publish_reading(uint32_t frame, uint32_t time, int64_t captured_us);
+    void publish_frame_jpeg(camera_fb_t* fb);
+    void publish(JpegSnapshot** slot, JpegSnapshot* snapshot);
+    const JpegSnapshot* acquire(JpegSnapshot** slot);
+    void extract_roi(camera_fb_t* fb, uint8_t* out);
+    void extract_roi_full(camera_fb_t* fb, uint8_t* out);
+    void recognize(Recognizer& rec);
+    void recognize_digits(Recognizer& rec);
+    bool recognize_roi(Recognizer& rec);
+    static int ei_camera_get_data(const ei::ei_signal_image_t* image, size_t offset, size_t length, float *out_ptr);
 };
\ No newline at end of file
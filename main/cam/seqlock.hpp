@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+// Publishes a small value from one writer to any number of readers without ever blocking the
+// writer. write() makes the sequence odd while it stores the value, read() copies the value and
+// retries if the sequence was odd or moved meanwhile. The value is kept as 32-bit atomic words so
+// a torn copy is only ever detected and thrown away.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied as words");
+
+public:
+    void write(const T& value) {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            data[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T read() const {
+        uint32_t words[WORDS];
+        for (int tries = 0; ; tries++) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++) {
+                words[i] = data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint32_t after = sequence.load(std::memory_order_relaxed);
+            if (before == after && !(before & 1)) break;
+
+            // A reader above the writer's priority on its core would spin forever, let it finish
+            if (tries >= 2) {
+#ifdef ESP_PLATFORM
+                vTaskDelay(1);
+#else
+                std::this_thread::yield();
+#endif
+            }
+        }
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    // Number of values written
+    uint32_t writes() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + 3) / 4;
+
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> data[WORDS] = {};
+};
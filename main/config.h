@@ -6,7 +6,15 @@
 #define STRINGIFY(x) #x
 #define STRINGIFY_VALUE(x) STRINGIFY(x)
 
-#define UPDATE_MS       3000
+#define UPDATE_MS       3000    // capture period, the inference of the previous frame overlaps it
+
+// Capture/decode on core 0 (with the camera driver), inference on core 1
+#define FRAME_SLOTS         2
+#define CAPTURE_TASK_CORE   0
+#define INFERENCE_TASK_CORE 1
+// Last digits classified on the capture core by a second interpreter, in parallel with the
+// others on the inference core (0: all digits on the inference core)
+#define INFERENCE_HELPER_DIGITS 2
 
 #define ESP_WIFI_SSID   "Xiaomi_DD71"
 #define ESP_WIFI_PASS   "95078191"
@@ -19,16 +27,90 @@
 #define ROI_Y           115
 #define ROI_W           240
 #define ROI_H           48
-#define ROI_SIZE        (ROI_W * ROI_H)
-#define ROI_SIZE_RGB    (ROI_SIZE * 3)
+#define ROI_SIZE        (ROI_W * ROI_H)     // 8-bit luma
 #define DIGIT_W         EI_CLASSIFIER_INPUT_WIDTH
 #define DIGIT_H         EI_CLASSIFIER_INPUT_HEIGHT
-#define DIGIT_SIZE      (DIGIT_W * DIGIT_H * 3)
+#define DIGIT_SIZE      (DIGIT_W * DIGIT_H)
 #define THRESHOLD_VAL   0.6f
+#define ROI_JPEG_QUALITY    12      // /roi.jpg, encoded once per processed frame
+
+// The page (main/web, gzipped in flash) may be cached this long, it is revalidated by ETag after
+#define UI_MAX_AGE_S                86400
+
+// /download.jpg sends the last captured frame in chunks, ?fresh=1 waits up to the timeout for a new one
+// (off the server task, up to FRESH_DOWNLOAD_QUEUE_LEN requests queued, 503 beyond)
+#define DOWNLOAD_CHUNK_SIZE         4096
+#define FRESH_CAPTURE_TIMEOUT_MS    2000
+#define FRESH_DOWNLOAD_QUEUE_LEN    4
+// /stream: the last FRAME_RING_SIZE captures are kept for the viewers, while one is connected a
+// frame is captured every LIVE_VIEW_FRAME_MS (recognition stays at UPDATE_MS)
+#define FRAME_RING_SIZE             4
+#define LIVE_VIEW_FRAME_MS          100
+#define STREAM_MAX_CLIENTS          3
+#define STREAM_TASK_PRIORITY        3
+#define STREAM_POLL_MS              20
+// /events: a reading event when the digits or confidences change (checked every SSE_POLL_MS),
+// a heartbeat comment after SSE_HEARTBEAT_MS without one
+#define SSE_MAX_CLIENTS             4
+#define SSE_POLL_MS                 100
+#define SSE_HEARTBEAT_MS            15000
+#define SSE_RETRY_MS                3000    // browser reconnect delay
+// 1: one FOMO pass over the whole ROI (DIGIT_NUM tiles), 0: one pass per digit crop
+#define WHOLE_ROI_INFERENCE 1
+
+// Frame gating on the DC-only 1/8 scale thumbnail of the QVGA frame
+#define THUMB_W             40
+#define THUMB_H             30
+#define CHANGE_PIXEL_DELTA  8       // luma levels a thumbnail pixel in the ROI must move
+#define CHANGE_MIN_PIXELS   2       // moved thumbnail pixels needed to process the frame
+#define CHANGE_MAX_SKIPPED  20      // process at least every N frames anyway
+
+// Begin/end events of the pipeline stages, the last TRACE_RING_SIZE (power of two) are exported
+// by /trace.json as Chrome trace JSON
+#define TRACE_ENABLED           1
+#define TRACE_RING_SIZE         2048
+#define TRACE_EXPORT_CHUNK_SIZE 1024
+
+// /metrics latency histograms: bucket bounds HISTOGRAM_MIN_US << 0..HISTOGRAM_BUCKETS-1
+// (64 us to 4.2 s), rendered through a METRICS_BUF_SIZE buffer allocated once
+#define HISTOGRAM_MIN_US        64
+#define HISTOGRAM_BUCKETS       17
+#define METRICS_BUF_SIZE        1024
+
+// /profile: per-op inference times, one op type of JSON at a time
+#define PROFILE_OP_JSON_SIZE    384
+
+// Reading history in PSRAM (HISTORY_BLOCKS * HISTORY_BLOCK_SIZE bytes), a steady reading is
+// recorded again every HISTORY_KEEPALIVE_S, /history returns at most HISTORY_MAX_BUCKETS buckets
+#define HISTORY_BLOCKS          64
+#define HISTORY_BLOCK_SIZE      4096
+#define HISTORY_KEEPALIVE_S     300
+#define HISTORY_MAX_BUCKETS     1000
+#define HISTORY_CHUNK_SIZE      1024
 
 #define IMAGES_DIR      "/sdcard/images"
-#define ROI_PATH        "/images/roi_%d.jpg"
-#define DIGIT_PATH      "/images/digit%d_%d.jpg"
+// Frames are archived as records of append-only segment files (8.3 names, no LFN support)
+#define ARCHIVE_SEGMENT_NAME        "SEG%05u.BIN"
+#define ARCHIVE_SEGMENT_MAX_BYTES   (4 * 1024 * 1024)
+#define ARCHIVE_SEGMENT_MAX_RECORDS 1024
+// Oldest segments are deleted past this size or age (age needs the clock set, 0: no limit)
+#define ARCHIVE_MAX_BYTES           (1024ULL * 1024 * 1024)
+#define ARCHIVE_MAX_AGE_S           (90 * 24 * 3600)
+
+// SD archiving runs below the pipeline tasks on the capture core, frames are copied into a
+// pool of ARCHIVE_POOL_SIZE ROI buffers and dropped when none is free
+#define ARCHIVE_POOL_SIZE       4
+#define ARCHIVE_TASK_PRIORITY   2
+#define ARCHIVE_DROP_OLDEST     1   // 1: replace the oldest queued frame, 0: drop the new one
+// Only frames picked by one of these policies are archived:
+// - a digit's best score in [MIN, MAX) (MIN >= MAX: off, FOMO only reports boxes from
+//   EI_CLASSIFIER_OBJECT_DETECTION_THRESHOLD)
+// - the reading changed
+// - one frame every ARCHIVE_SAMPLE_PERIOD_S (0: off)
+#define ARCHIVE_UNCERTAIN_MIN   0.5f
+#define ARCHIVE_UNCERTAIN_MAX   0.85f
+#define ARCHIVE_ON_CHANGE       1
+#define ARCHIVE_SAMPLE_PERIOD_S 3600
 
 // Camera pins for XIAO ESP32S3
 #define PWDN_GPIO_NUM     -1
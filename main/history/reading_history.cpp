@@ -0,0 +1,264 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "reading_history.hpp"
+
+static const char* TAG = "HISTORY";
+
+// Time delta, value and confidences
+#define HISTORY_MAX_RECORD  (5 + 5 + HISTORY_CONFIDENCE_BYTES)
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline uint8_t* write_varint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline const uint8_t* read_varint(const uint8_t* p, const uint8_t* end, uint32_t* v) {
+    uint32_t result = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        uint8_t b = *p++;
+        result |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+// Of the digit confidences of a record, in percent
+static inline uint8_t lowest_confidence(const uint8_t* confidence) {
+    uint8_t lowest = 15;
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        uint8_t c = (confidence[i / 2] >> ((i & 1) * 4)) & 0x0f;
+        if (c < lowest) lowest = c;
+    }
+    return lowest * 100 / 15;
+}
+
+bool ReadingHistory::init() {
+    blocks = (Block*)heap_caps_calloc(HISTORY_BLOCKS, sizeof(Block), MALLOC_CAP_SPIRAM);
+    scratch = (Block*)heap_caps_malloc(sizeof(Block), MALLOC_CAP_SPIRAM);
+    mutex = xSemaphoreCreateMutex();
+    query_mutex = xSemaphoreCreateMutex();
+    if (!blocks || !scratch || !mutex || !query_mutex) {
+        ESP_LOGE(TAG, "Not enough PSRAM for the reading history");
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Reading history: %d blocks of %d bytes", HISTORY_BLOCKS, HISTORY_BLOCK_SIZE);
+    return true;
+}
+
+void ReadingHistory::start_block() {
+    Block* block = &blocks[next_seq % HISTORY_BLOCKS];
+    if (next_seq >= HISTORY_BLOCKS) {
+        records -= block->count;    // the oldest block is overwritten
+    }
+
+    block->seq = next_seq++;
+    block->base_time = prev_time;
+    block->base_delta = prev_delta;
+    block->base_value = prev_value;
+    block->first_time = 0;
+    block->last_time = 0;
+    block->count = 0;
+    block->used = 0;
+}
+
+void ReadingHistory::add(uint32_t time_s, const char* digits, const float* scores) {
+    if (!blocks) return;
+
+    Record record = {};
+    record.time = time_s;
+    record.valid = true;
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        if (digits[i] < '0' || digits[i] > '9') {
+            record.valid = false;
+        } else {
+            record.value = record.value * 10 + (digits[i] - '0');
+        }
+
+        float score = scores[i] < 0.0f ? 0.0f : scores[i] > 1.0f ? 1.0f : scores[i];
+        record.confidence[i / 2] |= (uint8_t)(score * 15.0f + 0.5f) << ((i & 1) * 4);
+    }
+    if (!record.valid) record.value = 0;
+
+    // A steady reading costs nothing until the keepalive record
+    if (has_last && record.valid == last.valid && record.value == last.value &&
+        memcmp(record.confidence, last.confidence, HISTORY_CONFIDENCE_BYTES) == 0 &&
+        time_s - last.time < HISTORY_KEEPALIVE_S) {
+        skipped++;
+        return;
+    }
+
+    uint8_t encoded[HISTORY_MAX_RECORD];
+    int32_t delta = (int32_t)(time_s - prev_time);
+    uint8_t* p = write_varint(encoded, zigzag(delta - prev_delta));
+    // Values have at most DIGIT_NUM decimal digits, the shifted zigzag delta fits in 32 bits
+    p = write_varint(p, record.valid ? zigzag(record.value - prev_value) << 1 | 1 : 0);
+    memcpy(p, record.confidence, HISTORY_CONFIDENCE_BYTES);
+    p += HISTORY_CONFIDENCE_BYTES;
+    size_t len = p - encoded;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Block* block = current();
+    if (!block || block->used + len > sizeof(block->data)) {
+        start_block();
+        block = current();
+    }
+    memcpy(block->data + block->used, encoded, len);
+    block->used += len;
+    if (block->count++ == 0) block->first_time = time_s;
+    block->last_time = time_s;
+    records++;
+    xSemaphoreGive(mutex);
+
+    prev_time = time_s;
+    prev_delta = delta;
+    if (record.valid) prev_value = record.value;
+    last = record;
+    has_last = true;
+}
+
+const uint8_t* ReadingHistory::decode(const uint8_t* p, const uint8_t* end, uint32_t* time, int32_t* delta,
+                                      int32_t* value, Record* record) {
+    uint32_t dod, v;
+    if (!(p = read_varint(p, end, &dod)) || !(p = read_varint(p, end, &v)) ||
+        end - p < HISTORY_CONFIDENCE_BYTES) {
+        return nullptr;
+    }
+
+    *delta += unzigzag(dod);
+    *time += *delta;
+    if (v & 1) *value += unzigzag(v >> 1);
+
+    record->time = *time;
+    record->valid = v & 1;
+    record->value = *value;
+    memcpy(record->confidence, p, HISTORY_CONFIDENCE_BYTES);
+    return p + HISTORY_CONFIDENCE_BYTES;
+}
+
+void ReadingHistory::query(uint32_t from, uint32_t to, uint32_t step, BucketCallback callback, void* arg) {
+    if (!blocks || step == 0 || to < from) return;
+
+    xSemaphoreTake(query_mutex, portMAX_DELAY);
+
+    HistoryBucket bucket = {};
+    bool stopped = false;
+    Record held = {};               // last recognized reading before the current one
+    // Blocks ending this long before from still hold the reading shown at from
+    uint32_t held_from = from > HISTORY_KEEPALIVE_S ? from - HISTORY_KEEPALIVE_S : 0;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint32_t seq = next_seq > HISTORY_BLOCKS ? next_seq - HISTORY_BLOCKS : 0;
+    xSemaphoreGive(mutex);
+
+    for (; !stopped; seq++) {
+        // Copied under the lock, decoded after it; blocks overwritten meanwhile are skipped
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        if (seq >= next_seq) {
+            xSemaphoreGive(mutex);
+            break;
+        }
+        if (next_seq - seq > HISTORY_BLOCKS) {
+            seq = next_seq - HISTORY_BLOCKS;
+        }
+        const Block* block = &blocks[seq % HISTORY_BLOCKS];
+        bool in_range = block->count > 0 && block->last_time >= held_from;
+        bool past_end = block->count > 0 && block->first_time > to;
+        if (in_range && !past_end) {
+            memcpy(scratch, block, offsetof(Block, data) + block->used);
+        }
+        xSemaphoreGive(mutex);
+
+        if (past_end) break;
+        if (!in_range) continue;
+
+        uint32_t time = scratch->base_time;
+        int32_t delta = scratch->base_delta;
+        int32_t value = scratch->base_value;
+        const uint8_t* p = scratch->data;
+        const uint8_t* end = scratch->data + scratch->used;
+        Record record;
+
+        while (p < end && (p = decode(p, end, &time, &delta, &value, &record))) {
+            if (!record.valid) continue;
+            if (record.time < from) {
+                held = record;
+                continue;
+            }
+            if (record.time > to) {
+                stopped = true;
+                break;
+            }
+
+            uint8_t min_confidence = lowest_confidence(record.confidence);
+
+            uint32_t start = from + (record.time - from) / step * step;
+            if (bucket.count > 0 && start != bucket.start) {
+                if (!callback(bucket, arg)) {
+                    bucket.count = 0;
+                    stopped = true;
+                    break;
+                }
+                bucket.count = 0;
+            }
+            if (bucket.count == 0) {
+                bucket.start = start;
+                bucket.min = bucket.max = record.value;
+                bucket.min_confidence = min_confidence;
+                // Readings equal to the held one were not recorded, it still counts at the start
+                if (held.valid && start - held.time < HISTORY_KEEPALIVE_S) {
+                    if (held.value < bucket.min) bucket.min = held.value;
+                    if (held.value > bucket.max) bucket.max = held.value;
+                    uint8_t held_confidence = lowest_confidence(held.confidence);
+                    if (held_confidence < bucket.min_confidence) bucket.min_confidence = held_confidence;
+                }
+            }
+            if (record.value < bucket.min) bucket.min = record.value;
+            if (record.value > bucket.max) bucket.max = record.value;
+            if (min_confidence < bucket.min_confidence) bucket.min_confidence = min_confidence;
+            bucket.last = record.value;
+            bucket.count++;
+            held = record;
+        }
+    }
+
+    if (bucket.count > 0) callback(bucket, arg);
+
+    xSemaphoreGive(query_mutex);
+}
+
+HistoryStats ReadingHistory::get_stats() {
+    HistoryStats stats = {};
+    if (!blocks) return stats;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint32_t oldest = next_seq > HISTORY_BLOCKS ? next_seq - HISTORY_BLOCKS : 0;
+    for (uint32_t seq = oldest; seq < next_seq; seq++) {
+        stats.bytes += blocks[seq % HISTORY_BLOCKS].used;
+    }
+    if (next_seq > 0) {
+        stats.first_time = blocks[oldest % HISTORY_BLOCKS].first_time;
+        stats.last_time = current()->last_time;
+    }
+    stats.records = records;
+    stats.skipped = skipped;
+    xSemaphoreGive(mutex);
+
+    return stats;
+}
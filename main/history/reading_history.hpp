@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+
+// Readings of the last weeks in a fixed PSRAM ring of HISTORY_BLOCKS blocks of HISTORY_BLOCK_SIZE
+// bytes, the oldest block is overwritten when the ring is full. Each record is
+//
+//   varint  zigzag(time delta - previous time delta)   seconds, 1 byte at a steady rate
+//   varint  zigzag(value - previous value) << 1 | 1    or 0 when a digit was not recognized
+//   u8[]    per digit confidence, 4 bits each (score * 15)
+//
+// decoded from the state stored in the block header, so every block stands on its own. A reading
+// equal to the last one is only recorded again after HISTORY_KEEPALIVE_S.
+// Times are time() seconds: since boot until the clock is set.
+
+#define HISTORY_CONFIDENCE_BYTES    ((DIGIT_NUM + 1) / 2)
+
+struct HistoryBucket {
+    uint32_t start;                 // time of the bucket start
+    int32_t min;
+    int32_t max;
+    int32_t last;
+    uint32_t count;                 // recognized readings in the bucket
+    uint8_t min_confidence;         // lowest digit confidence in the bucket, percent
+};
+
+struct HistoryStats {
+    uint32_t records;               // in the ring
+    uint32_t skipped;               // equal to the last record, since boot
+    uint32_t bytes;                 // used by records
+    uint32_t first_time;
+    uint32_t last_time;
+};
+
+class ReadingHistory {
+public:
+    // Returns false to stop the query
+    typedef bool (*BucketCallback)(const HistoryBucket& bucket, void* arg);
+
+    bool init();
+    // A classified frame, digits may contain DIGIT_EMPTY
+    void add(uint32_t time_s, const char* digits, const float* scores);
+    // Calls callback with min/max/last of the readings in every non-empty step long bucket of
+    // [from, to], oldest first. One block is copied at a time, add() is never held up by the caller.
+    void query(uint32_t from, uint32_t to, uint32_t step, BucketCallback callback, void* arg);
+    HistoryStats get_stats();
+
+private:
+    struct Block {
+        uint32_t seq;               // block number since boot, the ring slot is seq % HISTORY_BLOCKS
+        uint32_t base_time;         // decoder state before the first record
+        int32_t base_delta;
+        int32_t base_value;
+        uint32_t first_time;
+        uint32_t last_time;
+        uint16_t count;
+        uint16_t used;
+        uint8_t data[HISTORY_BLOCK_SIZE - 28];
+    };
+    static_assert(sizeof(Block) == HISTORY_BLOCK_SIZE, "history block header size");
+
+    struct Record {
+        uint32_t time;
+        bool valid;
+        int32_t value;
+        uint8_t confidence[HISTORY_CONFIDENCE_BYTES];
+    };
+
+    Block* blocks = nullptr;
+    Block* scratch = nullptr;       // query copy, under query_mutex
+    SemaphoreHandle_t mutex = nullptr;
+    SemaphoreHandle_t query_mutex = nullptr;
+    uint32_t next_seq = 0;          // of the block after the one being written
+    uint32_t records = 0;
+    uint32_t skipped = 0;
+
+    // Encoder state after the last record
+    uint32_t prev_time = 0;
+    int32_t prev_delta = 0;
+    int32_t prev_value = 0;
+    Record last = {};
+    bool has_last = false;
+
+    Block* current() { return next_seq > 0 ? &blocks[(next_seq - 1) % HISTORY_BLOCKS] : nullptr; }
+    void start_block();
+    static const uint8_t* decode(const uint8_t* p, const uint8_t* end, uint32_t* time, int32_t* delta,
+                                 int32_t* value, Record* record);
+};
@@ -0,0 +1,642 @@
+#include <string.h>
+#include "jpeg_decoder.hpp"
+
+// Natural order index of the n-th coefficient in zigzag order
+static const uint8_t ZIGZAG[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// YCbCr -> RGB in 16-bit fixed point, same tables and rounding as libjpeg
+#define COLOR_SCALEBITS     16
+#define COLOR_ONE_HALF      (1 << (COLOR_SCALEBITS - 1))
+#define COLOR_FIX(x)        ((int32_t)((x) * (1L << COLOR_SCALEBITS) + 0.5))
+
+static int16_t cr_r_tab[256];
+static int16_t cb_b_tab[256];
+static int32_t cr_g_tab[256];
+static int32_t cb_g_tab[256];
+
+static inline uint8_t clamp_u8(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+JpegDecoder::JpegDecoder() {
+    for (int i = 0; i < 256; i++) {
+        int x = i - 128;
+        cr_r_tab[i] = (int16_t)((COLOR_FIX(1.40200) * x + COLOR_ONE_HALF) >> COLOR_SCALEBITS);
+        cb_b_tab[i] = (int16_t)((COLOR_FIX(1.77200) * x + COLOR_ONE_HALF) >> COLOR_SCALEBITS);
+        cr_g_tab[i] = -COLOR_FIX(0.71414) * x;
+        cb_g_tab[i] = -COLOR_FIX(0.34414) * x + COLOR_ONE_HALF;
+    }
+}
+
+bool JpegDecoder::build_huffman(Huffman* huff, const uint8_t* counts, const uint8_t* symbols) {
+    memset(huff->lookup, 0, sizeof(huff->lookup));
+
+    int32_t code = 0;
+    int p = 0;
+    for (int l = 1; l <= 16; l++) {
+        // more codes than fit in l bits (the all-ones code is reserved too), a corrupt table
+        // would index past lookup[]
+        if (code + counts[l - 1] >= (1 << l)) return false;
+        huff->valoffset[l] = p - code;
+        for (int i = 0; i < counts[l - 1]; i++, p++, code++) {
+            huff->symbols[p] = symbols[p];
+            if (l <= JPEG_HUFF_LOOKUP_BITS) {
+                int shift = JPEG_HUFF_LOOKUP_BITS - l;
+                for (int j = 0; j < (1 << shift); j++) {
+                    huff->lookup[(code << shift) | j] = (uint16_t)((l << 8) | symbols[p]);
+                }
+            }
+        }
+        huff->maxcode[l] = counts[l - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+    huff->maxcode[17] = INT32_MAX;
+    huff->defined = true;
+    return true;
+}
+
+bool JpegDecoder::parse_sof(const uint8_t* seg, int len) {
+    if (len < 6 || seg[0] != 8) return false;
+
+    height = (seg[1] << 8) | seg[2];
+    width = (seg[3] << 8) | seg[4];
+    num_components = seg[5];
+    if (width == 0 || height == 0) return false;
+    if ((num_components != 1 && num_components != 3) || len < 6 + num_components * 3) return false;
+
+    h_max = 1;
+    v_max = 1;
+    for (int i = 0; i < num_components; i++) {
+        Component* comp = &components[i];
+        comp->id = seg[6 + i * 3];
+        comp->h = seg[7 + i * 3] >> 4;
+        comp->v = seg[7 + i * 3] & 0x0f;
+        comp->tq = seg[8 + i * 3] & 0x03;
+        if (num_components == 1) {
+            // a single component scan is never interleaved, one block per MCU
+            comp->h = 1;
+            comp->v = 1;
+        }
+        if (comp->h < 1 || comp->h > 2 || comp->v < 1 || comp->v > 2) return false;
+        if (comp->h > h_max) h_max = comp->h;
+        if (comp->v > v_max) v_max = comp->v;
+    }
+
+    // only luma may be subsampled against (4:4:4, 4:2:2, 4:4:0, 4:2:0)
+    for (int i = 1; i < num_components; i++) {
+        if (components[i].h != 1 || components[i].v != 1) return false;
+    }
+    return true;
+}
+
+bool JpegDecoder::parse_dht(const uint8_t* seg, int len) {
+    while (len > 17) {
+        int tc = seg[0] >> 4;
+        int th = seg[0] & 0x0f;
+        if (tc > 1 || th > 3) return false;
+
+        int total = 0;
+        for (int i = 0; i < 16; i++) total += seg[1 + i];
+        if (total > 256 || len < 17 + total) return false;
+
+        if (!build_huffman(tc == 0 ? &dc_tables[th] : &ac_tables[th], seg + 1, seg + 17)) return false;
+
+        seg += 17 + total;
+        len -= 17 + total;
+    }
+    return len == 0;
+}
+
+bool JpegDecoder::parse_dqt(const uint8_t* seg, int len) {
+    while (len > 0) {
+        int pq = seg[0] >> 4;
+        int tq = seg[0] & 0x0f;
+        int size = pq ? 128 : 64;
+        if (tq > 3 || len < 1 + size) return false;
+
+        // kept in zigzag order, like the coefficients in the bitstream
+        for (int i = 0; i < 64; i++) {
+            qt[tq][i] = pq ? (seg[1 + i * 2] << 8) | seg[2 + i * 2] : seg[1 + i];
+        }
+
+        seg += 1 + size;
+        len -= 1 + size;
+    }
+    return true;
+}
+
+bool JpegDecoder::parse_sos(const uint8_t* seg, int len) {
+    if (len < 1) return false;
+    int ns = seg[0];
+    if (ns != num_components || len < 4 + ns * 2) return false;
+
+    for (int i = 0; i < ns; i++) {
+        Component* comp = &components[i];
+        if (comp->id != seg[1 + i * 2]) return false;
+        comp->td = seg[2 + i * 2] >> 4;
+        comp->ta = seg[2 + i * 2] & 0x0f;
+        if (comp->td > 3 || comp->ta > 3 || !dc_tables[comp->td].defined || !ac_tables[comp->ta].defined) return false;
+    }
+
+    // spectral selection / successive approximation must be the baseline full range
+    const uint8_t* tail = seg + 1 + ns * 2;
+    return tail[0] == 0 && tail[1] == 63 && tail[2] == 0;
+}
+
+bool JpegDecoder::parse_headers() {
+    pos = 0;
+    width = height = num_components = 0;
+    restart_interval = 0;
+    for (int i = 0; i < 4; i++) {
+        dc_tables[i].defined = false;
+        ac_tables[i].defined = false;
+    }
+
+    if (data_len < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+    pos = 2;
+
+    while (pos + 4 <= data_len) {
+        if (data[pos] != 0xFF) return false;
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+
+        int len = (data[pos + 2] << 8) | data[pos + 3];
+        if (len < 2 || pos + 2 + len > data_len) return false;
+        const uint8_t* seg = data + pos + 4;
+        int seg_len = len - 2;
+        pos += 2 + len;
+
+        switch (marker) {
+            case 0xC0:
+            case 0xC1:
+                if (!parse_sof(seg, seg_len)) return false;
+                break;
+            case 0xC4:
+                if (!parse_dht(seg, seg_len)) return false;
+                break;
+            case 0xDB:
+                if (!parse_dqt(seg, seg_len)) return false;
+                break;
+            case 0xDD:
+                if (seg_len < 2) return false;
+                restart_interval = (seg[0] << 8) | seg[1];
+                break;
+            case 0xDA:
+                return num_components > 0 && parse_sos(seg, seg_len);
+            case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+            case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+                // progressive, lossless, hierarchical or arithmetic coded
+                return false;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+void JpegDecoder::reset_bits() {
+    bit_buf = 0;
+    bit_cnt = 0;
+    marker_hit = false;
+    padding_bits = 0;
+}
+
+uint8_t JpegDecoder::next_byte() {
+    if (marker_hit || pos >= data_len) {
+        // zeros past the segment, only an error once decoded (see bits_overrun())
+        marker_hit = true;
+        padding_bits += 8;
+        return 0;
+    }
+
+    uint8_t b = data[pos++];
+    if (b == 0xFF) {
+        if (pos < data_len && data[pos] == 0x00) {
+            pos++;
+        } else {
+            // a marker ends the entropy coded segment, leave it for read_restart_marker()
+            pos--;
+            marker_hit = true;
+            padding_bits += 8;
+            return 0;
+        }
+    }
+    return b;
+}
+
+void JpegDecoder::fill_bits() {
+    while (bit_cnt <= 24) {
+        bit_buf |= (uint32_t)next_byte() << (24 - bit_cnt);
+        bit_cnt += 8;
+    }
+}
+
+int JpegDecoder::get_bits(int n) {
+    if (n == 0) return 0;
+    fill_bits();
+    int v = (int)(bit_buf >> (32 - n));
+    bit_buf <<= n;
+    bit_cnt -= n;
+    return v;
+}
+
+int JpegDecoder::decode_huffman(const Huffman* huff) {
+    fill_bits();
+
+    uint16_t entry = huff->lookup[bit_buf >> (32 - JPEG_HUFF_LOOKUP_BITS)];
+    if (entry) {
+        int l = entry >> 8;
+        bit_buf <<= l;
+        bit_cnt -= l;
+        return entry & 0xff;
+    }
+
+    for (int l = JPEG_HUFF_LOOKUP_BITS + 1; l <= 16; l++) {
+        int32_t code = (int32_t)(bit_buf >> (32 - l));
+        if (code <= huff->maxcode[l]) {
+            bit_buf <<= l;
+            bit_cnt -= l;
+            return huff->symbols[code + huff->valoffset[l]];
+        }
+    }
+    return -1;
+}
+
+// Valid 8-bit data never goes past +-1024 (plus half a quantization step), the bound
+// only keeps corrupt data from overflowing the 32-bit IDCT
+static inline int16_t clamp_coef(int v) {
+    return v < -4096 ? -4096 : (v > 4095 ? 4095 : v);
+}
+
+static inline int extend(int v, int s) {
+    return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+}
+
+bool JpegDecoder::skip_to_restart_marker() {
+    while (pos + 1 < data_len) {
+        if (data[pos] == 0xFF && data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7) {
+            reset_bits();
+            return true;
+        }
+        pos++;
+    }
+    return false;
+}
+
+bool JpegDecoder::read_restart_marker() {
+    // whatever is left in the bit buffer is padding before the marker, unless the interval
+    // needed more bits than it had
+    if (bits_overrun() || !skip_to_restart_marker()) return false;
+    pos += 2;
+    for (int i = 0; i < num_components; i++) {
+        components[i].dc_pred = 0;
+    }
+    return true;
+}
+
+bool JpegDecoder::decode_block(Component* comp) {
+    const Huffman* dc = &dc_tables[comp->td];
+    const Huffman* ac = &ac_tables[comp->ta];
+    const uint16_t* q = qt[comp->tq];
+
+    memset(coef, 0, sizeof(coef));
+
+    int t = decode_huffman(dc);
+    if (t < 0 || t > 11) return false;
+    comp->dc_pred += t ? extend(get_bits(t), t) : 0;
+    coef[0] = clamp_coef(comp->dc_pred * q[0]);
+
+    for (int k = 1; k < 64; ) {
+        int rs = decode_huffman(ac);
+        if (rs < 0) return false;
+        int r = rs >> 4;
+        int s = rs & 0x0f;
+        if (s) {
+            k += r;
+            if (k > 63) return false;
+            coef[ZIGZAG[k]] = clamp_coef(extend(get_bits(s), s) * q[k]);
+            k++;
+        } else if (r == 15) {
+            k += 16;
+        } else {
+            break;
+        }
+    }
+    return true;
+}
+
+bool JpegDecoder::skip_block(Component* comp) {
+    const Huffman* dc = &dc_tables[comp->td];
+    const Huffman* ac = &ac_tables[comp->ta];
+
+    int t = decode_huffman(dc);
+    if (t < 0 || t > 11) return false;
+    comp->dc_pred += t ? extend(get_bits(t), t) : 0;
+
+    for (int k = 1; k < 64; ) {
+        int rs = decode_huffman(ac);
+        if (rs < 0) return false;
+        int s = rs & 0x0f;
+        if (s) {
+            get_bits(s);
+            k += (rs >> 4) + 1;
+        } else if ((rs >> 4) == 15) {
+            k += 16;
+        } else {
+            break;
+        }
+    }
+    return true;
+}
+
+// Accurate integer IDCT (libjpeg "islow"), input is dequantized and in natural order
+#define IDCT_CONST_BITS     13
+#define IDCT_PASS1_BITS     2
+#define IDCT_DESCALE(x, n)  (((x) + (1 << ((n) - 1))) >> (n))
+#define FIX_0_298631336     2446
+#define FIX_0_390180644     3196
+#define FIX_0_541196100     4433
+#define FIX_0_765366865     6270
+#define FIX_0_899976223     7373
+#define FIX_1_175875602     9633
+#define FIX_1_501321110     12299
+#define FIX_1_847759065     15137
+#define FIX_1_961570560     16069
+#define FIX_2_053119869     16819
+#define FIX_2_562915447     20995
+#define FIX_3_072711026     25172
+
+// Same idea for the workspace between the passes (valid data stays well inside)
+static inline int32_t clamp_ws(int32_t v) {
+    return v < -16384 ? -16384 : (v > 16383 ? 16383 : v);
+}
+
+void JpegDecoder::idct_block(const int16_t* in, uint8_t* out, int stride) {
+    int32_t ws[64];
+
+    for (int c = 0; c < 8; c++) {
+        const int16_t* col = in + c;
+        int32_t* w = ws + c;
+
+        if (!col[8] && !col[16] && !col[24] && !col[32] && !col[40] && !col[48] && !col[56]) {
+            int32_t dc = col[0] * (1 << IDCT_PASS1_BITS);
+            for (int r = 0; r < 8; r++) w[r * 8] = dc;
+            continue;
+        }
+
+        int32_t z2 = col[16], z3 = col[48];
+        int32_t z1 = (z2 + z3) * FIX_0_541196100;
+        int32_t tmp2 = z1 - z3 * FIX_1_847759065;
+        int32_t tmp3 = z1 + z2 * FIX_0_765366865;
+        z2 = col[0];
+        z3 = col[32];
+        int32_t tmp0 = (z2 + z3) * (1 << IDCT_CONST_BITS);
+        int32_t tmp1 = (z2 - z3) * (1 << IDCT_CONST_BITS);
+        int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+        int32_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+        tmp0 = col[56];
+        tmp1 = col[40];
+        tmp2 = col[24];
+        tmp3 = col[8];
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        int32_t z4 = tmp1 + tmp3;
+        int32_t z5 = (z3 + z4) * FIX_1_175875602;
+        tmp0 *= FIX_0_298631336;
+        tmp1 *= FIX_2_053119869;
+        tmp2 *= FIX_3_072711026;
+        tmp3 *= FIX_1_501321110;
+        z1 *= -FIX_0_899976223;
+        z2 *= -FIX_2_562915447;
+        z3 = z3 * -FIX_1_961570560 + z5;
+        z4 = z4 * -FIX_0_390180644 + z5;
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        const int n = IDCT_CONST_BITS - IDCT_PASS1_BITS;
+        w[0]  = clamp_ws(IDCT_DESCALE(tmp10 + tmp3, n));
+        w[56] = clamp_ws(IDCT_DESCALE(tmp10 - tmp3, n));
+        w[8]  = clamp_ws(IDCT_DESCALE(tmp11 + tmp2, n));
+        w[48] = clamp_ws(IDCT_DESCALE(tmp11 - tmp2, n));
+        w[16] = clamp_ws(IDCT_DESCALE(tmp12 + tmp1, n));
+        w[40] = clamp_ws(IDCT_DESCALE(tmp12 - tmp1, n));
+        w[24] = clamp_ws(IDCT_DESCALE(tmp13 + tmp0, n));
+        w[32] = clamp_ws(IDCT_DESCALE(tmp13 - tmp0, n));
+    }
+
+    for (int r = 0; r < 8; r++) {
+        const int32_t* w = ws + r * 8;
+        uint8_t* o = out + r * stride;
+
+        int32_t z2 = w[2], z3 = w[6];
+        int32_t z1 = (z2 + z3) * FIX_0_541196100;
+        int32_t tmp2 = z1 - z3 * FIX_1_847759065;
+        int32_t tmp3 = z1 + z2 * FIX_0_765366865;
+        int32_t tmp0 = (w[0] + w[4]) * (1 << IDCT_CONST_BITS);
+        int32_t tmp1 = (w[0] - w[4]) * (1 << IDCT_CONST_BITS);
+        int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+        int32_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+        tmp0 = w[7];
+        tmp1 = w[5];
+        tmp2 = w[3];
+        tmp3 = w[1];
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        int32_t z4 = tmp1 + tmp3;
+        int32_t z5 = (z3 + z4) * FIX_1_175875602;
+        tmp0 *= FIX_0_298631336;
+        tmp1 *= FIX_2_053119869;
+        tmp2 *= FIX_3_072711026;
+        tmp3 *= FIX_1_501321110;
+        z1 *= -FIX_0_899976223;
+        z2 *= -FIX_2_562915447;
+        z3 = z3 * -FIX_1_961570560 + z5;
+        z4 = z4 * -FIX_0_390180644 + z5;
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        const int n = IDCT_CONST_BITS + IDCT_PASS1_BITS + 3;
+        o[0] = clamp_u8(IDCT_DESCALE(tmp10 + tmp3, n) + 128);
+        o[7] = clamp_u8(IDCT_DESCALE(tmp10 - tmp3, n) + 128);
+        o[1] = clamp_u8(IDCT_DESCALE(tmp11 + tmp2, n) + 128);
+        o[6] = clamp_u8(IDCT_DESCALE(tmp11 - tmp2, n) + 128);
+        o[2] = clamp_u8(IDCT_DESCALE(tmp12 + tmp1, n) + 128);
+        o[5] = clamp_u8(IDCT_DESCALE(tmp12 - tmp1, n) + 128);
+        o[3] = clamp_u8(IDCT_DESCALE(tmp13 + tmp0, n) + 128);
+        o[4] = clamp_u8(IDCT_DESCALE(tmp13 - tmp0, n) + 128);
+    }
+}
+
+bool JpegDecoder::decode_roi(const uint8_t* jpg, size_t len, int x, int y, int w, int h, uint8_t* out,
+                             JpegFormat format) {
+    data = jpg;
+    data_len = len;
+
+    if (!parse_headers()) return false;
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > width || y + h > height) return false;
+
+    reset_bits();
+    for (int i = 0; i < num_components; i++) {
+        components[i].dc_pred = 0;
+    }
+
+    const int mcu_w = 8 * h_max;
+    const int mcu_h = 8 * v_max;
+    const int mcus_per_row = (width + mcu_w - 1) / mcu_w;
+    const int mcu_rows = (height + mcu_h - 1) / mcu_h;
+    const int total_mcus = mcus_per_row * mcu_rows;
+
+    const int col0 = x / mcu_w, col1 = (x + w - 1) / mcu_w;
+    const int row0 = y / mcu_h, row1 = (y + h - 1) / mcu_h;
+    const int last_mcu = row1 * mcus_per_row + col1;
+    const bool gray = format == JpegFormat::GRAY8;
+    const int out_bpp = gray ? 1 : 3;
+
+    for (int m = 0; m <= last_mcu; ) {
+        if (restart_interval && m % restart_interval == 0) {
+            if (m > 0 && !read_restart_marker()) return false;
+
+            // a whole interval before or beside the window is skipped without entropy decoding
+            int end = m + restart_interval - 1;
+            if (end >= total_mcus) end = total_mcus - 1;
+            bool needed = false;
+            for (int i = m; i <= end && !needed; i++) {
+                int row = i / mcus_per_row, col = i % mcus_per_row;
+                needed = row >= row0 && row <= row1 && col >= col0 && col <= col1;
+            }
+            if (!needed) {
+                if (!skip_to_restart_marker()) return false;
+                m += restart_interval;
+                continue;
+            }
+        }
+
+        const int mcu_row = m / mcus_per_row;
+        const int mcu_col = m % mcus_per_row;
+        const bool in_window = mcu_row >= row0 && mcu_row <= row1 && mcu_col >= col0 && mcu_col <= col1;
+
+        for (int c = 0; c < num_components; c++) {
+            Component* comp = &components[c];
+            const int stride = comp->h * 8;
+            const bool needed = in_window && (c == 0 || !gray);
+            for (int by = 0; by < comp->v; by++) {
+                for (int bx = 0; bx < comp->h; bx++) {
+                    if (!needed) {
+                        if (!skip_block(comp)) return false;
+                        continue;
+                    }
+                    if (!decode_block(comp)) return false;
+                    idct_block(coef, mcu_buf[c] + by * 8 * stride + bx * 8, stride);
+                }
+            }
+        }
+
+        if (in_window) {
+            // clip the MCU to the window, chroma is upsampled by replication
+            const int px0 = mcu_col * mcu_w, py0 = mcu_row * mcu_h;
+            const int ix0 = x > px0 ? x - px0 : 0;
+            const int iy0 = y > py0 ? y - py0 : 0;
+            const int ix1 = (x + w < px0 + mcu_w ? x + w : px0 + mcu_w) - px0;
+            const int iy1 = (y + h < py0 + mcu_h ? y + h : py0 + mcu_h) - py0;
+            const int hs = h_max == 2 ? 1 : 0;
+            const int vs = v_max == 2 ? 1 : 0;
+
+            for (int j = iy0; j < iy1; j++) {
+                uint8_t* dst = out + ((py0 + j - y) * w + (px0 + ix0 - x)) * out_bpp;
+                const uint8_t* yrow = mcu_buf[0] + j * components[0].h * 8;
+
+                if (gray) {
+                    memcpy(dst, yrow + ix0, ix1 - ix0);
+                    continue;
+                }
+
+                const uint8_t* cbrow = mcu_buf[1] + (j >> vs) * 8;
+                const uint8_t* crrow = mcu_buf[2] + (j >> vs) * 8;
+
+                for (int i = ix0; i < ix1; i++, dst += 3) {
+                    int luma = yrow[i];
+                    if (num_components == 1) {
+                        dst[0] = dst[1] = dst[2] = (uint8_t)luma;
+                        continue;
+                    }
+                    int cb = cbrow[i >> hs];
+                    int cr = crrow[i >> hs];
+                    dst[0] = clamp_u8(luma + cb_b_tab[cb]);
+                    dst[1] = clamp_u8(luma + (int)((cb_g_tab[cb] + cr_g_tab[cr]) >> COLOR_SCALEBITS));
+                    dst[2] = clamp_u8(luma + cr_r_tab[cr]);
+                }
+            }
+        }
+
+        m++;
+    }
+
+    return !bits_overrun();
+}
+
+bool JpegDecoder::decode_dc_thumbnail(const uint8_t* jpg, size_t len, uint8_t* out, int out_w, int out_h) {
+    data = jpg;
+    data_len = len;
+
+    if (!parse_headers()) return false;
+
+    const int thumb_w = (width + 7) / 8;
+    const int thumb_h = (height + 7) / 8;
+    if (thumb_w > out_w || thumb_h > out_h) return false;
+
+    reset_bits();
+    for (int i = 0; i < num_components; i++) {
+        components[i].dc_pred = 0;
+    }
+
+    const int mcus_per_row = (width + 8 * h_max - 1) / (8 * h_max);
+    const int mcu_rows = (height + 8 * v_max - 1) / (8 * v_max);
+    const int total_mcus = mcus_per_row * mcu_rows;
+    Component* luma = &components[0];
+
+    for (int m = 0; m < total_mcus; m++) {
+        if (restart_interval && m > 0 && m % restart_interval == 0 && !read_restart_marker()) return false;
+
+        const int mcu_row = m / mcus_per_row;
+        const int mcu_col = m % mcus_per_row;
+
+        for (int c = 0; c < num_components; c++) {
+            Component* comp = &components[c];
+            for (int by = 0; by < comp->v; by++) {
+                for (int bx = 0; bx < comp->h; bx++) {
+                    if (!skip_block(comp)) return false;
+                    if (comp != luma) continue;
+
+                    // what the IDCT of a DC-only block gives for every pixel of it
+                    const int tx = mcu_col * comp->h + bx;
+                    const int ty = mcu_row * comp->v + by;
+                    if (tx < thumb_w && ty < thumb_h) {
+                        out[ty * thumb_w + tx] = clamp_u8(IDCT_DESCALE(comp->dc_pred * qt[comp->tq][0], 3) + 128);
+                    }
+                }
+            }
+        }
+    }
+
+    return !bits_overrun();
+}
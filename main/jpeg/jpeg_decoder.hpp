@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JPEG_HUFF_LOOKUP_BITS   9
+#define JPEG_MAX_COMPONENTS     3
+
+enum class JpegFormat {
+    RGB888,     // 3 bytes per pixel, B, G, R order (same as fmt2rgb888)
+    GRAY8,      // 1 byte per pixel, the Y component only
+};
+
+// Baseline (8-bit, huffman) JPEG decoder that only does the work needed for a window of the image.
+// MCUs before the window are entropy-decoded only (or skipped whole between restart markers),
+// MCUs outside the window get no IDCT or color conversion, and decoding stops after the window.
+class JpegDecoder {
+public:
+    JpegDecoder();
+
+    // Decode the w x h window at (x, y) into out. In GRAY8 chroma blocks are only entropy-decoded,
+    // there is no chroma IDCT or color conversion.
+    // Returns false for progressive/arithmetic/unsupported subsampling, corrupt or truncated data
+    // or a window that is not inside the image.
+    bool decode_roi(const uint8_t* jpg, size_t len, int x, int y, int w, int h, uint8_t* out,
+                    JpegFormat format = JpegFormat::RGB888);
+
+    // Decode the 1/8 scale luma thumbnail of the whole image (one pixel per 8x8 Y block, from the
+    // DC coefficient only, (width + 7) / 8 by (height + 7) / 8) into out. No IDCT at all, AC
+    // coefficients are only entropy-decoded. Fails if the thumbnail is larger than out_w x out_h.
+    bool decode_dc_thumbnail(const uint8_t* jpg, size_t len, uint8_t* out, int out_w, int out_h);
+
+    int image_width() const { return width; }
+    int image_height() const { return height; }
+
+private:
+    struct Huffman {
+        uint16_t lookup[1 << JPEG_HUFF_LOOKUP_BITS];   // (length << 8) | symbol, 0 if the code is longer
+        int32_t maxcode[18];
+        int32_t valoffset[17];
+        uint8_t symbols[256];
+        bool defined;
+    };
+
+    struct Component {
+        uint8_t id;
+        uint8_t h, v;
+        uint8_t tq, td, ta;
+        int dc_pred;
+    };
+
+    const uint8_t* data = nullptr;
+    size_t data_len = 0;
+    size_t pos = 0;
+
+    uint32_t bit_buf = 0;
+    int bit_cnt = 0;
+    bool marker_hit = false;
+    int padding_bits = 0;           // zero bits fed after a marker or the end of the data
+
+    int width = 0;
+    int height = 0;
+    int num_components = 0;
+    int h_max = 1;
+    int v_max = 1;
+    int restart_interval = 0;
+
+    uint16_t qt[4][64];
+    Huffman dc_tables[4];
+    Huffman ac_tables[4];
+    Component components[JPEG_MAX_COMPONENTS];
+
+    int16_t coef[64];
+    uint8_t mcu_buf[JPEG_MAX_COMPONENTS][256];
+
+    bool parse_headers();
+    bool parse_sof(const uint8_t* seg, int len);
+    bool parse_dht(const uint8_t* seg, int len);
+    bool parse_dqt(const uint8_t* seg, int len);
+    bool parse_sos(const uint8_t* seg, int len);
+    static bool build_huffman(Huffman* huff, const uint8_t* counts, const uint8_t* symbols);
+
+    void reset_bits();
+    uint8_t next_byte();
+    void fill_bits();
+    int get_bits(int n);
+    int decode_huffman(const Huffman* huff);
+    // Bits past the end of the entropy coded segment were decoded: the data was truncated or cut
+    // by a marker (e.g. EOI of a short frame), what was decoded from there on is not the image
+    bool bits_overrun() const { return bit_cnt < padding_bits; }
+    bool read_restart_marker();
+    bool skip_to_restart_marker();
+
+    bool decode_block(Component* comp);
+    bool skip_block(Component* comp);
+    static void idct_block(const int16_t* in, uint8_t* out, int stride);
+};
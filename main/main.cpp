@@ -6,37 +6,34 @@
 
 #include "camera.hpp"
 #include "server.hpp"
+#include "trace.hpp"
 
 WebServer server;
 static Camera g_camera;
 
 static const char* TAG = "MAIN";
 
-void camera_task(void* pvParameters) {
-    while (true) {
-        if (xSemaphoreTake(g_camera.camera_mutex, pdMS_TO_TICKS(5000)) == pdTRUE) {
-            g_camera.take_photo_and_process();
-            xSemaphoreGive(g_camera.camera_mutex);
-        } else {
-            ESP_LOGW(TAG, "Timeout waiting for camera mutex in EI task");
-        }
-        vTaskDelay(pdMS_TO_TICKS(UPDATE_MS));
-    }
-}
-
 extern "C" void app_main(void) {
     ESP_ERROR_CHECK(nvs_flash_init());
 
+#if TRACE_ENABLED
+    if (!trace_init()) {
+        ESP_LOGW(TAG, "Not enough memory for the trace ring, tracing disabled");
+    }
+#endif
 
     if (!g_camera.init()) {
         ESP_LOGE(TAG, "Camera initialization failed — stopping");
         return;
     }
-    ESP_LOGI(TAG, "Camera initialized. Starting capture task...");
+    ESP_LOGI(TAG, "Camera initialized. Starting capture pipeline...");
         
     server.init(&g_camera);
 
-    xTaskCreate(camera_task, "camera_task", 8192, NULL, 5, nullptr);
+    if (!g_camera.start_pipeline()) {
+        ESP_LOGE(TAG, "Capture pipeline failed to start");
+        return;
+    }
     
     ESP_LOGI(TAG, "System started");
 }
\ No newline at end of file
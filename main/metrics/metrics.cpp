@@ -0,0 +1,220 @@
+#include <string.h>
+#include "metrics.hpp"
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#else
+#include <chrono>
+#endif
+
+static int64_t now_us() {
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Constant initialized, so metrics constructed during static initialization find it ready
+Metric* Metric::head = nullptr;
+
+void MetricsWriter::flush() {
+    if (ok && len > 0) ok = flush_fn && flush_fn(buf, len, arg);
+    len = 0;
+}
+
+void MetricsWriter::chr(char c) {
+    if (len == size) flush();
+    buf[len++] = c;
+}
+
+void MetricsWriter::str(const char* s) {
+    while (*s) {
+        if (len == size) flush();
+        size_t n = strnlen(s, size - len);
+        memcpy(buf + len, s, n);
+        len += n;
+        s += n;
+    }
+}
+
+void MetricsWriter::u64(uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (n > 0) chr(digits[--n]);
+}
+
+void MetricsWriter::i64(int64_t v) {
+    if (v < 0) {
+        chr('-');
+        u64(-(uint64_t)v);
+    } else {
+        u64(v);
+    }
+}
+
+void MetricsWriter::seconds(uint64_t us) {
+    u64(us / 1000000);
+    chr('.');
+    uint32_t fraction = us % 1000000;
+    for (uint32_t div = 100000; div > 0; div /= 10) {
+        chr('0' + fraction / div % 10);
+    }
+}
+
+bool MetricsWriter::finish() {
+    flush();
+    return ok;
+}
+
+Metric::Metric(const char* name, const char* labels, const char* help, Type type)
+    : name(name), labels(labels), help(help), type(type), next(head) {
+    head = this;
+}
+
+void Metric::sample(MetricsWriter& w, const char* suffix, const char* extra) const {
+    w.str(name);
+    if (suffix) w.str(suffix);
+    if (labels || extra) {
+        w.chr('{');
+        if (labels) w.str(labels);
+        if (labels && extra) w.chr(',');
+        if (extra) w.str(extra);
+        w.chr('}');
+    }
+    w.chr(' ');
+}
+
+bool Metric::render_all(MetricsWriter& w) {
+    static const char* const TYPE_NAMES[] = { "counter", "gauge", "histogram" };
+
+    for (const Metric* m = head; m; m = m->next) {
+        bool first_of_family = true;
+        for (const Metric* prev = head; prev != m; prev = prev->next) {
+            if (strcmp(prev->name, m->name) == 0) {
+                first_of_family = false;
+                break;
+            }
+        }
+
+        if (first_of_family) {
+            w.str("# HELP ");
+            w.str(m->name);
+            w.chr(' ');
+            w.str(m->help);
+            w.str("\n# TYPE ");
+            w.str(m->name);
+            w.chr(' ');
+            w.str(TYPE_NAMES[m->type]);
+            w.chr('\n');
+
+            // The rest of the family right after, the format wants it contiguous
+            for (const Metric* member = m; member; member = member->next) {
+                if (strcmp(member->name, m->name) == 0) member->render(w);
+            }
+        }
+    }
+    return w.finish();
+}
+
+void Counter::render(MetricsWriter& w) const {
+    sample(w, nullptr);
+    w.u64(value.load(std::memory_order_relaxed));
+    w.chr('\n');
+}
+
+void Gauge::render(MetricsWriter& w) const {
+    sample(w, nullptr);
+    w.i64(value.load(std::memory_order_relaxed));
+    w.chr('\n');
+}
+
+void CallbackMetric::render(MetricsWriter& w) const {
+    sample(w, nullptr);
+    w.i64(read(arg));
+    w.chr('\n');
+}
+
+void Histogram::observe_us(uint32_t us) {
+    int bucket = 0;
+    if (us > HISTOGRAM_MIN_US) {
+        bucket = 32 - __builtin_clz((us - 1) / HISTOGRAM_MIN_US);
+        if (bucket > HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    // A reader may see the low word wrapped a moment before the carry, once in 71 minutes of sum
+    uint32_t lo = sum_lo.fetch_add(us, std::memory_order_relaxed);
+    if (lo + us < lo) sum_hi.fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Histogram::render(MetricsWriter& w) const {
+    char le[24];
+    uint64_t cumulative = 0;
+
+    for (int i = 0; i <= HISTOGRAM_BUCKETS; i++) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+
+        // le="<bound in seconds>" without snprintf
+        MetricsWriter label(le, sizeof(le), nullptr, nullptr);
+        label.str("le=\"");
+        if (i < HISTOGRAM_BUCKETS) {
+            label.seconds((uint64_t)HISTOGRAM_MIN_US << i);
+        } else {
+            label.str("+Inf");
+        }
+        label.chr('"');
+        label.chr('\0');
+
+        sample(w, "_bucket", le);
+        w.u64(cumulative);
+        w.chr('\n');
+    }
+
+    sample(w, "_sum");
+    w.seconds((uint64_t)sum_hi.load(std::memory_order_relaxed) << 32 | sum_lo.load(std::memory_order_relaxed));
+    w.chr('\n');
+    sample(w, "_count");
+    w.u64(count.load(std::memory_order_relaxed));
+    w.chr('\n');
+}
+
+HistogramTimer::HistogramTimer(Histogram& histogram) : histogram(histogram), start_us(now_us()) {
+}
+
+HistogramTimer::~HistogramTimer() {
+    histogram.observe_us((uint32_t)(now_us() - start_us));
+}
+
+#ifdef ESP_PLATFORM
+// System metrics
+static int64_t read_heap_free(void* caps) {
+    return heap_caps_get_free_size((uint32_t)(uintptr_t)caps);
+}
+
+static int64_t read_heap_min_free(void* caps) {
+    return heap_caps_get_minimum_free_size((uint32_t)(uintptr_t)caps);
+}
+
+static int64_t read_uptime(void*) {
+    return esp_timer_get_time() / 1000000;
+}
+
+static CallbackMetric heap_free_internal("watermeter_heap_free_bytes", "memory=\"internal\"",
+    "Free heap bytes", Metric::GAUGE, read_heap_free, (void*)(uintptr_t)MALLOC_CAP_INTERNAL);
+static CallbackMetric heap_free_psram("watermeter_heap_free_bytes", "memory=\"psram\"",
+    "Free heap bytes", Metric::GAUGE, read_heap_free, (void*)(uintptr_t)MALLOC_CAP_SPIRAM);
+static CallbackMetric heap_min_free_internal("watermeter_heap_min_free_bytes", "memory=\"internal\"",
+    "Lowest free heap bytes since boot", Metric::GAUGE, read_heap_min_free, (void*)(uintptr_t)MALLOC_CAP_INTERNAL);
+static CallbackMetric heap_min_free_psram("watermeter_heap_min_free_bytes", "memory=\"psram\"",
+    "Lowest free heap bytes since boot", Metric::GAUGE, read_heap_min_free, (void*)(uintptr_t)MALLOC_CAP_SPIRAM);
+static CallbackMetric uptime("watermeter_uptime_seconds", nullptr,
+    "Seconds since boot", Metric::COUNTER, read_uptime, nullptr);
+#endif
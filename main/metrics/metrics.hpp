@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// Metrics in the Prometheus text exposition format (version 0.0.4).
+// A metric adds itself to the registry when it is constructed, so they are static objects or
+// members of the static pipeline objects and are all registered before app_main(). Updates are
+// single relaxed atomic operations: safe from any task on either core, they never block.
+// Metrics with the same name form a family, their labels (e.g. "stage=\"capture\"") tell them
+// apart. Counters are 32-bit, a wrap looks like a restart to rate().
+
+// Renders straight into a caller buffer, handed to flush() whenever it fills up
+class MetricsWriter {
+public:
+    typedef bool (*Flush)(const char* data, size_t len, void* arg);
+
+    MetricsWriter(char* buf, size_t size, Flush flush, void* arg)
+        : buf(buf), size(size), flush_fn(flush), arg(arg) {}
+
+    void str(const char* s);
+    void chr(char c);
+    void u64(uint64_t v);
+    void i64(int64_t v);
+    void seconds(uint64_t us);          // microseconds as seconds, 6 decimals
+    // Sends what is left, false if a flush failed
+    bool finish();
+
+private:
+    char* buf;
+    size_t size;
+    size_t len = 0;
+    Flush flush_fn;
+    void* arg;
+    bool ok = true;
+
+    void flush();
+};
+
+class Metric {
+public:
+    enum Type { COUNTER, GAUGE, HISTOGRAM };
+
+    Metric(const char* name, const char* labels, const char* help, Type type);
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    // Every registered metric, HELP and TYPE once per family
+    static bool render_all(MetricsWriter& w);
+
+protected:
+    const char* name;
+    const char* labels;                 // nullptr for none
+    const char* help;
+    Type type;
+
+    // name + suffix + {labels, extra}
+    void sample(MetricsWriter& w, const char* suffix, const char* extra = nullptr) const;
+    virtual void render(MetricsWriter& w) const = 0;
+
+private:
+    Metric* next;
+    static Metric* head;
+};
+
+class Counter : public Metric {
+public:
+    Counter(const char* name, const char* labels, const char* help) : Metric(name, labels, help, COUNTER) {}
+    void inc(uint32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+
+protected:
+    void render(MetricsWriter& w) const override;
+
+private:
+    std::atomic<uint32_t> value{0};
+};
+
+class Gauge : public Metric {
+public:
+    Gauge(const char* name, const char* labels, const char* help) : Metric(name, labels, help, GAUGE) {}
+    void set(int32_t v) { value.store(v, std::memory_order_relaxed); }
+
+protected:
+    void render(MetricsWriter& w) const override;
+
+private:
+    std::atomic<int32_t> value{0};
+};
+
+// A counter or gauge read from elsewhere (heap, queue depth, stats structs) when it is scraped
+class CallbackMetric : public Metric {
+public:
+    typedef int64_t (*Read)(void* arg);
+
+    CallbackMetric(const char* name, const char* labels, const char* help, Type type, Read read, void* arg)
+        : Metric(name, labels, help, type), read(read), arg(arg) {}
+
+    // Read for a (volatile) uint32_t counter kept by its owner, arg is its address
+    static int64_t read_u32(void* value) { return *static_cast<volatile uint32_t*>(value); }
+
+protected:
+    void render(MetricsWriter& w) const override;
+
+private:
+    Read read;
+    void* arg;
+};
+
+// Durations in log2 buckets: HISTOGRAM_MIN_US, twice that, ... HISTOGRAM_BUCKETS bounds, then +Inf
+class Histogram : public Metric {
+public:
+    Histogram(const char* name, const char* labels, const char* help) : Metric(name, labels, help, HISTOGRAM) {}
+    void observe_us(uint32_t us);
+
+protected:
+    void render(MetricsWriter& w) const override;
+
+private:
+    std::atomic<uint32_t> buckets[HISTOGRAM_BUCKETS + 1] = {};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> sum_lo{0};    // sum of the observations in us, 64 bits in two words
+    std::atomic<uint32_t> sum_hi{0};
+};
+
+// Observes the time until the end of the scope
+class HistogramTimer {
+public:
+    explicit HistogramTimer(Histogram& histogram);
+    ~HistogramTimer();
+    HistogramTimer(const HistogramTimer&) = delete;
+    HistogramTimer& operator=(const HistogramTimer&) = delete;
+
+private:
+    Histogram& histogram;
+    int64_t start_us;
+};
@@ -0,0 +1,312 @@
+#include <string.h>
+#include "qoi_codec.hpp"
+
+#define QOI_OP_INDEX    0x00
+#define QOI_OP_DIFF     0x40
+#define QOI_OP_LUMA     0x80
+#define QOI_OP_RUN      0xc0
+#define QOI_OP_RGB      0xfe
+#define QOI_OP_RGBA     0xff
+#define QOI_MASK_2      0xc0
+#define QOI_MAX_RUN     62
+
+// Single channel variant (header channels = 1)
+#define QOI_GRAY_OP_DIFF    0x00    // 0ddddddd: step d - 64
+#define QOI_GRAY_OP_RUN     0x80    // 10rrrrrr: run of r + 1 (up to 63)
+#define QOI_GRAY_OP_VALUE   0xbf    // followed by the value
+#define QOI_GRAY_OP_DIFF2   0xc0    // 11aaabbb: two pixels, steps a - 4 and b - 4
+#define QOI_GRAY_MAX_RUN    63
+
+static const uint8_t QOI_END[QOI_END_SIZE] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+// r | g << 8 | b << 16 | a << 24, so a pixel compares in one instruction
+static inline uint32_t pack(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    return r | (g << 8) | (b << 16) | ((uint32_t)a << 24);
+}
+
+static inline int hash(uint32_t px) {
+    return ((px & 0xff) * 3 + ((px >> 8) & 0xff) * 5 + ((px >> 16) & 0xff) * 7 + (px >> 24) * 11) & 63;
+}
+
+static inline void write_u32_be(uint8_t* p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static inline uint32_t read_u32_be(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline uint32_t load_pixel(const uint8_t* p) {
+    return pack(p[2], p[1], p[0], 255);
+}
+
+template <QoiFormat format>
+static inline void store_pixel(uint8_t* p, uint32_t px) {
+    if (format == QoiFormat::GRAY8) {
+        p[0] = px >> 8;
+    } else {
+        p[0] = px >> 16;
+        p[1] = px >> 8;
+        p[2] = px;
+    }
+}
+
+static size_t encode_gray(const uint8_t* pixels, int w, int h, int stride, uint8_t* out, uint8_t* out_end) {
+    uint8_t prev = 0;
+    int run = 0;
+    uint8_t* p = out;
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t* row = pixels + y * stride;
+        if (out_end - p < w * 2 + (run > 0)) return 0;
+
+        for (int x = 0; x < w; x++) {
+            uint8_t v = row[x];
+
+            if (v == prev) {
+                if (++run == QOI_GRAY_MAX_RUN) {
+                    *p++ = QOI_GRAY_OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                *p++ = QOI_GRAY_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            // Smooth luma mostly moves by a few levels, two such steps share a byte
+            int8_t d = (int8_t)(v - prev);
+            if (d >= -4 && d < 4 && x + 1 < w) {
+                int8_t d2 = (int8_t)(row[x + 1] - v);
+                if (d2 >= -4 && d2 < 4) {
+                    *p++ = QOI_GRAY_OP_DIFF2 | ((d + 4) << 3) | (d2 + 4);
+                    prev = row[++x];
+                    continue;
+                }
+            }
+
+            if (d >= -64 && d < 64) {
+                *p++ = QOI_GRAY_OP_DIFF | (d + 64);
+            } else {
+                *p++ = QOI_GRAY_OP_VALUE;
+                *p++ = v;
+            }
+            prev = v;
+        }
+    }
+
+    if (run > 0) {
+        *p++ = QOI_GRAY_OP_RUN | (run - 1);
+    }
+    return p - out;
+}
+
+static size_t encode_rgb(const uint8_t* pixels, int w, int h, int stride, uint8_t* out, uint8_t* out_end) {
+    uint32_t index[64] = {};
+    uint32_t prev = pack(0, 0, 0, 255);
+    int run = 0;
+    uint8_t* p = out;
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t* row = pixels + y * stride;
+        // Room for the worst case of a whole row, checked once per row
+        if (out_end - p < w * 4 + (run > 0)) return 0;
+
+        for (int x = 0; x < w; x++) {
+            uint32_t px = load_pixel(row + x * 3);
+
+            if (px == prev) {
+                if (++run == QOI_MAX_RUN) {
+                    *p++ = QOI_OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                *p++ = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            int i = hash(px);
+            if (index[i] == px) {
+                *p++ = QOI_OP_INDEX | i;
+            } else {
+                index[i] = px;
+
+                // Alpha is always 255, only the color differences matter
+                int8_t dr = (int8_t)((px & 0xff) - (prev & 0xff));
+                int8_t dg = (int8_t)(((px >> 8) & 0xff) - ((prev >> 8) & 0xff));
+                int8_t db = (int8_t)(((px >> 16) & 0xff) - ((prev >> 16) & 0xff));
+                int8_t dr_dg = dr - dg;
+                int8_t db_dg = db - dg;
+
+                if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+                    *p++ = QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+                } else if (dg > -33 && dg < 32 && dr_dg > -9 && dr_dg < 8 && db_dg > -9 && db_dg < 8) {
+                    *p++ = QOI_OP_LUMA | (dg + 32);
+                    *p++ = ((dr_dg + 8) << 4) | (db_dg + 8);
+                } else {
+                    *p++ = QOI_OP_RGB;
+                    *p++ = px;
+                    *p++ = px >> 8;
+                    *p++ = px >> 16;
+                }
+            }
+            prev = px;
+        }
+    }
+
+    if (run > 0) {
+        *p++ = QOI_OP_RUN | (run - 1);
+    }
+    return p - out;
+}
+
+size_t qoi_encode(const uint8_t* pixels, int w, int h, int stride, QoiFormat format, uint8_t* out, size_t out_size) {
+    if (w <= 0 || h <= 0 || out_size < QOI_HEADER_SIZE + QOI_END_SIZE) return 0;
+
+    memcpy(out, "qoif", 4);
+    write_u32_be(out + 4, w);
+    write_u32_be(out + 8, h);
+    out[12] = format == QoiFormat::GRAY8 ? 1 : 3;   // channels
+    out[13] = 0;                                    // sRGB with linear alpha
+
+    uint8_t* data = out + QOI_HEADER_SIZE;
+    uint8_t* data_end = out + out_size - QOI_END_SIZE;
+    size_t len = format == QoiFormat::GRAY8 ? encode_gray(pixels, w, h, stride, data, data_end)
+                                            : encode_rgb(pixels, w, h, stride, data, data_end);
+    if (len == 0) return 0;
+
+    memcpy(data + len, QOI_END, QOI_END_SIZE);
+    return QOI_HEADER_SIZE + len + QOI_END_SIZE;
+}
+
+template <QoiFormat format>
+static inline void store_gray(uint8_t* out, size_t n, uint8_t v) {
+    if (format == QoiFormat::GRAY8) {
+        out[n] = v;
+    } else {
+        out[n * 3] = out[n * 3 + 1] = out[n * 3 + 2] = v;
+    }
+}
+
+template <QoiFormat format>
+static bool decode_gray(const uint8_t* p, const uint8_t* end, uint8_t* out, size_t pixel_count) {
+    uint8_t v = 0;
+    size_t n = 0;
+
+    while (n < pixel_count) {
+        if (p >= end) return false;
+        int b1 = *p++;
+
+        if ((b1 & 0x80) == QOI_GRAY_OP_DIFF) {
+            v += b1 - 64;
+        } else if ((b1 & QOI_MASK_2) == QOI_GRAY_OP_DIFF2) {
+            if (n + 1 >= pixel_count) return false;
+            v += ((b1 >> 3) & 7) - 4;
+            store_gray<format>(out, n++, v);
+            v += (b1 & 7) - 4;
+        } else if (b1 == QOI_GRAY_OP_VALUE) {
+            if (p >= end) return false;
+            v = *p++;
+        } else {
+            int run = (b1 & 0x3f) + 1;
+            if (n + run > pixel_count) return false;
+            for (int i = 0; i < run - 1; i++) {
+                store_gray<format>(out, n++, v);
+            }
+        }
+
+        store_gray<format>(out, n++, v);
+    }
+
+    return true;
+}
+
+template <QoiFormat format>
+static bool decode_rgb(const uint8_t* p, const uint8_t* end, uint8_t* out, size_t pixel_count) {
+    const int bpp = format == QoiFormat::GRAY8 ? 1 : 3;
+    uint32_t index[64] = {};
+    uint32_t px = pack(0, 0, 0, 255);
+    int run = 0;
+
+    for (size_t n = 0; n < pixel_count; n++) {
+        if (run > 0) {
+            run--;
+        } else {
+            if (p >= end) return false;
+            int b1 = *p;
+            int chunk_len = b1 == QOI_OP_RGB ? 4 : b1 == QOI_OP_RGBA ? 5 : (b1 & QOI_MASK_2) == QOI_OP_LUMA ? 2 : 1;
+            if (end - p < chunk_len) return false;
+            p++;
+
+            if (b1 == QOI_OP_RGB) {
+                px = pack(p[0], p[1], p[2], px >> 24);
+                p += 3;
+            } else if (b1 == QOI_OP_RGBA) {
+                px = pack(p[0], p[1], p[2], p[3]);
+                p += 4;
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                px = index[b1];
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                uint8_t r = (px & 0xff) + ((b1 >> 4) & 3) - 2;
+                uint8_t g = ((px >> 8) & 0xff) + ((b1 >> 2) & 3) - 2;
+                uint8_t b = ((px >> 16) & 0xff) + (b1 & 3) - 2;
+                px = pack(r, g, b, px >> 24);
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                int b2 = *p++;
+                int dg = (b1 & 0x3f) - 32;
+                uint8_t r = (px & 0xff) + dg - 8 + ((b2 >> 4) & 0x0f);
+                uint8_t g = ((px >> 8) & 0xff) + dg;
+                uint8_t b = ((px >> 16) & 0xff) + dg - 8 + (b2 & 0x0f);
+                px = pack(r, g, b, px >> 24);
+            } else {
+                run = b1 & 0x3f;
+            }
+
+            index[hash(px)] = px;
+        }
+
+        store_pixel<format>(out + n * bpp, px);
+    }
+
+    return true;
+}
+
+bool qoi_decode(const uint8_t* data, size_t len, uint8_t* out, size_t out_size, QoiFormat format,
+                int* w, int* h) {
+    if (len < QOI_HEADER_SIZE + QOI_END_SIZE || memcmp(data, "qoif", 4) != 0) return false;
+
+    uint32_t width = read_u32_be(data + 4);
+    uint32_t height = read_u32_be(data + 8);
+    uint8_t channels = data[12];
+    size_t bpp = format == QoiFormat::GRAY8 ? 1 : 3;
+
+    if (width == 0 || height == 0 || (channels != 1 && channels != 3 && channels != 4) ||
+        width > out_size / bpp / height) {
+        return false;
+    }
+
+    const uint8_t* p = data + QOI_HEADER_SIZE;
+    const uint8_t* end = data + len - QOI_END_SIZE;
+    size_t pixel_count = (size_t)width * height;
+    bool ok;
+    if (channels == 1) {
+        ok = format == QoiFormat::GRAY8 ? decode_gray<QoiFormat::GRAY8>(p, end, out, pixel_count)
+                                        : decode_gray<QoiFormat::RGB888>(p, end, out, pixel_count);
+    } else {
+        ok = format == QoiFormat::GRAY8 ? decode_rgb<QoiFormat::GRAY8>(p, end, out, pixel_count)
+                                        : decode_rgb<QoiFormat::RGB888>(p, end, out, pixel_count);
+    }
+    if (!ok) return false;
+
+    *w = width;
+    *h = height;
+    return true;
+}
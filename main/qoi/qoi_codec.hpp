@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QOI_HEADER_SIZE     14
+#define QOI_END_SIZE        8
+// Worst case encoded size (every pixel a QOI_OP_RGB)
+#define QOI_MAX_SIZE(w, h)  ((size_t)(w) * (h) * 4 + QOI_HEADER_SIZE + QOI_END_SIZE)
+
+enum class QoiFormat {
+    RGB888,     // 3 bytes per pixel, B, G, R order (same as fmt2rgb888)
+    GRAY8,      // 1 byte per pixel
+};
+
+// Lossless single pass QOI (qoiformat.org) encoder/decoder, integer only, into caller buffers.
+// RGB888 images are standard 3-channel QOI. GRAY8 images use a single channel variant marked by
+// channels = 1 in the header: a 1-byte step of -64..63, runs of up to 63 (the 64th run code is
+// the literal tag), or a literal value, so noisy luma costs about a byte per pixel where 3-channel
+// QOI spends two.
+
+// Encode the w x h image (stride bytes between rows) into out, returns the encoded size or 0 if
+// it does not fit in out_size (QOI_MAX_SIZE(w, h) always fits).
+size_t qoi_encode(const uint8_t* pixels, int w, int h, int stride, QoiFormat format, uint8_t* out, size_t out_size);
+
+// Decode a 1, 3 or 4 channel stream into out (alpha is dropped, GRAY8 keeps the green channel of
+// color images, RGB888 replicates gray).
+// Returns false for a bad header, truncated data or an image larger than out_size.
+bool qoi_decode(const uint8_t* data, size_t len, uint8_t* out, size_t out_size, QoiFormat format,
+                int* w, int* h);
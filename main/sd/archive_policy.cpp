@@ -0,0 +1,26 @@
+#include <string.h>
+#include "archive_policy.hpp"
+
+bool UncertainDigitPolicy::wants(const ArchiveCandidate& frame) {
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        if (frame.scores[i] >= min_score && frame.scores[i] < max_score) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadingChangedPolicy::wants(const ArchiveCandidate& frame) {
+    bool changed = !has_last || memcmp(last_digits, frame.digits, DIGIT_NUM) != 0;
+    memcpy(last_digits, frame.digits, DIGIT_NUM);
+    has_last = true;
+    return changed;
+}
+
+bool PeriodicPolicy::wants(const ArchiveCandidate& frame) {
+    if (frame.captured_us < next_us) {
+        return false;
+    }
+    next_us = frame.captured_us + period_us;
+    return true;
+}
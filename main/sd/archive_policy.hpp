@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// What a policy sees of a classified frame
+struct ArchiveCandidate {
+    int64_t captured_us;
+    const char* digits;         // DIGIT_NUM characters
+    const float* scores;        // DIGIT_NUM best scores, 0 if nothing was detected
+};
+
+// Decides whether a frame is worth archiving. The archiver asks every policy about every frame
+// (so each one keeps its own state) and stores the frame if any of them wants it.
+class ArchivePolicy {
+public:
+    virtual ~ArchivePolicy() = default;
+    virtual const char* name() const = 0;
+    virtual bool wants(const ArchiveCandidate& frame) = 0;
+
+    uint32_t get_selected() const { return selected; }
+    void count_selected() { selected++; }
+
+private:
+    volatile uint32_t selected = 0;     // frames this policy asked for
+};
+
+// A digit whose best score is in [min_score, max_score): the crops worth labelling
+class UncertainDigitPolicy : public ArchivePolicy {
+public:
+    UncertainDigitPolicy(float min_score, float max_score) : min_score(min_score), max_score(max_score) {}
+    const char* name() const override { return "uncertain"; }
+    bool wants(const ArchiveCandidate& frame) override;
+
+private:
+    float min_score;
+    float max_score;
+};
+
+// The reading differs from the previous frame
+class ReadingChangedPolicy : public ArchivePolicy {
+public:
+    const char* name() const override { return "changed"; }
+    bool wants(const ArchiveCandidate& frame) override;
+
+private:
+    char last_digits[DIGIT_NUM] = {};
+    bool has_last = false;
+};
+
+// One frame every period_us, whatever it shows
+class PeriodicPolicy : public ArchivePolicy {
+public:
+    explicit PeriodicPolicy(int64_t period_us) : period_us(period_us) {}
+    const char* name() const override { return "periodic"; }
+    bool wants(const ArchiveCandidate& frame) override;
+
+private:
+    int64_t period_us;
+    int64_t next_us = 0;
+};
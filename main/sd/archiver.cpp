@@ -0,0 +1,197 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "qoi_codec.hpp"
+#include "archiver.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+
+static const char* TAG = "ARCHIVER";
+
+static Histogram archive_seconds("watermeter_stage_seconds", "stage=\"archive\"", "Pipeline stage latency");
+static Histogram encode_seconds("watermeter_stage_seconds", "stage=\"archive_encode\"", "Pipeline stage latency");
+static Histogram append_seconds("watermeter_stage_seconds", "stage=\"archive_append\"", "Pipeline stage latency");
+
+bool Archiver::start() {
+    if (ARCHIVE_UNCERTAIN_MAX > ARCHIVE_UNCERTAIN_MIN) {
+        add_policy(&uncertain_policy);
+    }
+#if ARCHIVE_ON_CHANGE
+    add_policy(&changed_policy);
+#endif
+#if ARCHIVE_SAMPLE_PERIOD_S > 0
+    add_policy(&periodic_policy);
+#endif
+    if (!archive.init(IMAGES_DIR)) {
+        return false;
+    }
+
+    free_jobs = xQueueCreate(ARCHIVE_POOL_SIZE, sizeof(Job));
+    pending_jobs = xQueueCreate(ARCHIVE_POOL_SIZE, sizeof(Job));
+    if (free_jobs == NULL || pending_jobs == NULL) {
+        ESP_LOGE(TAG, "Failed to create archive queues");
+        return false;
+    }
+
+    // The pool lives in PSRAM, it is only touched by memcpy and the encoder
+    encode_buf = (uint8_t*)heap_caps_malloc(ARCHIVE_ENCODE_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    if (!encode_buf) {
+        ESP_LOGE(TAG, "Not enough PSRAM for the archive encoder");
+        return false;
+    }
+    for (int i = 0; i < ARCHIVE_POOL_SIZE; i++) {
+        Job job = {};
+        job.roi = (uint8_t*)heap_caps_malloc(ROI_SIZE, MALLOC_CAP_SPIRAM);
+        if (!job.roi) {
+            ESP_LOGE(TAG, "Not enough PSRAM for the archive pool");
+            return false;
+        }
+        xQueueSend(free_jobs, &job, 0);
+    }
+
+    if (xTaskCreatePinnedToCore(archiver_task, "archiver_task", 4096, this, ARCHIVE_TASK_PRIORITY, nullptr,
+                                CAPTURE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create archiver task");
+        return false;
+    }
+
+    return true;
+}
+
+bool Archiver::add_policy(ArchivePolicy* policy) {
+    if (policy_count == ARCHIVE_MAX_POLICIES) {
+        ESP_LOGE(TAG, "Too many archive policies, %s not added", policy->name());
+        return false;
+    }
+    policies[policy_count++] = policy;
+    ESP_LOGI(TAG, "Archive policy: %s", policy->name());
+    return true;
+}
+
+bool Archiver::submit(const uint8_t* roi, int64_t captured_us, const char* digits, const float* scores) {
+    if (!pending_jobs) return false;
+
+    // Every policy sees every frame, they keep state (last reading, next sample)
+    ArchiveCandidate candidate = { captured_us, digits, scores };
+    bool selected = policy_count == 0;
+    for (int i = 0; i < policy_count; i++) {
+        if (policies[i]->wants(candidate)) {
+            policies[i]->count_selected();
+            selected = true;
+        }
+    }
+    if (!selected) {
+        skipped++;
+        return false;
+    }
+
+    Job job;
+    bool dropped_frame = false;
+
+    if (xQueueReceive(free_jobs, &job, 0) != pdTRUE) {
+        dropped_frame = true;
+#if ARCHIVE_DROP_OLDEST
+        // Reuse the buffer of the oldest frame still waiting, the newest is worth more
+        if (xQueueReceive(pending_jobs, &job, 0) != pdTRUE)
+#endif
+        {
+            dropped++;
+            return false;
+        }
+        dropped++;
+    }
+
+    memcpy(job.roi, roi, ROI_SIZE);
+    job.captured_us = captured_us;
+    memcpy(job.digits, digits, sizeof(job.digits));
+    memcpy(job.scores, scores, sizeof(job.scores));
+    xQueueSend(pending_jobs, &job, 0);
+
+    uint32_t depth = uxQueueMessagesWaiting(pending_jobs);
+    if (depth > max_queued) max_queued = depth;
+
+    return !dropped_frame;
+}
+
+ArchiveStats Archiver::get_stats() {
+    ArchiveStats stats;
+    stats.skipped = skipped;
+    stats.queued = pending_jobs ? uxQueueMessagesWaiting(pending_jobs) : 0;
+    stats.max_queued = max_queued;
+    stats.written = written;
+    stats.dropped = dropped;
+    stats.failed = failed;
+    return stats;
+}
+
+int64_t Archiver::read_queued(void* arg) {
+    Archiver* self = static_cast<Archiver*>(arg);
+    return self->pending_jobs ? uxQueueMessagesWaiting(self->pending_jobs) : 0;
+}
+
+void Archiver::archiver_task(void* arg) {
+    Archiver* self = static_cast<Archiver*>(arg);
+
+    while (true) {
+        Job job;
+        xQueueReceive(self->pending_jobs, &job, portMAX_DELAY);
+
+        if (self->write_job(job)) {
+            self->written++;
+        } else {
+            self->failed++;
+        }
+        xQueueSend(self->free_jobs, &job, 0);
+
+        ESP_LOGD(TAG, "%u queued, %u dropped", (unsigned)uxQueueMessagesWaiting(self->pending_jobs),
+                 (unsigned)self->dropped);
+    }
+}
+
+bool Archiver::write_job(const Job& job) {
+    TRACE_SCOPE("archive_frame");
+    HistogramTimer timer(archive_seconds);
+    ArchiveFrame frame = {};
+    frame.captured_us = job.captured_us;
+    frame.digits = job.digits;
+    frame.scores = job.scores;
+
+    // Lossless, straight from the ROI (crops by stride), into one buffer: no copies, no malloc
+    uint8_t* out = encode_buf;
+    uint8_t* out_end = encode_buf + ARCHIVE_ENCODE_BUF_SIZE;
+
+    TRACE_BEGIN("qoi_encode");
+    int64_t encode_start_us = esp_timer_get_time();
+    frame.roi_img = out;
+    frame.roi_len = qoi_encode(job.roi, ROI_W, ROI_H, ROI_W, QoiFormat::GRAY8, out, out_end - out);
+    out += frame.roi_len;
+    bool ok = frame.roi_len != 0;
+
+    for (int item = 0; ok && item < DIGIT_NUM; item++) {
+        frame.crop_img[item] = out;
+        frame.crop_len[item] = qoi_encode(job.roi + item * DIGIT_W, DIGIT_W, DIGIT_H, ROI_W, QoiFormat::GRAY8,
+                                          out, out_end - out);
+        out += frame.crop_len[item];
+        ok = frame.crop_len[item] != 0;
+    }
+
+    TRACE_END("qoi_encode");
+    encode_seconds.observe_us((uint32_t)(esp_timer_get_time() - encode_start_us));
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Image encoding failed");
+        return false;
+    }
+
+    // One record in the open segment instead of one file per image
+    TRACE_BEGIN("sd_append");
+    int64_t append_start_us = esp_timer_get_time();
+    uint32_t frame_id = archive.append(frame);
+    append_seconds.observe_us((uint32_t)(esp_timer_get_time() - append_start_us));
+    TRACE_END("sd_append");
+    if (frame_id == 0) return false;
+
+    ESP_LOGD(TAG, "Frame %lu archived", (unsigned long)frame_id);
+    return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "config.h"
+#include "frame_archive.hpp"
+#include "archive_policy.hpp"
+#include "qoi_codec.hpp"
+#include "metrics.hpp"
+
+#define ARCHIVE_MAX_POLICIES    4
+#define ARCHIVE_ENCODE_BUF_SIZE (QOI_MAX_SIZE(ROI_W, ROI_H) + DIGIT_NUM * QOI_MAX_SIZE(DIGIT_W, DIGIT_H))
+
+struct ArchiveStats {
+    uint32_t skipped;       // frames no policy asked for
+    uint32_t queued;        // frames waiting to be written right now
+    uint32_t max_queued;    // highest queue depth seen
+    uint32_t written;       // frames appended to the archive
+    uint32_t dropped;       // frames dropped because the SD card fell behind
+    uint32_t failed;        // frames that could not be encoded or written
+};
+
+// Appends the ROI and digit images of processed frames to the SD card archive from a low
+// priority task, so a slow card never holds up the reading. Only frames selected by one of the
+// archive policies are kept (all frames if there is none). Selected frames are copied into a fixed pool of
+// ARCHIVE_POOL_SIZE buffers; when all of them are in use a frame is dropped (the oldest
+// queued one with ARCHIVE_DROP_OLDEST, otherwise the new one) instead of waiting.
+class Archiver {
+public:
+    // Registers the policies enabled in config.h and starts the archiver task
+    bool start();
+    // Before start(), for policies of your own (the archiver does not own them)
+    bool add_policy(ArchivePolicy* policy);
+
+    // Queue a copy of the ROI (ROI_W x ROI_H luma) and the reading of a frame, never blocks.
+    // Returns false if no policy selected the frame or it was dropped.
+    bool submit(const uint8_t* roi, int64_t captured_us, const char* digits, const float* scores);
+
+    ArchiveStats get_stats();
+    int get_policy_count() const { return policy_count; }
+    const ArchivePolicy* get_policy(int i) const { return policies[i]; }
+    FrameArchive& get_archive() { return archive; }
+
+private:
+    struct Job {
+        uint8_t* roi;
+        int64_t captured_us;
+        char digits[DIGIT_NUM];
+        float scores[DIGIT_NUM];
+    };
+
+    FrameArchive archive;
+    UncertainDigitPolicy uncertain_policy{ ARCHIVE_UNCERTAIN_MIN, ARCHIVE_UNCERTAIN_MAX };
+    ReadingChangedPolicy changed_policy;
+    PeriodicPolicy periodic_policy{ (int64_t)ARCHIVE_SAMPLE_PERIOD_S * 1000000 };
+    ArchivePolicy* policies[ARCHIVE_MAX_POLICIES] = {};
+    int policy_count = 0;
+    QueueHandle_t free_jobs = nullptr;
+    QueueHandle_t pending_jobs = nullptr;
+    uint8_t* encode_buf = nullptr;     // ROI and crops of the frame being written
+
+    volatile uint32_t skipped = 0;
+    volatile uint32_t max_queued = 0;
+    volatile uint32_t written = 0;
+    volatile uint32_t dropped = 0;
+    volatile uint32_t failed = 0;
+
+    CallbackMetric queued_metric{"watermeter_archive_queue_depth", nullptr,
+        "Frames waiting to be written to the SD card", Metric::GAUGE, read_queued, this};
+    CallbackMetric written_metric{"watermeter_archive_frames_total", "result=\"written\"",
+        "Frames handled by the archiver", Metric::COUNTER, CallbackMetric::read_u32, (void*)&written};
+    CallbackMetric dropped_metric{"watermeter_archive_frames_total", "result=\"dropped\"",
+        "Frames handled by the archiver", Metric::COUNTER, CallbackMetric::read_u32, (void*)&dropped};
+    CallbackMetric failed_metric{"watermeter_archive_frames_total", "result=\"failed\"",
+        "Frames handled by the archiver", Metric::COUNTER, CallbackMetric::read_u32, (void*)&failed};
+    CallbackMetric skipped_metric{"watermeter_archive_frames_total", "result=\"skipped\"",
+        "Frames handled by the archiver", Metric::COUNTER, CallbackMetric::read_u32, (void*)&skipped};
+
+    static void archiver_task(void* arg);
+    static int64_t read_queued(void* arg);
+    bool write_job(const Job& job);
+};
@@ -0,0 +1,432 @@
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "frame_archive.hpp"
+#include "metrics.hpp"
+
+static const char* TAG = "ARCHIVE";
+
+static Counter bytes_written("watermeter_archive_bytes_written_total", nullptr,
+    "Record bytes appended to the SD card archive");
+
+bool FrameArchive::init(const char* dir_path) {
+    snprintf(dir, sizeof(dir), "%s", dir_path);
+
+    mutex = xSemaphoreCreateMutex();
+    open_index = (ArchiveIndexEntry*)heap_caps_malloc(ARCHIVE_SEGMENT_MAX_RECORDS * sizeof(ArchiveIndexEntry),
+                                                      MALLOC_CAP_SPIRAM);
+    if (!mutex || !open_index) {
+        ESP_LOGE(TAG, "Not enough memory for the archive");
+        return false;
+    }
+
+    // The only directory scan, the segment list is kept in memory from here on
+    std::vector<uint32_t> numbers;
+    DIR* d = opendir(dir);
+    if (!d) {
+        ESP_LOGE(TAG, "Failed to open %s", dir);
+        return false;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+        unsigned number;
+        char name[16];
+        if (sscanf(entry->d_name, ARCHIVE_SEGMENT_NAME, &number) == 1) {
+            snprintf(name, sizeof(name), ARCHIVE_SEGMENT_NAME, number);
+            if (strcmp(name, entry->d_name) == 0) numbers.push_back(number);
+        }
+    }
+    closedir(d);
+    std::sort(numbers.begin(), numbers.end());
+
+    for (uint32_t number : numbers) {
+        Segment segment;
+        if (load_segment(number, &segment)) {
+            segments.push_back(segment);
+            stored_bytes += segment.size;
+            next_frame_id = segment.last_frame_id + 1;
+        }
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    evict_old_segments();
+    xSemaphoreGive(mutex);
+
+    ESP_LOGI(TAG, "%d segments, %llu bytes, frames %lu..%lu", (int)segments.size(), (unsigned long long)stored_bytes,
+             (unsigned long)first_frame_id(), (unsigned long)last_frame_id());
+    return true;
+}
+
+void FrameArchive::close() {
+    if (!mutex) return;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    close_segment();
+    xSemaphoreGive(mutex);
+}
+
+void FrameArchive::segment_path(uint32_t number, char* path, size_t size) {
+    snprintf(path, size, "%s/" ARCHIVE_SEGMENT_NAME, dir, (unsigned)number);
+}
+
+bool FrameArchive::load_segment(uint32_t number, Segment* segment) {
+    char path[64];
+    segment_path(number, path, sizeof(path));
+
+    FILE* file = fopen(path, "r+b");
+    if (!file) {
+        ESP_LOGW(TAG, "Failed to open %s", path);
+        return false;
+    }
+
+    ArchiveSegmentHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != ARCHIVE_SEGMENT_MAGIC ||
+        header.version != ARCHIVE_VERSION || header.digit_num != DIGIT_NUM) {
+        ESP_LOGW(TAG, "%s is not a segment of this archive version, ignored", path);
+        fclose(file);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    segment->number = number;
+    segment->size = size;
+
+    ArchiveSegmentFooter footer = {};
+    ArchiveIndexEntry first = {}, last = {};
+    ArchiveRecordHeader last_record = {};
+    bool indexed = size >= (long)(sizeof(header) + sizeof(footer)) &&
+                   fseek(file, size - sizeof(footer), SEEK_SET) == 0 &&
+                   fread(&footer, sizeof(footer), 1, file) == 1 &&
+                   footer.magic == ARCHIVE_INDEX_MAGIC && footer.count > 0 &&
+                   footer.index_offset + footer.count * sizeof(ArchiveIndexEntry) + sizeof(footer) == (uint32_t)size &&
+                   fseek(file, footer.index_offset, SEEK_SET) == 0 &&
+                   fread(&first, sizeof(first), 1, file) == 1 &&
+                   fseek(file, footer.index_offset + (footer.count - 1) * sizeof(ArchiveIndexEntry), SEEK_SET) == 0 &&
+                   fread(&last, sizeof(last), 1, file) == 1 &&
+                   fseek(file, last.offset, SEEK_SET) == 0 &&
+                   fread(&last_record, sizeof(last_record), 1, file) == 1;
+
+    bool ok;
+    if (indexed) {
+        segment->first_frame_id = first.frame_id;
+        segment->last_frame_id = last.frame_id;
+        segment->last_unix_time = last_record.unix_time;
+        ok = true;
+    } else {
+        ESP_LOGW(TAG, "%s was not closed, rebuilding its index", path);
+        ok = recover_segment(file, segment);
+    }
+
+    fclose(file);
+    if (!ok) {
+        ESP_LOGW(TAG, "%s has no complete record, removed", path);
+        remove(path);
+    }
+    return ok;
+}
+
+bool FrameArchive::recover_segment(FILE* file, Segment* segment) {
+    std::vector<ArchiveIndexEntry> index;
+    uint32_t offset = sizeof(ArchiveSegmentHeader);
+    ArchiveRecordHeader record;
+
+    // Records are back to back, the first one that is cut short or corrupt ends the segment
+    while (fseek(file, offset, SEEK_SET) == 0 && fread(&record, sizeof(record), 1, file) == 1 &&
+           record.magic == ARCHIVE_RECORD_MAGIC && record.record_size >= sizeof(record) &&
+           offset + record.record_size <= segment->size &&
+           (index.empty() || record.frame_id == index.back().frame_id + 1)) {
+        index.push_back({ record.frame_id, offset });
+        offset += record.record_size;
+        segment->last_unix_time = record.unix_time;
+    }
+
+    if (index.empty()) return false;
+
+    if (!write_index(file, index.data(), index.size())) {
+        ESP_LOGE(TAG, "Failed to write the recovered index");
+    }
+
+    fseek(file, 0, SEEK_END);
+    segment->size = ftell(file);
+    segment->first_frame_id = index.front().frame_id;
+    segment->last_frame_id = index.back().frame_id;
+    return true;
+}
+
+bool FrameArchive::write_index(FILE* file, const ArchiveIndexEntry* index, uint32_t count) {
+    // Appended at the end, past a record cut short by a failed write if there is one
+    fseek(file, 0, SEEK_END);
+    ArchiveSegmentFooter footer = { (uint32_t)ftell(file), count, ARCHIVE_INDEX_MAGIC };
+
+    bool ok = fwrite(index, sizeof(ArchiveIndexEntry), count, file) == count &&
+              fwrite(&footer, sizeof(footer), 1, file) == 1;
+    fflush(file);
+    fsync(fileno(file));
+    return ok;
+}
+
+bool FrameArchive::open_segment() {
+    Segment segment = { segments.empty() ? 1 : segments.back().number + 1, next_frame_id, next_frame_id - 1, 0, 0 };
+
+    char path[64];
+    segment_path(segment.number, path, sizeof(path));
+
+    open_file = fopen(path, "wb");
+    if (!open_file) {
+        ESP_LOGE(TAG, "Failed to create %s", path);
+        return false;
+    }
+
+    ArchiveSegmentHeader header = { ARCHIVE_SEGMENT_MAGIC, ARCHIVE_VERSION, DIGIT_NUM, ROI_W, ROI_H, DIGIT_W, DIGIT_H };
+    if (fwrite(&header, sizeof(header), 1, open_file) != 1) {
+        ESP_LOGE(TAG, "Failed to write %s", path);
+        fclose(open_file);
+        open_file = nullptr;
+        remove(path);
+        return false;
+    }
+
+    segment.size = sizeof(header);
+    segments.push_back(segment);
+    stored_bytes += segment.size;
+    open_count = 0;
+    ESP_LOGI(TAG, "Segment %s opened", path);
+    return true;
+}
+
+void FrameArchive::close_segment() {
+    if (!open_file) return;
+
+    Segment& segment = segments.back();
+
+    if (open_count == 0) {
+        char path[64];
+        segment_path(segment.number, path, sizeof(path));
+        fclose(open_file);
+        remove(path);
+        stored_bytes -= segment.size;
+        segments.pop_back();
+    } else {
+        if (!write_index(open_file, open_index, open_count)) {
+            ESP_LOGE(TAG, "Failed to write the index of segment %lu", (unsigned long)segment.number);
+        }
+        uint32_t size = ftell(open_file);
+        stored_bytes += size - segment.size;
+        segment.size = size;
+        fclose(open_file);
+    }
+
+    open_file = nullptr;
+    open_count = 0;
+}
+
+uint32_t FrameArchive::append(const ArchiveFrame& frame) {
+    ArchiveRecordHeader record = {};
+    record.magic = ARCHIVE_RECORD_MAGIC;
+    record.captured_us = frame.captured_us;
+
+    // Without SNTP the clock starts at 1970, the uptime is all there is then
+    time_t now = time(nullptr);
+    record.unix_time = now > 1600000000 ? (uint32_t)now : 0;
+
+    uint32_t offset = sizeof(record);
+    record.roi_offset = offset;
+    record.roi_size = frame.roi_len;
+    offset += frame.roi_len;
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        record.crop_offset[i] = offset;
+        record.crop_size[i] = frame.crop_len[i];
+        offset += frame.crop_len[i];
+
+        record.digits[i] = frame.digits[i];
+        float score = frame.scores[i] < 0.0f ? 0.0f : frame.scores[i] > 1.0f ? 1.0f : frame.scores[i];
+        record.confidence[i] = (uint8_t)(score * 255.0f + 0.5f);
+    }
+    record.record_size = offset;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (open_file && (segments.back().size + record.record_size > ARCHIVE_SEGMENT_MAX_BYTES ||
+                      open_count == ARCHIVE_SEGMENT_MAX_RECORDS)) {
+        close_segment();
+    }
+    if (!open_file && !open_segment()) {
+        xSemaphoreGive(mutex);
+        return 0;
+    }
+
+    Segment& segment = segments.back();
+    record.frame_id = next_frame_id;
+
+    bool ok = fwrite(&record, sizeof(record), 1, open_file) == 1 &&
+              fwrite(frame.roi_img, 1, frame.roi_len, open_file) == frame.roi_len;
+    for (int i = 0; ok && i < DIGIT_NUM; i++) {
+        ok = fwrite(frame.crop_img[i], 1, frame.crop_len[i], open_file) == frame.crop_len[i];
+    }
+    // One flush per record: the data clusters, the FAT and the directory entry of one file
+    ok = ok && fflush(open_file) == 0 && fsync(fileno(open_file)) == 0;
+
+    if (!ok) {
+        // The segment is closed behind the last complete record, appends go to a new one
+        ESP_LOGE(TAG, "Failed to write frame %lu", (unsigned long)record.frame_id);
+        close_segment();
+        xSemaphoreGive(mutex);
+        return 0;
+    }
+
+    open_index[open_count++] = { record.frame_id, segment.size };
+    segment.size += record.record_size;
+    segment.last_frame_id = record.frame_id;
+    segment.last_unix_time = record.unix_time;
+    stored_bytes += record.record_size;
+    next_frame_id++;
+    bytes_written.inc(record.record_size);
+
+    evict_old_segments();
+
+    xSemaphoreGive(mutex);
+    return record.frame_id;
+}
+
+void FrameArchive::evict_old_segments() {
+    time_t now = time(nullptr);
+    bool clock_set = now > 1600000000;
+
+    // Oldest first, the segment list is the index so nothing is enumerated. The newest segment
+    // is always kept.
+    while (segments.size() > 1) {
+        const Segment& oldest = segments.front();
+        bool over_budget = stored_bytes > ARCHIVE_MAX_BYTES;
+        bool expired = ARCHIVE_MAX_AGE_S > 0 && clock_set && oldest.last_unix_time != 0 &&
+                       now - (time_t)oldest.last_unix_time > ARCHIVE_MAX_AGE_S;
+        if (!over_budget && !expired) break;
+
+        char path[64];
+        segment_path(oldest.number, path, sizeof(path));
+        if (remove(path) != 0) {
+            ESP_LOGW(TAG, "Failed to delete %s", path);
+        }
+        ESP_LOGI(TAG, "Segment %s evicted (%s)", path, over_budget ? "size" : "age");
+
+        stored_bytes -= oldest.size;
+        evicted_segments++;
+        segments.pop_front();
+    }
+}
+
+bool FrameArchive::find_record(uint32_t frame_id, FILE** file, uint32_t* offset) {
+    // Segments hold consecutive frame ids, the segment is a binary search and the record is
+    // entry frame_id - first_frame_id of its index
+    auto it = std::upper_bound(segments.begin(), segments.end(), frame_id,
+                               [](uint32_t id, const Segment& s) { return id < s.first_frame_id; });
+    if (it == segments.begin()) return false;
+    const Segment& segment = *(it - 1);
+    if (frame_id > segment.last_frame_id) return false;
+
+    uint32_t position = frame_id - segment.first_frame_id;
+    char path[64];
+    segment_path(segment.number, path, sizeof(path));
+
+    *file = fopen(path, "rb");
+    if (!*file) return false;
+
+    ArchiveIndexEntry entry;
+    if (open_file && &segment == &segments.back()) {
+        entry = open_index[position];
+    } else {
+        ArchiveSegmentFooter footer;
+        if (fseek(*file, segment.size - sizeof(footer), SEEK_SET) != 0 || fread(&footer, sizeof(footer), 1, *file) != 1 ||
+            position >= footer.count ||
+            fseek(*file, footer.index_offset + position * sizeof(entry), SEEK_SET) != 0 ||
+            fread(&entry, sizeof(entry), 1, *file) != 1) {
+            entry.frame_id = 0;
+        }
+    }
+
+    if (entry.frame_id != frame_id) {
+        fclose(*file);
+        return false;
+    }
+
+    *offset = entry.offset;
+    return true;
+}
+
+bool FrameArchive::read_header(uint32_t frame_id, ArchiveRecordHeader* header) {
+    if (!mutex) return false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    FILE* file;
+    uint32_t offset;
+    bool ok = find_record(frame_id, &file, &offset);
+    if (ok) {
+        ok = fseek(file, offset, SEEK_SET) == 0 && fread(header, sizeof(*header), 1, file) == 1 &&
+             header->magic == ARCHIVE_RECORD_MAGIC && header->frame_id == frame_id;
+        fclose(file);
+    }
+
+    xSemaphoreGive(mutex);
+    return ok;
+}
+
+size_t FrameArchive::read_image(uint32_t frame_id, int image, uint8_t* out, size_t size) {
+    if (!mutex || image < ARCHIVE_IMAGE_ROI || image >= DIGIT_NUM) return 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    FILE* file;
+    uint32_t offset;
+    size_t len = 0;
+    ArchiveRecordHeader header;
+    if (find_record(frame_id, &file, &offset)) {
+        if (fseek(file, offset, SEEK_SET) == 0 && fread(&header, sizeof(header), 1, file) == 1 &&
+            header.magic == ARCHIVE_RECORD_MAGIC && header.frame_id == frame_id) {
+            uint32_t image_offset = image == ARCHIVE_IMAGE_ROI ? header.roi_offset : header.crop_offset[image];
+            uint32_t image_size = image == ARCHIVE_IMAGE_ROI ? header.roi_size : header.crop_size[image];
+            if (image_size <= size && fseek(file, offset + image_offset, SEEK_SET) == 0 &&
+                fread(out, 1, image_size, file) == image_size) {
+                len = image_size;
+            }
+        }
+        fclose(file);
+    }
+
+    xSemaphoreGive(mutex);
+    return len;
+}
+
+uint32_t FrameArchive::first_frame_id() {
+    uint32_t frame_id = 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (const Segment& segment : segments) {
+        if (segment.last_frame_id >= segment.first_frame_id) {
+            frame_id = segment.first_frame_id;
+            break;
+        }
+    }
+    xSemaphoreGive(mutex);
+    return frame_id;
+}
+
+ArchiveUsage FrameArchive::get_usage() {
+    ArchiveUsage usage = {};
+    if (!mutex) return usage;
+
+    uint32_t first = first_frame_id();
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    usage.segments = segments.size();
+    usage.bytes = stored_bytes;
+    usage.first_frame_id = first;
+    usage.last_frame_id = next_frame_id - 1;
+    usage.evicted_segments = evicted_segments;
+    xSemaphoreGive(mutex);
+    return usage;
+}
+
+uint32_t FrameArchive::last_frame_id() {
+    return next_frame_id - 1;
+}
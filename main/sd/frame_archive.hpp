@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <deque>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+
+// Append-only segment files (8.3 names, ARCHIVE_SEGMENT_NAME) holding every archived frame:
+//
+//   ArchiveSegmentHeader
+//   record: ArchiveRecordHeader, ROI image, DIGIT_NUM crop images  (repeated)
+//   index:  ArchiveIndexEntry per record, ArchiveSegmentFooter     (written when the segment is closed)
+//
+// A segment is closed once it reaches ARCHIVE_SEGMENT_MAX_BYTES or ARCHIVE_SEGMENT_MAX_RECORDS.
+// A segment left open by a reset has no index, it is rebuilt from the record headers at init.
+// The oldest segments are deleted whenever the archive exceeds ARCHIVE_MAX_BYTES or its oldest
+// segment is older than ARCHIVE_MAX_AGE_S.
+// Images are lossless QOI (qoi_codec.hpp, GRAY8). All integers are little-endian, offsets are
+// from the start of the segment file.
+
+#define ARCHIVE_SEGMENT_MAGIC   0x47534D57  // "WMSG"
+#define ARCHIVE_RECORD_MAGIC    0x43524D57  // "WMRC"
+#define ARCHIVE_INDEX_MAGIC     0x58494D57  // "WMIX"
+#define ARCHIVE_VERSION         2           // 1: JPEG images
+#define ARCHIVE_IMAGE_ROI       -1          // image number of the ROI, crops are 0..DIGIT_NUM-1
+
+struct __attribute__((packed)) ArchiveSegmentHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t digit_num;
+    uint16_t roi_w, roi_h;
+    uint16_t digit_w, digit_h;
+};
+
+struct __attribute__((packed)) ArchiveRecordHeader {
+    uint32_t magic;
+    uint32_t record_size;               // header and images
+    uint32_t frame_id;                  // increases by one per record, across segments and resets
+    uint32_t unix_time;                 // 0 if the clock was never set
+    int64_t captured_us;                // esp_timer time of the capture
+    uint32_t roi_offset;
+    uint32_t roi_size;
+    uint32_t crop_offset[DIGIT_NUM];
+    uint32_t crop_size[DIGIT_NUM];
+    char digits[DIGIT_NUM];             // DIGIT_EMPTY when not recognized
+    uint8_t confidence[DIGIT_NUM];      // score * 255
+};
+
+struct __attribute__((packed)) ArchiveIndexEntry {
+    uint32_t frame_id;
+    uint32_t offset;                    // of the record header
+};
+
+struct __attribute__((packed)) ArchiveSegmentFooter {
+    uint32_t index_offset;
+    uint32_t count;
+    uint32_t magic;
+};
+
+struct ArchiveUsage {
+    uint32_t segments;
+    uint64_t bytes;
+    uint32_t first_frame_id;
+    uint32_t last_frame_id;
+    uint32_t evicted_segments;          // since boot
+};
+
+// One frame to append, the encoded images are copied into the segment
+struct ArchiveFrame {
+    int64_t captured_us;
+    const char* digits;                 // DIGIT_NUM characters
+    const float* scores;                // DIGIT_NUM best scores (also below THRESHOLD_VAL), 0 if nothing was detected
+    const uint8_t* roi_img;
+    size_t roi_len;
+    const uint8_t* crop_img[DIGIT_NUM];
+    size_t crop_len[DIGIT_NUM];
+};
+
+class FrameArchive {
+public:
+    // Opens the segments in dir (recovering the last one if it was not closed), appends go to a
+    // new segment.
+    bool init(const char* dir);
+    // Closes the open segment (index and footer).
+    void close();
+
+    // Returns the frame id of the new record, 0 on failure.
+    uint32_t append(const ArchiveFrame& frame);
+
+    // Random access by frame id, the segment is found from the in-memory segment list and the
+    // record from the segment index, no directory scan.
+    bool read_header(uint32_t frame_id, ArchiveRecordHeader* header);
+    // Copies image (ARCHIVE_IMAGE_ROI or a digit number) of the frame into out, returns its size,
+    // 0 if the frame or image does not exist or does not fit.
+    size_t read_image(uint32_t frame_id, int image, uint8_t* out, size_t size);
+
+    uint32_t first_frame_id();
+    uint32_t last_frame_id();
+    ArchiveUsage get_usage();
+
+private:
+    struct Segment {
+        uint32_t number;
+        uint32_t first_frame_id;
+        uint32_t last_frame_id;
+        uint32_t size;
+        uint32_t last_unix_time;        // of the newest record, 0 if the clock was not set
+    };
+
+    char dir[32] = "";
+    SemaphoreHandle_t mutex = nullptr;
+    std::deque<Segment> segments;       // by number, the open one (if any) is last
+    uint64_t stored_bytes = 0;          // sum of the segment sizes
+    uint32_t evicted_segments = 0;
+    uint32_t next_frame_id = 1;
+
+    FILE* open_file = nullptr;          // the segment appends go to
+    ArchiveIndexEntry* open_index = nullptr;
+    uint32_t open_count = 0;
+
+    void segment_path(uint32_t number, char* path, size_t size);
+    bool load_segment(uint32_t number, Segment* segment);
+    bool recover_segment(FILE* file, Segment* segment);
+    static bool write_index(FILE* file, const ArchiveIndexEntry* index, uint32_t count);
+    bool open_segment();
+    void close_segment();
+    void evict_old_segments();
+    bool find_record(uint32_t frame_id, FILE** file, uint32_t* offset);
+};
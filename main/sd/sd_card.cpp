@@ -4,8 +4,6 @@
 #include "esp_log.h"
 #include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
-#include "img_converters.h"
-#include "sensor.h"
 #include "sd_card.hpp"
 #include "config.h"
 
@@ -72,38 +70,3 @@ bool SD_card::init()
     ESP_LOGI(TAG, "SD card mounted successfully at /sdcard");
     return true;
 }
-
-bool SD_card::save_as_jpeg(uint8_t* buf, int width, int height, const char* filename, int quality) {
-    uint8_t* jpg_buf = NULL;
-    size_t jpg_len = 0;
-
-    bool ok = fmt2jpg(buf, width * height * 3, width, height, PIXFORMAT_RGB888, quality, &jpg_buf, &jpg_len);
-
-    if (!ok || jpg_len == 0 || !jpg_buf) {
-        ESP_LOGE(TAG, "JPEG encoding failed");
-        return false;
-    }
-
-    char full_path[128];
-    snprintf(full_path, sizeof(full_path), "/sdcard%s", filename);
-    
-    FILE* file = fopen(full_path, "wb");
-    if (!file) {
-        ESP_LOGE(TAG, "Failed to open file %s for writing", full_path);
-        free(jpg_buf);
-        return false;
-    }
-
-    size_t written = fwrite(jpg_buf, 1, jpg_len, file);
-    fclose(file);
-    free(jpg_buf);
-
-    if (written == jpg_len) {
-        ESP_LOGI(TAG, "JPEG saved: %s (%d bytes, %dx%d)", 
-                full_path, (int)jpg_len, width, height);
-        return true;
-    } else {
-        ESP_LOGE(TAG, "Write error: %d/%d bytes", (int)written, (int)jpg_len);
-        return false;
-    }
-}
\ No newline at end of file
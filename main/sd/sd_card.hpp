@@ -8,13 +8,10 @@
 #define SD_PIN_NUM_CS       GPIO_NUM_21
 
 #define IMAGES_DIR      "/sdcard/images"
-#define ROI_PATH        "/images/roi_%d.jpg"
-#define DIGIT_PATH      "/images/digit%d_%d.jpg"
 
 class SD_card {
 public:
     bool init(void);
-    bool save_as_jpeg(uint8_t* buf, int width, int height, const char* filename, int quality);
     bool isSDInitialized() { return sd_initialized; }
 
 private:
@@ -0,0 +1,124 @@
+#include <string.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "event_stream.hpp"
+
+static const char* TAG = "EVENTS";
+
+static const char EVENTS_RESPONSE[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n"
+    "retry: " STRINGIFY_VALUE(SSE_RETRY_MS) "\n\n";
+
+static const char HEARTBEAT[] = ": ping\n\n";
+
+bool EventStream::start(httpd_handle_t server_handle, Camera* camera_ptr) {
+    server = server_handle;
+    camera = camera_ptr;
+
+    if (!sessions.init(TAG, on_client_closed, this)) return false;
+
+    memset(digits, DIGIT_EMPTY, DIGIT_NUM);
+    format_event();
+
+    if (xTaskCreatePinnedToCore(sender_task, "events_task", 3072, this, STREAM_TASK_PRIORITY,
+                                &sender_task_handle, CAPTURE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create events task");
+        return false;
+    }
+    return true;
+}
+
+esp_err_t EventStream::add_client(httpd_req_t* req) {
+    if (!sender_task_handle) {
+        return httpd_resp_send_500(req);
+    }
+
+    esp_err_t result;
+    SessionClient* client = sessions.reserve(req, "Too many event clients", &result);
+    if (!client) return result;
+
+    // The page shows the current reading right away instead of after the next change
+    if (httpd_send(req, EVENTS_RESPONSE, sizeof(EVENTS_RESPONSE) - 1) != (int)sizeof(EVENTS_RESPONSE) - 1 ||
+        httpd_send(req, event, event_len) != (int)event_len) {
+        sessions.unlock();
+        return ESP_FAIL;
+    }
+
+    int count = sessions.attach(req, client);
+    ESP_LOGI(TAG, "Event client connected (socket %d, %d clients)", httpd_req_to_sockfd(req), count);
+    return ESP_OK;
+}
+
+void EventStream::on_client_closed(SessionClient& client, int remaining, void*) {
+    ESP_LOGI(TAG, "Event client on socket %d gone (%d clients)", client.fd, remaining);
+}
+
+bool EventStream::reading_changed() {
+    Camera::Reading reading = camera->get_reading();
+    if (reading.frame == frame_seq) return false;
+    frame_seq = reading.frame;
+
+    // A new frame with the same digits and confidences is not worth an event
+    bool changed = false;
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        uint8_t percent = (uint8_t)(reading.scores[i] * 100.0f + 0.5f);
+        if (reading.digits[i] != digits[i] || percent != confidence[i]) {
+            digits[i] = reading.digits[i];
+            confidence[i] = percent;
+            changed = true;
+        }
+    }
+    digits[DIGIT_NUM] = '\0';
+    return changed;
+}
+
+void EventStream::format_event() {
+    int len = snprintf(event, sizeof(event), "id: %lu\nevent: reading\ndata: {\"digits\":\"%s\",\"frame\":%lu,\"confidence\":[",
+                       (unsigned long)frame_seq, digits, (unsigned long)frame_seq);
+    for (int i = 0; i < DIGIT_NUM; i++) {
+        len += snprintf(event + len, sizeof(event) - len, i > 0 ? ",%u" : "%u", confidence[i]);
+    }
+    len += snprintf(event + len, sizeof(event) - len, "]}\n\n");
+    event_len = len;
+}
+
+void EventStream::send_to_all(const char* data, size_t len) {
+    for (SessionClient& c : sessions) {
+        if (!c.active || c.closing) continue;
+
+        // An event is far smaller than the socket buffer, a client that cannot take one whole
+        // has stopped reading. It is closed, EventSource reconnects and gets the current reading.
+        int written = send(c.fd, data, len, MSG_DONTWAIT);
+        if (written != (int)len) {
+            ESP_LOGW(TAG, "Send to socket %d failed (errno %d), closing", c.fd, written < 0 ? errno : 0);
+            c.closing = true;
+            httpd_sess_trigger_close(server, c.fd);
+        }
+    }
+}
+
+void EventStream::sender_task(void* arg) {
+    EventStream* self = static_cast<EventStream*>(arg);
+    TickType_t last_sent = xTaskGetTickCount();
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(SSE_POLL_MS));
+
+        self->sessions.lock();
+        if (self->reading_changed()) {
+            self->format_event();
+            self->send_to_all(self->event, self->event_len);
+            last_sent = xTaskGetTickCount();
+        } else if (xTaskGetTickCount() - last_sent >= pdMS_TO_TICKS(SSE_HEARTBEAT_MS)) {
+            // Keeps proxies and the browser from timing the connection out
+            self->send_to_all(HEARTBEAT, sizeof(HEARTBEAT) - 1);
+            last_sent = xTaskGetTickCount();
+        }
+        self->sessions.unlock();
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esp_http_server.h"
+#include "camera.hpp"
+#include "session_table.hpp"
+#include "config.h"
+
+// Server-Sent Events (/events) for up to SSE_MAX_CLIENTS pages. One task watches the camera and
+// pushes a "reading" event to every client when the digits or confidences (in percent) of a new
+// frame differ from the last event, and a comment line every SSE_HEARTBEAT_MS otherwise.
+class EventStream {
+public:
+    bool start(httpd_handle_t server, Camera* camera);
+
+    // /events handler: sends the response header and the current reading, the session stays
+    // open until the client goes away
+    esp_err_t add_client(httpd_req_t* req);
+    int get_client_count() const { return sessions.count(); }
+
+private:
+    httpd_handle_t server = nullptr;
+    Camera* camera = nullptr;
+    TaskHandle_t sender_task_handle = nullptr;
+    SessionTable<SessionClient, SSE_MAX_CLIENTS> sessions;     // its lock also guards the event below
+
+    // Last event sent, built once for all clients
+    char digits[DIGIT_NUM + 1] = "";
+    uint8_t confidence[DIGIT_NUM] = {};
+    uint32_t frame_seq = 0;
+    char event[160];
+    size_t event_len = 0;
+
+    static void sender_task(void* arg);
+    static void on_client_closed(SessionClient& client, int remaining, void* arg);
+    bool reading_changed();
+    void format_event();
+    void send_to_all(const char* data, size_t len);
+};
@@ -0,0 +1,167 @@
+#include <string.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "mjpeg_stream.hpp"
+
+#define STREAM_BOUNDARY "wmframe"
+
+static const char* TAG = "STREAM";
+
+static const char STREAM_RESPONSE[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: multipart/x-mixed-replace; boundary=" STREAM_BOUNDARY "\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n";
+
+static const char PART_TRAILER[] = "\r\n";
+
+bool MjpegStream::start(httpd_handle_t server_handle, Camera* camera_ptr) {
+    server = server_handle;
+    camera = camera_ptr;
+
+    if (!sessions.init(TAG, on_client_closed, this)) return false;
+
+    // Below the capture task on its core, a slow network only delays the viewers
+    if (xTaskCreatePinnedToCore(sender_task, "stream_task", 4096, this, STREAM_TASK_PRIORITY,
+                                &sender_task_handle, CAPTURE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create stream task");
+        return false;
+    }
+    return true;
+}
+
+esp_err_t MjpegStream::add_client(httpd_req_t* req) {
+    if (!sender_task_handle) {
+        return httpd_resp_send_500(req);
+    }
+
+    esp_err_t result;
+    Client* client = sessions.reserve(req, "Too many viewers", &result);
+    if (!client) return result;
+
+    // The response is written by hand, the multipart body never ends
+    if (httpd_send(req, STREAM_RESPONSE, sizeof(STREAM_RESPONSE) - 1) != (int)sizeof(STREAM_RESPONSE) - 1) {
+        sessions.unlock();
+        return ESP_FAIL;
+    }
+
+    uint32_t capture_seq = camera->get_capture_seq();
+    client->last_seq = capture_seq > 0 ? capture_seq - 1 : 0;     // starts with the last capture
+    int count = sessions.attach(req, client);
+
+    ESP_LOGI(TAG, "Viewer connected (socket %d, %d viewers)", httpd_req_to_sockfd(req), count);
+    camera->set_live_view(true);
+    xTaskNotifyGive(sender_task_handle);
+    return ESP_OK;
+}
+
+void MjpegStream::on_client_closed(Client& client, int remaining, void* arg) {
+    MjpegStream* self = static_cast<MjpegStream*>(arg);
+
+    if (client.frame) {
+        self->camera->release_jpeg(client.frame);
+        client.frame = nullptr;
+    }
+
+    ESP_LOGI(TAG, "Viewer on socket %d gone, %lu frames sent, %lu skipped (%d viewers)", client.fd,
+             (unsigned long)client.frames_sent, (unsigned long)client.frames_skipped, remaining);
+    if (remaining == 0) self->camera->set_live_view(false);
+}
+
+bool MjpegStream::next_frame(Client& client) {
+    const Camera::JpegSnapshot* frame = camera->acquire_frame_after(client.last_seq);
+    if (!frame) return false;
+
+    client.frames_skipped += frame->seq - client.last_seq - 1;
+    client.frame = frame;
+    client.sent = 0;
+    client.part_header_len = snprintf(client.part_header, sizeof(client.part_header),
+                                      "--" STREAM_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n",
+                                      (unsigned)frame->len);
+    return true;
+}
+
+bool MjpegStream::send_pending(Client& client) {
+    const Camera::JpegSnapshot* frame = client.frame;
+    size_t total = client.part_header_len + frame->len + sizeof(PART_TRAILER) - 1;
+
+    while (client.sent < total) {
+        const char* data;
+        size_t len;
+        if (client.sent < client.part_header_len) {
+            data = client.part_header + client.sent;
+            len = client.part_header_len - client.sent;
+        } else if (client.sent < client.part_header_len + frame->len) {
+            size_t offset = client.sent - client.part_header_len;
+            data = (const char*)frame->buf + offset;
+            len = frame->len - offset;
+        } else {
+            size_t offset = client.sent - client.part_header_len - frame->len;
+            data = PART_TRAILER + offset;
+            len = sizeof(PART_TRAILER) - 1 - offset;
+        }
+
+        // Never waits, the rest goes out the next time the socket is writable
+        int written = send(client.fd, data, len, MSG_DONTWAIT);
+        if (written < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.sent += written;
+    }
+
+    client.last_seq = frame->seq;
+    client.frames_sent++;
+    client.frame = nullptr;
+    camera->release_jpeg(frame);
+    return true;
+}
+
+void MjpegStream::sender_task(void* arg) {
+    MjpegStream* self = static_cast<MjpegStream*>(arg);
+
+    while (true) {
+        fd_set writable;
+        FD_ZERO(&writable);
+        int max_fd = -1;
+
+        self->sessions.lock();
+        for (Client& c : self->sessions) {
+            if (!c.active || c.closing) continue;
+            if (c.frame || self->next_frame(c)) {
+                FD_SET(c.fd, &writable);
+                if (c.fd > max_fd) max_fd = c.fd;
+            }
+        }
+        self->sessions.unlock();
+
+        if (max_fd < 0) {
+            // Nothing new for anyone, add_client() ends the wait early
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STREAM_POLL_MS));
+            continue;
+        }
+
+        struct timeval timeout = { .tv_sec = 0, .tv_usec = STREAM_POLL_MS * 1000 };
+        int ready = select(max_fd + 1, nullptr, &writable, nullptr, &timeout);
+        if (ready < 0) {
+            // A session closed since the set was built, it is gone from the list next time
+            vTaskDelay(1);
+            continue;
+        }
+        if (ready == 0) continue;
+
+        self->sessions.lock();
+        for (Client& c : self->sessions) {
+            if (!c.active || c.closing || !c.frame || !FD_ISSET(c.fd, &writable)) continue;
+            if (!self->send_pending(c)) {
+                ESP_LOGW(TAG, "Send to socket %d failed (errno %d), closing", c.fd, errno);
+                c.closing = true;
+                self->camera->release_jpeg(c.frame);
+                c.frame = nullptr;
+                httpd_sess_trigger_close(self->server, c.fd);
+            }
+        }
+        self->sessions.unlock();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esp_http_server.h"
+#include "camera.hpp"
+#include "session_table.hpp"
+#include "config.h"
+
+// multipart/x-mixed-replace live view (/stream) for up to STREAM_MAX_CLIENTS viewers.
+// Each capture is published once into the camera's frame ring, a single sender task writes it to
+// every viewer with non-blocking sends. A viewer that falls behind skips to the oldest frame still
+// in the ring, capture never waits for the network.
+class MjpegStream {
+public:
+    bool start(httpd_handle_t server, Camera* camera);
+
+    // /stream handler: sends the response header and hands the socket to the sender task, the
+    // session stays open until the client goes away
+    esp_err_t add_client(httpd_req_t* req);
+    int get_client_count() const { return sessions.count(); }
+
+private:
+    struct Client : SessionClient {
+        const Camera::JpegSnapshot* frame;  // being sent, nullptr between frames
+        uint32_t last_seq;              // capture seq of the last frame sent
+        char part_header[96];
+        size_t part_header_len;
+        size_t sent;                    // bytes of part header, JPEG and trailer written
+        uint32_t frames_sent;
+        uint32_t frames_skipped;
+    };
+
+    httpd_handle_t server = nullptr;
+    Camera* camera = nullptr;
+    TaskHandle_t sender_task_handle = nullptr;
+    SessionTable<Client, STREAM_MAX_CLIENTS> sessions;
+
+    static void sender_task(void* arg);
+    static void on_client_closed(Client& client, int remaining, void* arg);
+    bool next_frame(Client& client);
+    bool send_pending(Client& client);
+};
@@ -1,19 +1,45 @@
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_wifi.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "img_converters.h"
+#include "qoi_codec.hpp"
 #include "lwip/err.h"
 #include "lwip/sys.h"
 #include "server.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#if defined(EI_CLASSIFIER_OP_PROFILER) && EI_CLASSIFIER_OP_PROFILER == 1
+#include "edge-impulse-sdk/classifier/inferencing_engines/tflite_op_profiler.h"
+#endif
 #include "config.h"
-#include "server_html.h"
 
 static const char* TAG = "WEBSERVER";
 
+// main/web/index.html, gzipped by the build (main/CMakeLists.txt)
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[] asm("_binary_index_html_gz_end");
+
+// Requests per handler, counted before anything can fail
+static Counter root_requests("watermeter_http_requests_total", "handler=\"/\"", "HTTP requests received");
+static Counter config_requests("watermeter_http_requests_total", "handler=\"/config\"", "HTTP requests received");
+static Counter readings_requests("watermeter_http_requests_total", "handler=\"/readings\"", "HTTP requests received");
+static Counter history_requests("watermeter_http_requests_total", "handler=\"/history\"", "HTTP requests received");
+static Counter trace_requests("watermeter_http_requests_total", "handler=\"/trace.json\"", "HTTP requests received");
+static Counter metrics_requests("watermeter_http_requests_total", "handler=\"/metrics\"", "HTTP requests received");
+static Counter profile_requests("watermeter_http_requests_total", "handler=\"/profile\"", "HTTP requests received");
+static Counter roi_jpg_requests("watermeter_http_requests_total", "handler=\"/roi.jpg\"", "HTTP requests received");
+static Counter roi_qoi_requests("watermeter_http_requests_total", "handler=\"/roi.qoi\"", "HTTP requests received");
+static Counter download_requests("watermeter_http_requests_total", "handler=\"/download.jpg\"", "HTTP requests received");
+static Counter stream_requests("watermeter_http_requests_total", "handler=\"/stream\"", "HTTP requests received");
+static Counter events_requests("watermeter_http_requests_total", "handler=\"/events\"", "HTTP requests received");
+
 WebServer::WebServer() = default;
 
 WebServer::~WebServer() {
@@ -73,6 +99,9 @@ esp_err_t WebServer::start_http_server() {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
     config.lru_purge_enable = true;
+    // /stream and /events sessions stay open, lwIP keeps 3 sockets for the server itself
+    config.max_open_sockets = CONFIG_LWIP_MAX_SOCKETS - 3;
+    config.max_uri_handlers = 16;
 
     httpd_uri_t root = {
         .uri      = "/",
@@ -81,6 +110,13 @@ esp_err_t WebServer::start_http_server() {
         .user_ctx = this
     };
 
+    httpd_uri_t config_uri = {
+        .uri      = "/config",
+        .method   = HTTP_GET,
+        .handler  = config_handler_wrapper,
+        .user_ctx = this
+    };
+
     httpd_uri_t readings = {
         .uri      = "/readings",
         .method   = HTTP_GET,
@@ -88,6 +124,34 @@ esp_err_t WebServer::start_http_server() {
         .user_ctx = this
     };
 
+    httpd_uri_t history = {
+        .uri      = "/history",
+        .method   = HTTP_GET,
+        .handler  = history_handler_wrapper,
+        .user_ctx = this
+    };
+
+    httpd_uri_t trace = {
+        .uri      = "/trace.json",
+        .method   = HTTP_GET,
+        .handler  = trace_handler_wrapper,
+        .user_ctx = this
+    };
+
+    httpd_uri_t metrics = {
+        .uri      = "/metrics",
+        .method   = HTTP_GET,
+        .handler  = metrics_handler_wrapper,
+        .user_ctx = this
+    };
+
+    httpd_uri_t profile = {
+        .uri      = "/profile",
+        .method   = HTTP_GET,
+        .handler  = profile_handler_wrapper,
+        .user_ctx = this
+    };
+
     httpd_uri_t roi_jpg = {
         .uri      = "/roi.jpg",
         .method   = HTTP_GET,
@@ -95,6 +159,13 @@ esp_err_t WebServer::start_http_server() {
         .user_ctx = this
     };
 
+    httpd_uri_t roi_qoi = {
+        .uri      = "/roi.qoi",
+        .method   = HTTP_GET,
+        .handler  = roi_qoi_wrapper,
+        .user_ctx = this
+    };
+
     httpd_uri_t photo_download = {
         .uri      = "/download.jpg",
         .method   = HTTP_GET,
@@ -102,6 +173,33 @@ esp_err_t WebServer::start_http_server() {
         .user_ctx = this
     };
 
+    httpd_uri_t live_stream = {
+        .uri      = "/stream",
+        .method   = HTTP_GET,
+        .handler  = stream_wrapper,
+        .user_ctx = this
+    };
+
+    httpd_uri_t events_uri = {
+        .uri      = "/events",
+        .method   = HTTP_GET,
+        .handler  = events_wrapper,
+        .user_ctx = this
+    };
+
+    // FNV-1a of the page, computed once
+    uint32_t hash = 2166136261u;
+    for (const uint8_t* p = index_html_gz_start; p < index_html_gz_end; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    snprintf(ui_etag, sizeof(ui_etag), "\"%08lx\"", (unsigned long)hash);
+
+    qoi_buf = (uint8_t*)heap_caps_malloc(QOI_MAX_SIZE(ROI_W, ROI_H), MALLOC_CAP_SPIRAM);
+    if (!qoi_buf) {
+        ESP_LOGW(TAG, "Not enough PSRAM for /roi.qoi");
+    }
+    metrics_buf = (char*)malloc(METRICS_BUF_SIZE);
+
     ESP_LOGI(TAG, "Starting HTTP server on port %d", config.server_port);
     if (httpd_start(&server_handle, &config) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start HTTP server");
@@ -109,30 +207,72 @@ esp_err_t WebServer::start_http_server() {
     }
 
     httpd_register_uri_handler(server_handle, &root);
+    httpd_register_uri_handler(server_handle, &config_uri);
     httpd_register_uri_handler(server_handle, &readings);
+    httpd_register_uri_handler(server_handle, &history);
+    httpd_register_uri_handler(server_handle, &trace);
+    httpd_register_uri_handler(server_handle, &metrics);
+    httpd_register_uri_handler(server_handle, &profile);
     httpd_register_uri_handler(server_handle, &roi_jpg);
+    httpd_register_uri_handler(server_handle, &roi_qoi);
     httpd_register_uri_handler(server_handle, &photo_download);
 
+    // ?fresh=1 downloads wait for their capture here, not on the server task
+    if (camera) {
+        TaskHandle_t task = nullptr;
+        fresh_downloads = xQueueCreate(FRESH_DOWNLOAD_QUEUE_LEN, sizeof(httpd_req_t*));
+        if (fresh_downloads &&
+            xTaskCreatePinnedToCore(fresh_download_task, "fresh_download", 3072, this, STREAM_TASK_PRIORITY,
+                                    &task, CAPTURE_TASK_CORE) == pdPASS) {
+            camera->set_capture_listener(task);
+        } else {
+            ESP_LOGW(TAG, "/download.jpg?fresh=1 not available");
+            if (fresh_downloads) vQueueDelete(fresh_downloads);
+            fresh_downloads = nullptr;
+        }
+    }
+
+    if (camera && stream.start(server_handle, camera)) {
+        httpd_register_uri_handler(server_handle, &live_stream);
+    } else {
+        ESP_LOGW(TAG, "/stream not available");
+    }
+    if (camera && events.start(server_handle, camera)) {
+        httpd_register_uri_handler(server_handle, &events_uri);
+    } else {
+        ESP_LOGW(TAG, "/events not available");
+    }
+
     return ESP_OK;
 }
 
 esp_err_t WebServer::root_get_handler(httpd_req_t* req) {
-    char* html_buffer = (char*)malloc(5000);
-    if (!html_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate HTML buffer");
-        return httpd_resp_send_500(req);
+    root_requests.inc();
+    // Straight from flash, the ETag changes with the firmware so a cached page is revalidated
+    httpd_resp_set_hdr(req, "ETag", ui_etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=" STRINGIFY_VALUE(UI_MAX_AGE_S));
+
+    char if_none_match[16];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, ui_etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, nullptr, 0);
     }
 
-    int written = snprintf(html_buffer, 5000, HTML_TEMPLATE, UPDATE_MS);
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char*)index_html_gz_start, index_html_gz_end - index_html_gz_start);
+}
 
-    if (written < 0 || written >= 5000) {
-        free(html_buffer);
-        return httpd_resp_send_500(req);
-    }
+esp_err_t WebServer::config_get_handler(httpd_req_t* req) {
+    config_requests.inc();
+    char json[96];
+    int len = snprintf(json, sizeof(json), "{\"update_ms\":%d,\"digit_num\":%d,\"sse_heartbeat_ms\":%d}",
+                       UPDATE_MS, DIGIT_NUM, SSE_HEARTBEAT_MS);
 
-    esp_err_t res = httpd_resp_send(req, html_buffer, written);
-    free(html_buffer);
-    return res;
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, json, len);
 }
 
 void WebServer::event_handler(void* arg, esp_event_base_t event_base,
@@ -149,6 +289,7 @@ void WebServer::event_handler(void* arg, esp_event_base_t event_base,
 }
 
 esp_err_t WebServer::readings_get_handler(httpd_req_t* req) {
+    readings_requests.inc();
     if (!camera) {
         const char* err = "{\"error\":\"no camera\"}";
         httpd_resp_set_type(req, "application/json");
@@ -156,11 +297,11 @@ esp_err_t WebServer::readings_get_handler(httpd_req_t* req) {
         return ESP_FAIL;
     }
 
-    const char* digits = camera->get_digits();
-    if (!digits) digits = "-----";
+    Camera::Reading reading = camera->get_reading();
 
-    char json[64];
-    snprintf(json, sizeof(json), "{\"digits\":\"%s\"}", digits);
+    char json[96];
+    snprintf(json, sizeof(json), "{\"digits\":\"%s\",\"frame\":%lu,\"time\":%lu}", reading.digits,
+             (unsigned long)reading.frame, (unsigned long)reading.time);
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -169,57 +310,316 @@ esp_err_t WebServer::readings_get_handler(httpd_req_t* req) {
     return ESP_OK;
 }
 
-esp_err_t WebServer::roi_jpg_handler(httpd_req_t* req) {
+// Buckets are batched into chunks of the response as the history is decoded
+struct HistoryWriter {
+    httpd_req_t* req;
+    char buf[HISTORY_CHUNK_SIZE];
+    size_t len;
+    bool first;
+    esp_err_t res;
+
+    bool flush() {
+        if (res == ESP_OK && len > 0) res = httpd_resp_send_chunk(req, buf, len);
+        len = 0;
+        return res == ESP_OK;
+    }
+
+    static bool add_bucket(const HistoryBucket& b, void* arg) {
+        HistoryWriter* w = static_cast<HistoryWriter*>(arg);
+        if (sizeof(w->buf) - w->len < 80 && !w->flush()) return false;
+
+        w->len += snprintf(w->buf + w->len, sizeof(w->buf) - w->len, "%s[%lu,%ld,%ld,%ld,%lu,%u]",
+                           w->first ? "" : ",", (unsigned long)b.start, (long)b.min, (long)b.max,
+                           (long)b.last, (unsigned long)b.count, b.min_confidence);
+        w->first = false;
+        return true;
+    }
+};
+
+static uint32_t query_u32(const char* query, const char* key, uint32_t default_value) {
+    char value[12];
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) return default_value;
+    return strtoul(value, nullptr, 10);
+}
+
+esp_err_t WebServer::history_get_handler(httpd_req_t* req) {
+    history_requests.inc();
     if (!camera) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
 
-    const uint8_t* rgb_buf = camera->get_roi();
-    if (!rgb_buf) {
-        httpd_resp_send_404(req);
+    // Defaults: the last day in 5 minute buckets
+    uint32_t now = (uint32_t)time(nullptr);
+    char query[64] = "";
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    uint32_t to = query_u32(query, "to", now);
+    uint32_t from = query_u32(query, "from", to > 86400 ? to - 86400 : 0);
+    uint32_t step = query_u32(query, "step", 300);
+    if (from > to) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "from > to");
+    }
+    uint32_t min_step = (to - from) / HISTORY_MAX_BUCKETS + 1;
+    if (step < min_step) step = min_step;
+
+    HistoryWriter* w = (HistoryWriter*)malloc(sizeof(HistoryWriter));
+    if (!w) {
+        return httpd_resp_send_500(req);
+    }
+    w->req = req;
+    w->first = true;
+    w->res = ESP_OK;
+
+    // Buckets: [start, min, max, last, count, lowest digit confidence %]
+    w->len = snprintf(w->buf, sizeof(w->buf), "{\"now\":%lu,\"from\":%lu,\"to\":%lu,\"step\":%lu,\"buckets\":[",
+                      (unsigned long)now, (unsigned long)from, (unsigned long)to, (unsigned long)step);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    camera->get_history().query(from, to, step, HistoryWriter::add_bucket, w);
+
+    if (sizeof(w->buf) - w->len < 4) w->flush();
+    w->len += snprintf(w->buf + w->len, sizeof(w->buf) - w->len, "]}");
+    w->flush();
+    esp_err_t res = w->res == ESP_OK ? httpd_resp_send_chunk(req, nullptr, 0) : w->res;
+
+    free(w);
+    return res;
+}
+
+static bool send_chunk(const char* data, size_t len, void* arg) {
+    return httpd_resp_send_chunk(static_cast<httpd_req_t*>(arg), data, len) == ESP_OK;
+}
+
+esp_err_t WebServer::trace_get_handler(httpd_req_t* req) {
+    trace_requests.inc();
+#if TRACE_ENABLED
+    // Load in chrome://tracing or ui.perfetto.dev
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.json\"");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (!trace_export_chrome(send_chunk, req)) {
         return ESP_FAIL;
     }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+#else
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Tracing is disabled (TRACE_ENABLED)");
+#endif
+}
 
-    size_t jpg_buf_len = 0;
-    uint8_t* jpg_buf = nullptr;
+esp_err_t WebServer::metrics_get_handler(httpd_req_t* req) {
+    metrics_requests.inc();
+    if (!metrics_buf) {
+        return httpd_resp_send_500(req);
+    }
 
-    bool converted = fmt2jpg(const_cast<uint8_t*>(rgb_buf), ROI_SIZE_RGB,
-                             ROI_W, ROI_H,
-                             PIXFORMAT_RGB888, 12, &jpg_buf, &jpg_buf_len);
+    // Prometheus text format, rendered chunk by chunk into the one buffer
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
 
-    if (!converted || jpg_buf_len == 0) {
-        ESP_LOGE(TAG, "JPEG encoding failed");
+    MetricsWriter w(metrics_buf, METRICS_BUF_SIZE, send_chunk, req);
+    if (!Metric::render_all(w)) {
         return ESP_FAIL;
     }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
 
-    httpd_resp_set_type(req, "image/jpeg");
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-    httpd_resp_set_hdr(req, "Pragma", "no-cache");
-    httpd_resp_set_hdr(req, "Expires", "0");
+#if defined(EI_CLASSIFIER_OP_PROFILER) && EI_CLASSIFIER_OP_PROFILER == 1
+struct ProfileWriter {
+    ei_op_profile_t ops[EI_OP_PROFILER_MAX_OPS];
+    char buf[PROFILE_OP_JSON_SIZE];
+};
+
+static int format_op_profile(char* buf, size_t size, const ei_op_profile_t& op, bool first) {
+    int len = snprintf(buf, size, "%s{\"op\":\"%s\",\"count\":%lu,\"total_us\":%llu,\"mean_us\":%lu,"
+                       "\"min_us\":%lu,\"max_us\":%lu,\"histogram\":[",
+                       first ? "" : ",", op.name, (unsigned long)op.count, (unsigned long long)op.total_us,
+                       (unsigned long)(op.count ? op.total_us / op.count : 0),
+                       (unsigned long)(op.count ? op.min_us : 0), (unsigned long)op.max_us);
+    for (int b = 0; b < EI_OP_PROFILER_BUCKETS && len < (int)size; b++) {
+        len += snprintf(buf + len, size - len, "%s%lu", b ? "," : "", (unsigned long)op.histogram[b]);
+    }
+    if (len < (int)size) len += snprintf(buf + len, size - len, "]}");
+    return len < (int)size ? len : -1;
+}
+#endif
+
+esp_err_t WebServer::profile_get_handler(httpd_req_t* req) {
+    profile_requests.inc();
+#if defined(EI_CLASSIFIER_OP_PROFILER) && EI_CLASSIFIER_OP_PROFILER == 1
+    if (!camera) {
+        return httpd_resp_send_500(req);
+    }
+
+    ProfileWriter* w = (ProfileWriter*)malloc(sizeof(ProfileWriter));
+    if (!w) {
+        return httpd_resp_send_500(req);
+    }
+
+    // ?reset=1: start over after this response, from the next inference
+    char query[16], value[4];
+    bool reset = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                 httpd_query_key_value(query, "reset", value, sizeof(value)) == ESP_OK && strcmp(value, "1") == 0;
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    // Histogram bucket b: [2^b, 2^(b+1)) us, the first from 0, the last without an upper bound
+    esp_err_t res = httpd_resp_send_chunk(req, "{\"interpreters\":[", HTTPD_RESP_USE_STRLEN);
+    bool first = true;
+    for (int i = 0; res == ESP_OK && i < camera->get_op_profiler_count(); i++) {
+        const char* name;
+        ei_op_profiler_t* profiler = camera->get_op_profiler(i, &name);
+        if (!profiler) continue;
+
+        size_t op_count = profiler->get_ops(w->ops, EI_OP_PROFILER_MAX_OPS);
+        int len = snprintf(w->buf, sizeof(w->buf), "%s{\"name\":\"%s\",\"invokes\":%lu,\"invoke_us\":%llu,\"ops\":[",
+                           first ? "" : ",", name, (unsigned long)profiler->get_invokes(),
+                           (unsigned long long)profiler->get_invoke_total_us());
+        res = httpd_resp_send_chunk(req, w->buf, len);
+        first = false;
+
+        for (size_t op = 0; res == ESP_OK && op < op_count; op++) {
+            len = format_op_profile(w->buf, sizeof(w->buf), w->ops[op], op == 0);
+            res = len > 0 ? httpd_resp_send_chunk(req, w->buf, len) : ESP_FAIL;
+        }
+        if (res == ESP_OK) res = httpd_resp_send_chunk(req, "]}", 2);
+        if (reset) profiler->reset();
+    }
+    if (res == ESP_OK) res = httpd_resp_send_chunk(req, "]}", 2);
+    if (res == ESP_OK) res = httpd_resp_send_chunk(req, nullptr, 0);
 
-    esp_err_t res = httpd_resp_send(req, (const char*)jpg_buf, jpg_buf_len);
+    free(w);
+    return res;
+#else
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Profiling is disabled, build with -DEI_OP_PROFILER=ON");
+#endif
+}
 
-    free(jpg_buf);
+esp_err_t WebServer::roi_jpg_handler(httpd_req_t* req) {
+    roi_jpg_requests.inc();
+    if (!camera) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
 
+    // Encoded by the camera once per frame, sent from its buffer
+    const Camera::JpegSnapshot* snapshot = camera->acquire_roi_jpeg();
+    if (!snapshot) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    char etag[16];
+    snprintf(etag, sizeof(etag), "\"%lu\"", (unsigned long)snapshot->seq);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    esp_err_t res;
+    char if_none_match[24];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        res = httpd_resp_send(req, nullptr, 0);
+    } else {
+        httpd_resp_set_type(req, "image/jpeg");
+        res = httpd_resp_send(req, (const char*)snapshot->buf, snapshot->len);
+    }
+
+    camera->release_jpeg(snapshot);
     return res;
 }
 
+esp_err_t WebServer::roi_qoi_handler(httpd_req_t* req) {
+    roi_qoi_requests.inc();
+    if (!camera || !qoi_buf) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    // Lossless ROI as the classifier saw it, single channel QOI (see qoi_codec.hpp). Encoded
+    // from the copy published with the frame, roi_buf is rewritten by the next one.
+    const Camera::JpegSnapshot* snapshot = camera->acquire_roi_raw();
+    if (!snapshot) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+    size_t qoi_len = qoi_encode(snapshot->buf, ROI_W, ROI_H, ROI_W, QoiFormat::GRAY8,
+                                qoi_buf, QOI_MAX_SIZE(ROI_W, ROI_H));
+    camera->release_jpeg(snapshot);
+    if (qoi_len == 0) {
+        ESP_LOGE(TAG, "QOI encoding failed");
+        return httpd_resp_send_500(req);
+    }
+
+    httpd_resp_set_type(req, "image/qoi");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
+
+    return httpd_resp_send(req, (const char*)qoi_buf, qoi_len);
+}
+
 esp_err_t WebServer::full_photo_handler(httpd_req_t* req) {
+    download_requests.inc();
     ESP_LOGI(TAG, "Start /download.jpg");
     if (!camera) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
 
-    camera_fb_t* fb = camera->get_frame_for_download();
-    if (!fb) {
+    // ?fresh=1: the request goes to fresh_download_task, which waits for the capture, the server
+    // task serves the other clients meanwhile
+    char query[32], value[4];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "fresh", value, sizeof(value)) == ESP_OK && strcmp(value, "1") == 0) {
+        // Only that task takes from the queue, a free place stays free until the send below
+        httpd_req_t* async_req;
+        if (!fresh_downloads || uxQueueSpacesAvailable(fresh_downloads) == 0 ||
+            httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+            httpd_resp_set_status(req, "503 Service Unavailable");
+            return httpd_resp_send(req, "Too many fresh downloads", HTTPD_RESP_USE_STRLEN);
+        }
+        xQueueSend(fresh_downloads, &async_req, 0);
+        return ESP_OK;
+    }
+
+    return send_frame_jpeg(req);
+}
+
+void WebServer::fresh_download_task(void* arg) {
+    WebServer* self = (WebServer*)arg;
+    Camera* camera = self->camera;
+    const TickType_t timeout = pdMS_TO_TICKS(FRESH_CAPTURE_TIMEOUT_MS);
+
+    while (true) {
+        httpd_req_t* req;
+        xQueueReceive(self->fresh_downloads, &req, portMAX_DELAY);
+
+        // Notifications of earlier captures are dropped before reading the seq, a capture
+        // published after it always wakes the wait
+        ulTaskNotifyTake(pdTRUE, 0);
+        uint32_t seq = camera->get_capture_seq();
+        camera->request_capture();
+        TickType_t start = xTaskGetTickCount();
+        for (TickType_t waited = 0; camera->get_capture_seq() == seq && waited < timeout;
+             waited = xTaskGetTickCount() - start) {
+            ulTaskNotifyTake(pdTRUE, timeout - waited);
+        }
+
+        self->send_frame_jpeg(req);
+        httpd_req_async_handler_complete(req);
+    }
+}
+
+esp_err_t WebServer::send_frame_jpeg(httpd_req_t* req) {
+    const Camera::JpegSnapshot* snapshot = camera->acquire_frame_jpeg();
+    if (!snapshot) {
         return httpd_resp_send_500(req);
     }
 
-    uint64_t timestamp_ms = esp_timer_get_time();
     char filename[32];
-    snprintf(filename, sizeof(filename), "water_meter_%llu.jpg", timestamp_ms);
+    snprintf(filename, sizeof(filename), "water_meter_%lu.jpg", (unsigned long)snapshot->seq);
 
     httpd_resp_set_type(req, "image/jpeg");
     char disposition[64];
@@ -227,7 +627,39 @@ esp_err_t WebServer::full_photo_handler(httpd_req_t* req) {
     httpd_resp_set_hdr(req, "Content-Disposition", disposition);
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
 
-    esp_err_t res = httpd_resp_send(req, (const char*)fb->buf, fb->len);
-    camera->return_frame(fb);
+    // A slow client only holds its reference to the snapshot, capture goes on
+    esp_err_t res = ESP_OK;
+    for (size_t offset = 0; res == ESP_OK && offset < snapshot->len; offset += DOWNLOAD_CHUNK_SIZE) {
+        size_t chunk = snapshot->len - offset < DOWNLOAD_CHUNK_SIZE ? snapshot->len - offset : DOWNLOAD_CHUNK_SIZE;
+        res = httpd_resp_send_chunk(req, (const char*)snapshot->buf + offset, chunk);
+    }
+    if (res == ESP_OK) {
+        res = httpd_resp_send_chunk(req, nullptr, 0);
+    }
+
+    camera->release_jpeg(snapshot);
     return res;
-}
\ No newline at end of file
+}
+
+esp_err_t WebServer::stream_handler(httpd_req_t* req) {
+    stream_requests.inc();
+    ESP_LOGI(TAG, "Start /stream");
+    if (!camera) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    // Returns right away, the frames are sent by the stream task
+    return stream.add_client(req);
+}
+
+esp_err_t WebServer::events_handler(httpd_req_t* req) {
+    events_requests.inc();
+    ESP_LOGI(TAG, "Start /events");
+    if (!camera) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    return events.add_client(req);
+}
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "camera.hpp"
+#include "mjpeg_stream.hpp"
+#include "event_stream.hpp"
 
 class WebServer {
 public:
@@ -14,6 +18,12 @@ public:
 private:
     Camera* camera = nullptr;
     httpd_handle_t server_handle = nullptr;
+    uint8_t* qoi_buf = nullptr;     // /roi.qoi, handlers run one at a time on the server task
+    char* metrics_buf = nullptr;    // /metrics
+    char ui_etag[12] = "";
+    MjpegStream stream;
+    EventStream events;
+    QueueHandle_t fresh_downloads = nullptr;    // /download.jpg?fresh=1 requests (async copies)
 
     static void event_handler(void* arg, esp_event_base_t event_base,
                               int32_t event_id, void* event_data);
@@ -22,24 +32,66 @@ private:
     esp_err_t wifi_init_station();
 
     esp_err_t root_get_handler(httpd_req_t* req);
+    esp_err_t config_get_handler(httpd_req_t* req);
     esp_err_t readings_get_handler(httpd_req_t* req);
+    esp_err_t history_get_handler(httpd_req_t* req);
+    esp_err_t trace_get_handler(httpd_req_t* req);
+    esp_err_t metrics_get_handler(httpd_req_t* req);
+    esp_err_t profile_get_handler(httpd_req_t* req);
     esp_err_t roi_jpg_handler(httpd_req_t* req);
+    esp_err_t roi_qoi_handler(httpd_req_t* req);
     esp_err_t full_photo_handler(httpd_req_t* req);
+    esp_err_t send_frame_jpeg(httpd_req_t* req);
+    static void fresh_download_task(void* arg);
+    esp_err_t stream_handler(httpd_req_t* req);
+    esp_err_t events_handler(httpd_req_t* req);
 
     static esp_err_t root_handler_wrapper(httpd_req_t* req) {
         WebServer* self = static_cast<WebServer*>(req->user_ctx);
         return self->root_get_handler(req);
     }
+    static esp_err_t config_handler_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->config_get_handler(req);
+    }
     static esp_err_t readings_handler_wrapper(httpd_req_t* req) {
         WebServer* self = static_cast<WebServer*>(req->user_ctx);
         return self->readings_get_handler(req);
     }
+    static esp_err_t history_handler_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->history_get_handler(req);
+    }
+    static esp_err_t trace_handler_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->trace_get_handler(req);
+    }
+    static esp_err_t metrics_handler_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->metrics_get_handler(req);
+    }
+    static esp_err_t profile_handler_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->profile_get_handler(req);
+    }
     static esp_err_t roi_handler_wrapper(httpd_req_t* req) {
         WebServer* self = static_cast<WebServer*>(req->user_ctx);
         return self->roi_jpg_handler(req);
     }
+    static esp_err_t roi_qoi_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->roi_qoi_handler(req);
+    }
     static esp_err_t full_photo_wrapper(httpd_req_t* req) {
         WebServer* self = static_cast<WebServer*>(req->user_ctx);
         return self->full_photo_handler(req);
     }
+    static esp_err_t stream_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->stream_handler(req);
+    }
+    static esp_err_t events_wrapper(httpd_req_t* req) {
+        WebServer* self = static_cast<WebServer*>(req->user_ctx);
+        return self->events_handler(req);
+    }
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "esp_http_server.h"
+#include "esp_log.h"
+
+// Fields every client of a SessionTable starts with, the stream adds its own after them
+struct SessionClient {
+    void* table;                        // for the session free callback
+    bool active;
+    bool closing;                       // send failed, waiting for the server to close the session
+    int fd;
+};
+
+// The sessions of a streaming handler (/stream, /events): the handler sends the response header
+// and returns, the session stays open and is written by the stream's own task. Up to N clients
+// in a table under one mutex, a slot is freed by the server's session free callback whatever
+// closed the session.
+template <typename Client, int N>
+class SessionTable {
+public:
+    // Called with the table locked when a session closed, before its slot is freed
+    typedef void (*Closed)(Client& client, int remaining, void* arg);
+
+    bool init(const char* log_tag, Closed closed_fn, void* closed_arg) {
+        tag = log_tag;
+        closed = closed_fn;
+        arg = closed_arg;
+        mutex = xSemaphoreCreateMutex();
+        return mutex != nullptr;
+    }
+
+    // Locks the table and returns a cleared free slot, the caller sends the response and calls
+    // attach(), or unlock() if that failed. When every slot is taken, a 503 with busy as the body
+    // is sent instead, the table is unlocked and nullptr returned with the send result in *result.
+    Client* reserve(httpd_req_t* req, const char* busy, esp_err_t* result) {
+        lock();
+        for (Client& c : clients) {
+            if (!c.active) {
+                c = Client();
+                return &c;
+            }
+        }
+        unlock();
+
+        ESP_LOGW(tag, "%s (%d)", busy, N);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        *result = httpd_resp_send(req, busy, HTTPD_RESP_USE_STRLEN);
+        return nullptr;
+    }
+
+    // Activates the reserved client on the socket of req and unlocks, returns the client count
+    int attach(httpd_req_t* req, Client* client) {
+        client->table = this;
+        client->active = true;
+        client->fd = httpd_req_to_sockfd(req);
+        int count = ++client_count;
+
+        // Called by the server task when the session closes, for whatever reason
+        req->sess_ctx = client;
+        req->free_ctx = on_session_closed;
+
+        unlock();
+        return count;
+    }
+
+    void lock() { xSemaphoreTake(mutex, portMAX_DELAY); }
+    void unlock() { xSemaphoreGive(mutex); }
+    int count() const { return client_count; }
+
+    // Every slot, active or not, with the table locked
+    Client* begin() { return clients; }
+    Client* end() { return clients + N; }
+
+private:
+    const char* tag = "";
+    Closed closed = nullptr;
+    void* arg = nullptr;
+    SemaphoreHandle_t mutex = nullptr;
+    Client clients[N] = {};
+    volatile int client_count = 0;
+
+    static void on_session_closed(void* ctx) {
+        Client* client = static_cast<Client*>(ctx);
+        SessionTable* self = static_cast<SessionTable*>(client->table);
+
+        self->lock();
+        int remaining = --self->client_count;
+        if (self->closed) self->closed(*client, remaining, self->arg);
+        client->active = false;
+        self->unlock();
+    }
+};
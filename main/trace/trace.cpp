@@ -0,0 +1,202 @@
+#include <atomic>
+#include <new>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.hpp"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#else
+#include <chrono>
+#endif
+
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of two");
+
+// Every field is atomic, a slot being overwritten while it is exported is detected by its index
+struct TraceSlot {
+    std::atomic<uint32_t> index;        // event number + 1, 0 while being written
+    std::atomic<uint32_t> ts_lo;
+    std::atomic<uint32_t> ts_hi;
+    std::atomic<const char*> name;
+    std::atomic<const char*> thread;
+    std::atomic<uint8_t> phase;
+    std::atomic<uint8_t> core;
+};
+
+struct TraceCopy {
+    int64_t ts;
+    const char* name;
+    const char* thread;
+    char phase;
+    int core;
+};
+
+static TraceSlot* slots = nullptr;
+static std::atomic<uint32_t> next_event{0};
+
+bool trace_init() {
+    if (slots) return true;
+
+#ifdef ESP_PLATFORM
+    void* mem = heap_caps_malloc(TRACE_RING_SIZE * sizeof(TraceSlot), MALLOC_CAP_SPIRAM);
+#else
+    void* mem = malloc(TRACE_RING_SIZE * sizeof(TraceSlot));
+#endif
+    if (!mem) return false;
+
+    TraceSlot* ring = static_cast<TraceSlot*>(mem);
+    for (int i = 0; i < TRACE_RING_SIZE; i++) {
+        new (&ring[i]) TraceSlot();
+        ring[i].index.store(0, std::memory_order_relaxed);
+    }
+    slots = ring;
+    return true;
+}
+
+int64_t trace_now_us() {
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void trace_event(const char* name, char phase) {
+    TraceSlot* ring = slots;
+    if (!ring) return;
+
+    int64_t ts = trace_now_us();
+    uint32_t n = next_event.fetch_add(1, std::memory_order_relaxed);
+    TraceSlot& slot = ring[n & (TRACE_RING_SIZE - 1)];
+
+    slot.index.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.ts_lo.store((uint32_t)ts, std::memory_order_relaxed);
+    slot.ts_hi.store((uint32_t)(ts >> 32), std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+#ifdef ESP_PLATFORM
+    slot.thread.store(pcTaskGetName(nullptr), std::memory_order_relaxed);
+    slot.core.store(xPortGetCoreID(), std::memory_order_relaxed);
+#else
+    slot.thread.store("host", std::memory_order_relaxed);
+    slot.core.store(0, std::memory_order_relaxed);
+#endif
+    slot.phase.store(phase, std::memory_order_relaxed);
+    slot.index.store(n + 1, std::memory_order_release);
+}
+
+uint32_t trace_recorded() {
+    return next_event.load(std::memory_order_relaxed);
+}
+
+static bool copy_slot(uint32_t n, TraceCopy* out) {
+    const TraceSlot& slot = slots[n & (TRACE_RING_SIZE - 1)];
+
+    uint32_t before = slot.index.load(std::memory_order_acquire);
+    out->ts = (int64_t)((uint64_t)slot.ts_hi.load(std::memory_order_relaxed) << 32 |
+                        slot.ts_lo.load(std::memory_order_relaxed));
+    out->name = slot.name.load(std::memory_order_relaxed);
+    out->thread = slot.thread.load(std::memory_order_relaxed);
+    out->phase = slot.phase.load(std::memory_order_relaxed);
+    out->core = slot.core.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t after = slot.index.load(std::memory_order_relaxed);
+
+    return before == n + 1 && after == n + 1;
+}
+
+// Task names become track ids, a task that recorded nothing in the ring gets none
+#define TRACE_MAX_THREADS   16
+
+struct ChromeExport {
+    TraceWriter write;
+    void* arg;
+    char buf[TRACE_EXPORT_CHUNK_SIZE];
+    size_t len;
+    bool ok;
+    const char* threads[TRACE_MAX_THREADS];
+    int thread_count;
+
+    void append(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    void flush() {
+        if (ok && len > 0) ok = write(buf, len, arg);
+        len = 0;
+    }
+    int thread_id(const char* thread) {
+        for (int i = 0; i < thread_count; i++) {
+            if (threads[i] == thread) return i + 1;
+        }
+        if (thread_count == TRACE_MAX_THREADS) return 0;
+        threads[thread_count++] = thread;
+        return thread_count;
+    }
+};
+
+void ChromeExport::append(const char* fmt, ...) {
+    if (sizeof(buf) - len < 160) flush();
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + len, sizeof(buf) - len, fmt, args);
+    va_end(args);
+    if (n > 0 && (size_t)n < sizeof(buf) - len) len += n;
+}
+
+bool trace_export_chrome(TraceWriter write, void* arg) {
+    if (!slots) return false;
+
+    ChromeExport* out = (ChromeExport*)malloc(sizeof(ChromeExport));
+    if (!out) return false;
+    out->write = write;
+    out->arg = arg;
+    out->len = 0;
+    out->ok = true;
+    out->thread_count = 0;
+
+    // Events keep coming while the ring is written out, only the ones recorded before are sent
+    uint32_t end = next_event.load(std::memory_order_acquire);
+    uint32_t start = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+
+    out->append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    for (uint32_t n = start; n != end && out->ok; n++) {
+        TraceCopy e;
+        if (!copy_slot(n, &e)) continue;
+
+        int tid = out->thread_id(e.thread);
+        out->append("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"core\":%d}}",
+                    first ? "" : ",", e.name, e.phase, (long long)e.ts, tid, e.core);
+        first = false;
+    }
+
+    for (int i = 0; i < out->thread_count && out->ok; i++) {
+        out->append("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",", i + 1, out->threads[i]);
+        first = false;
+    }
+    out->append("]}");
+    out->flush();
+
+    bool ok = out->ok;
+    free(out);
+    return ok;
+}
+
+#if TRACE_ENABLED
+// The SDK's stage hooks (weak no-ops in its porting layer)
+void ei_trace_begin(const char* name) {
+    trace_event(name, 'B');
+}
+
+void ei_trace_end(const char* name) {
+    trace_event(name, 'E');
+}
+#endif
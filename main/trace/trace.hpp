@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// Begin/end events of the pipeline stages in a fixed ring of TRACE_RING_SIZE events, the oldest
+// are overwritten. Recording is lock-free (one atomic increment, no allocation) and safe from any
+// task on either core. Timestamps are esp_timer_get_time() on the device and a monotonic clock on
+// a host build. Names must be string literals (only the pointer is kept).
+//
+// The ring is exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev), one track per
+// task. The SDK stages (ei_dsp, ei_invoke, ei_postprocess) arrive through ei_trace_begin/end().
+
+// Writes one piece of the export, returns false to stop it
+typedef bool (*TraceWriter)(const char* data, size_t len, void* arg);
+
+// Allocates the ring, events recorded before are dropped
+bool trace_init();
+int64_t trace_now_us();
+void trace_event(const char* name, char phase);
+// Events recorded since boot, including the overwritten ones
+uint32_t trace_recorded();
+bool trace_export_chrome(TraceWriter write, void* arg);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(name) { trace_event(name, 'B'); }
+    ~TraceScope() { trace_event(name, 'E'); }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(name)   trace_event(name, 'B')
+#define TRACE_END(name)     trace_event(name, 'E')
+#define TRACE_SCOPE(name)   TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define TRACE_BEGIN(name)   do {} while (0)
+#define TRACE_END(name)     do {} while (0)
+#define TRACE_SCOPE(name)   do {} while (0)
+#endif